@@ -0,0 +1,778 @@
+/** @file ScanLatencyBench.cpp
+*
+* @brief Scan-to-door latency benchmark for the native build. Runs the
+*        real setup() and loop() from main.cpp on the virtual clock, presents
+*        scripted cards to the MFRC522 fake and measures the time from card
+*        detection (first selection of the card) until Door::open is called.
+*
+*        Scenarios:
+*        - light : one person every 20 s
+*        - burst : shift change, one person every 1.5 s
+*        - return: eight people coming back every 40 s, their cards are
+*                  answered from the UID cache after the first scan
+*        - compact: light traffic with version 2 cards, read in one block
+*        - together: three people tapping their cards at the same time,
+*                  every card held briefly
+*        - idle  : nobody at the door, SPI traffic to the reader with
+*                  polling and with IRQ detection
+*        - boot  : with a log history split into day segments, time to
+*                  open the last segment with and without its summary and
+*                  to read the whole history from records or summaries
+*        - day   : a day with more employees than the summary table holds,
+*                  time of every append and of every run of the log task
+*        - users : 100, 1k and 10k users in the SD user store, time to
+*                  import them and to authenticate known and unknown cards,
+*                  then to remove a third of them and compact the store
+*
+*        Build and run: pio run -e native_bench && .pio/build/native_bench/program
+*
+*        Besides the table, every metric is printed as a "BENCH <key> <value>"
+*        line so runs can be compared by scripts.
+*
+*
+*/
+
+#include <Arduino.h>
+#include <HostHal.h>
+#include "RFIDreader.hpp"
+#include "Database.hpp"
+#include "LogFormat.hpp"
+#include "LogStore.hpp"
+#include "UserStore.hpp"
+#include "UserFilter.hpp"
+#include "AuthenticationService.hpp"
+#include "AdminOperation.hpp"
+#include "CardFormat.hpp"
+#include "NamePool.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Number of registered users written to the test card
+//
+static const uint16_t bench_user_count = 50;
+
+// Time given to the door to close and the loop to settle after a scenario
+//
+static const uint32_t bench_settle_ms = 15000;
+
+// Length of the idle run of each card detection mode
+//
+static const uint32_t bench_idle_ms = 60000;
+
+// Log history written to the test card: days and scans per user and day
+//
+static const uint16_t bench_history_days  = 30;
+static const uint8_t  bench_history_scans = 4;
+
+// Employees scanning in and out during the day scenario, and the runs of
+// the log task between two scans
+//
+static const uint16_t bench_day_employees = 600;
+static const uint8_t  bench_day_log_runs  = 10;
+
+// Sizes of the user store measured by the users scenario, and the number
+// of known and unknown cards authenticated at each size
+//
+static const uint32_t bench_store_sizes[] = { 100, 1000, 10000 };
+static const uint16_t bench_known_cards   = 1000;
+static const uint16_t bench_unknown_cards = 200;
+
+// Description of a traffic pattern
+//
+struct Scenario
+{
+    const char *name;
+    uint16_t    people;       // Number of card presentations
+    uint32_t    spacing_ms;   // Time between two presentations
+    uint32_t    hold_ms;      // Time a card stays in the field
+    uint16_t    cards;        // Distinct cards, presented in turn
+    uint8_t     format;       // Card data layout, 1 or 2
+    uint8_t     group;        // Cards presented at the same time
+};
+
+static const Scenario scenarios[] =
+{
+    { "light",    20, 20000, 1500, 20, 1, 1 },
+    { "burst",    40,  1500, 3000, 40, 1, 1 },
+    { "return",   40,  5000, 1500,  8, 1, 1 },
+    { "compact",  20, 20000, 1500, 20, 2, 1 },
+    { "together", 30,  5000,  200, 30, 1, 3 },
+};
+
+// A card detected and waiting for the door to open
+//
+struct Detection
+{
+    uint64_t at_us;
+    uint64_t presented_us;
+};
+
+// Samples collected by the trace listener
+//
+struct Samples
+{
+    std::map<uint32_t, std::vector<uint64_t>> presented_at_us;   // UID to presentation times
+    std::vector<uint64_t>        detect_to_door_us;
+    std::vector<uint64_t>        present_to_door_us;
+    uint32_t                     detected = 0;
+    uint32_t                     dropped  = 0;      // Detected but the door never opened
+    std::deque<Detection>        pending;           // Detections in order, the doors open in order
+};
+
+static Samples samples;
+
+/*!
+* @brief Function to pair card detections with the next door opening.
+* @param[in] event TraceEvent reported by the fakes or the firmware.
+* @param[in] tag uint32_t UID of the detected card.
+* @param[in] at_us uint64_t virtual time of the event.
+*/
+static void
+on_trace(host::TraceEvent event, uint32_t tag, uint64_t at_us)
+{
+    if (event == host::TRACE_CARD_DETECTED)
+    {
+        // Cards read in one go are detected within a detection period, an
+        // earlier card still waiting never opened the door
+        //
+        while (!samples.pending.empty() &&
+               at_us - samples.pending.front().at_us >= (uint64_t)rfid_detect_period_ms * 1000)
+        {
+            samples.dropped++;
+            samples.pending.pop_front();
+        }
+        samples.detected++;
+
+        // A card presented again is detected during its latest presentation
+        //
+        Detection detection = { at_us, 0 };
+        for (uint64_t presented_us : samples.presented_at_us[tag])
+        {
+            if (presented_us <= at_us)
+            {
+                detection.presented_us = presented_us;
+            }
+        }
+        samples.pending.push_back(detection);
+    }
+    else if (event == host::TRACE_DOOR_OPEN && !samples.pending.empty())
+    {
+        const Detection &detection = samples.pending.front();
+        samples.detect_to_door_us.push_back(at_us - detection.at_us);
+        samples.present_to_door_us.push_back(at_us - detection.presented_us);
+        samples.pending.pop_front();
+    }
+}
+
+/*!
+* @brief Function to build the name of the n-th user from letters only.
+* @param[in] n uint16_t index of the user.
+* @return The user name.
+*/
+static std::string
+user_name(uint16_t n)
+{
+    std::string name = "emp";
+    name += (char)('a' + (n / 26) % 26);
+    name += (char)('a' + n % 26);
+    return name;
+}
+
+/*!
+* @brief Function to write a file below the card directory.
+* @param[in] root const std::string& of the card directory.
+* @param[in] path const char * of the file on the card.
+* @param[in] content const std::string& to write.
+*/
+static void
+write_card_file(const std::string &root, const char *path, const std::string &content)
+{
+    std::string full = root + "/" + path;
+    FILE *fp = fopen(full.c_str(), "wb");
+    if (fp != nullptr)
+    {
+        fwrite(content.data(), 1, content.size(), fp);
+        fclose(fp);
+    }
+}
+
+/*!
+* @brief Function to create an SD card directory with admins and users.
+* @return The card directory.
+*/
+static std::string
+prepare_card()
+{
+    char root[] = "/tmp/aes_bench_XXXXXX";
+    if (mkdtemp(root) == nullptr)
+    {
+        perror("mkdtemp");
+        exit(1);
+    }
+    std::string dir = root;
+    mkdir((dir + "/temp").c_str(), 0755);
+
+    std::string users;
+    for (uint16_t i = 0; i < bench_user_count; i++)
+    {
+        users += user_name(i) + "," + std::to_string(1000 + i) + "\n";
+    }
+
+    // Log history, every user scans a few times a day. Written as a single
+    // log, it is split into day segments by setup()
+    //
+    std::string log;
+    LogHeader header;
+    log_make_header(header);
+    log.append((const char *)&header, sizeof(header));
+    for (uint16_t day = 0; day < bench_history_days; day++)
+    {
+        for (uint16_t i = 0; i < bench_user_count; i++)
+        {
+            for (uint8_t scan = 0; scan < bench_history_scans; scan++)
+            {
+                LogRecord record;
+                uint32_t epoch = 1735689600UL + day * 86400UL + (8 + scan * 3) * 3600UL + i * 7;
+                log_make_record(record, 1000 + i, epoch, LOG_EVENT_ACCESS);
+                log.append((const char *)&record, sizeof(record));
+            }
+        }
+    }
+    write_card_file(dir, "temp/rfid_log.bin", log);
+
+    write_card_file(dir, "temp/admin.txt", "admin,1234\n");
+    write_card_file(dir, "temp/user.txt", users);
+    write_card_file(dir, "temp/per_size.txt",
+                    "admin_size:1\nuser_size:" + std::to_string(bench_user_count) + "\n");
+    return dir;
+}
+
+/*!
+* @brief Function to pick a percentile by nearest rank.
+* @param[in] values std::vector<uint64_t> sorted samples.
+* @param[in] pct double percentile (0-100].
+* @return The sample at the percentile, 0 when empty.
+*/
+static uint64_t
+percentile(const std::vector<uint64_t> &values, double pct)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    size_t rank = (size_t)((pct / 100.0) * values.size() + 0.999999);
+    rank = (rank == 0) ? 1 : rank;
+    return values[std::min(rank, values.size()) - 1];
+}
+
+/*!
+* @brief Function to print p50/p99/max of a sample set.
+* @param[in] scenario const char * of the scenario name.
+* @param[in] metric const char * of the metric name.
+* @param[in] values std::vector<uint64_t> samples in microseconds.
+*/
+static void
+report(const char *scenario, const char *metric, std::vector<uint64_t> values)
+{
+    std::sort(values.begin(), values.end());
+    uint64_t p50 = percentile(values, 50.0);
+    uint64_t p99 = percentile(values, 99.0);
+    uint64_t worst = values.empty() ? 0 : values.back();
+
+    printf("  %-16s p50 %8.1f ms   p99 %8.1f ms   max %8.1f ms\n",
+           metric, p50 / 1000.0, p99 / 1000.0, worst / 1000.0);
+    printf("BENCH %s.%s.p50_ms %.1f\n", scenario, metric, p50 / 1000.0);
+    printf("BENCH %s.%s.p99_ms %.1f\n", scenario, metric, p99 / 1000.0);
+    printf("BENCH %s.%s.max_ms %.1f\n", scenario, metric, worst / 1000.0);
+}
+
+/*!
+* @brief Function to run one traffic pattern through loop().
+* @param[in] scenario const Scenario& to run.
+*/
+static void
+run_scenario(const Scenario &scenario)
+{
+    samples = Samples();
+
+    uint32_t start_ms = (uint32_t)(host::clock_now_us() / 1000) + 1000;
+    for (uint16_t i = 0; i < scenario.people; i++)
+    {
+        uint16_t card = i % scenario.cards;
+        uint16_t user = card % bench_user_count;
+        uint32_t uid = 0xC0DE0000UL + card;
+        uint32_t at_ms = start_ms + (i / scenario.group) * scenario.spacing_ms;
+
+        host::Card card_data = host::make_card(uid, user_name(user).c_str(), std::to_string(1000 + user).c_str());
+        if (scenario.format == 2)
+        {
+            CardBlock block;
+            card_make_block(block, user_name(user).c_str(), 1000 + user);
+            memcpy(card_data.blocks[card_data_block], &block, sizeof(block));
+            memset(card_data.blocks[card_empid_block], 0, sizeof(card_data.blocks[card_empid_block]));
+        }
+        host::present_card(card_data, at_ms, scenario.hold_ms);
+        samples.presented_at_us[uid].push_back((uint64_t)at_ms * 1000);
+    }
+
+    uint64_t end_us = (uint64_t)(start_ms + scenario.people / scenario.group * scenario.spacing_ms +
+                                 scenario.hold_ms + bench_settle_ms) * 1000;
+    AuthenticationService *auth = AdminOperation::get_instance()->get_authentication_service();
+    auth->reset_stats();
+    RFIDreader::get_instance()->reset_stats();
+
+    uint32_t loops = 0;
+    uint32_t spi_start = host::rfid_stats().spi_bytes;
+    host::SdStats sd_start = host::sd_stats();
+    uint64_t loop_start_us = host::clock_now_us();
+    while (host::clock_now_us() < end_us)
+    {
+        loop();
+        loops++;
+    }
+    samples.dropped += samples.pending.size();
+
+    uint64_t elapsed_us = host::clock_now_us() - loop_start_us;
+    uint32_t opened = (uint32_t)samples.detect_to_door_us.size();
+    uint32_t missed = scenario.people - samples.detected;
+
+    printf("\n%s: %u cards, %u at a time every %lu ms, held %lu ms\n", scenario.name, scenario.people,
+           scenario.group, (unsigned long)scenario.spacing_ms, (unsigned long)scenario.hold_ms);
+    printf("  opened %u, never detected %u, detected without opening %u, %.1f loops/s\n",
+           opened, missed, samples.dropped, loops * 1000000.0 / (double)elapsed_us);
+    report(scenario.name, "detect_to_door", samples.detect_to_door_us);
+    report(scenario.name, "present_to_door", samples.present_to_door_us);
+    printf("BENCH %s.opened %u\n", scenario.name, opened);
+    printf("BENCH %s.missed %u\n", scenario.name, missed);
+    printf("BENCH %s.dropped %u\n", scenario.name, samples.dropped);
+    printf("BENCH %s.rfid_spi_bytes %u\n", scenario.name, host::rfid_stats().spi_bytes - spi_start);
+    printf("BENCH %s.sd_opens %u\n", scenario.name, host::sd_stats().opens - sd_start.opens);
+    printf("BENCH %s.sd_flushes %u\n", scenario.name, host::sd_stats().flushes - sd_start.flushes);
+    printf("BENCH %s.sd_bytes_written %u\n", scenario.name,
+           host::sd_stats().bytes_written - sd_start.bytes_written);
+
+    host::serial_set_echo(true);
+    auth->print_stats();
+    NamePool::get_instance()->print_stats();
+    RFIDreader::get_instance()->print_stats();
+    host::serial_set_echo(false);
+}
+
+/*!
+* @brief Function to measure the reader traffic with nobody at the door.
+* @param[in] mode RFIDreader::DetectMode to measure.
+* @param[in] name const char * of the mode in the report.
+*/
+static void
+run_idle(RFIDreader::DetectMode mode, const char *name)
+{
+    RFIDreader::get_instance()->set_detect_mode(mode);
+
+    host::RfidStats before = host::rfid_stats();
+    uint64_t end_us = host::clock_now_us() + (uint64_t)bench_idle_ms * 1000;
+    while (host::clock_now_us() < end_us)
+    {
+        loop();
+    }
+    const host::RfidStats &after = host::rfid_stats();
+
+    double seconds = bench_idle_ms / 1000.0;
+    double bytes_per_s = (after.spi_bytes - before.spi_bytes) / seconds;
+    printf("  %-8s %8.0f SPI bytes/s   %6.1f polls/s\n", name, bytes_per_s,
+           (after.polls - before.polls) / seconds);
+    printf("BENCH idle.%s.rfid_spi_bytes_per_s %.0f\n", name, bytes_per_s);
+}
+
+/*!
+* @brief Function to time one opening of the log at boot.
+* @return The virtual time spent in microseconds.
+*/
+static uint64_t
+time_log_load()
+{
+    host::SdStats before = host::sd_stats();
+    uint64_t start_us = host::clock_now_us();
+    Database::get_instance()->load_rfid_user_log_data();
+    uint64_t elapsed_us = host::clock_now_us() - start_us;
+    printf("  %8.1f ms, %u bytes read\n", elapsed_us / 1000.0, host::sd_stats().bytes_read - before.bytes_read);
+    return elapsed_us;
+}
+
+/*!
+* @brief Function to time a pass over the whole history.
+* @param[in] raw bool true to read every record, false to read the segment summaries.
+* @return The virtual time spent in microseconds.
+*/
+static uint64_t
+time_history_query(bool raw)
+{
+    LogStore *store = LogStore::get_instance();
+    host::SdStats before = host::sd_stats();
+    uint64_t start_us = host::clock_now_us();
+    uint32_t rows = 0;
+
+    if (raw)
+    {
+        LogRecord record;
+        uint32_t segment;
+        for (uint16_t i = 0; store->get_segment(i, segment); i++)
+        {
+            store->rewind_records(segment);
+            while (store->next_record(record))
+            {
+                rows++;
+            }
+        }
+    }
+    else
+    {
+        SummaryEntry entry;
+        store->rewind_summaries();
+        while (store->next_summary(entry))
+        {
+            rows++;
+        }
+    }
+
+    uint64_t elapsed_us = host::clock_now_us() - start_us;
+    printf("  %8.1f ms, %u rows, %u bytes read\n", elapsed_us / 1000.0, rows,
+           host::sd_stats().bytes_read - before.bytes_read);
+    return elapsed_us;
+}
+
+/*!
+* @brief Function to compare the boot and the history queries with and
+*        without the segment summaries.
+* @param[in] card_dir const std::string& of the card directory.
+*/
+static void
+run_boot(const std::string &card_dir)
+{
+    LogStore *store = LogStore::get_instance();
+
+    printf("\nboot: %u days of history, %u scans per user and day, %u segments\n",
+           bench_history_days, bench_history_scans, store->get_segment_count());
+
+    // Without its summary the last segment is replayed entirely
+    //
+    uint32_t segment;
+    store->get_segment(store->get_segment_count() - 1, segment);
+    DateTime day(segment * 86400UL);
+    char path[64];
+    snprintf(path, sizeof(path), "%s/temp/logs/%04u%02u%02u.sum", card_dir.c_str(),
+             (unsigned)day.year(), (unsigned)day.month(), (unsigned)day.day());
+    unlink(path);
+
+    printf("  last segment replay  ");
+    uint64_t replay_us = time_log_load();
+    printf("  summary              ");
+    uint64_t summary_us = time_log_load();
+
+    printf("  history from records ");
+    uint64_t raw_us = time_history_query(true);
+    printf("  history from summary ");
+    uint64_t query_us = time_history_query(false);
+
+    printf("BENCH boot.segment_replay_ms %.1f\n", replay_us / 1000.0);
+    printf("BENCH boot.summary_ms %.1f\n", summary_us / 1000.0);
+    printf("BENCH query.records_ms %.1f\n", raw_us / 1000.0);
+    printf("BENCH query.summaries_ms %.1f\n", query_us / 1000.0);
+}
+
+/*!
+* @brief Function to time the appends of a day on which more employees scan
+*        than the summary table holds, and the runs of the log task merging
+*        it into the summary file in between.
+*/
+static void
+run_day()
+{
+    LogStore *store = LogStore::get_instance();
+    LogWriter *writer = LogWriter::get_instance();
+
+    printf("\nday: %u employees scanning in and out, %u log task runs between two scans\n",
+           bench_day_employees, bench_day_log_runs);
+
+    uint32_t segment;
+    store->get_segment(store->get_segment_count() - 1, segment);
+    uint32_t start = (segment + 1) * 86400UL + 8 * 3600UL;
+
+    std::vector<uint32_t> order;
+    for (uint16_t i = 0; i < bench_day_employees; i++)
+    {
+        order.push_back(300000 + i);
+    }
+    std::mt19937 rng(7);
+
+    std::vector<uint64_t> appends;
+    std::vector<uint64_t> steps;
+    for (uint8_t pass = 0; pass < 2; pass++)
+    {
+        std::shuffle(order.begin(), order.end(), rng);
+        for (uint16_t i = 0; i < bench_day_employees; i++)
+        {
+            uint64_t start_us = host::clock_now_us();
+            store->append(order[i], start + pass * 9 * 3600UL + i * 20);
+            appends.push_back(host::clock_now_us() - start_us);
+
+            for (uint8_t run = 0; run < bench_day_log_runs; run++)
+            {
+                start_us = host::clock_now_us();
+                writer->run();
+                store->run();
+                steps.push_back(host::clock_now_us() - start_us);
+                host::clock_advance_us(100000);
+            }
+        }
+    }
+
+    report("day", "append", appends);
+    report("day", "log_step", steps);
+}
+
+/*!
+* @brief Function to time card authentications against the user store.
+* @param[in] auth AuthenticationService& checking the cards.
+* @param[in] keys const std::vector<String>& of the card keys to check.
+* @param[in] size uint32_t number of users in the store.
+* @param[in] metric const char * of the metric in the report.
+*/
+static void
+time_authentications(AuthenticationService &auth, const std::vector<String> &keys,
+                     uint32_t size, const char *metric)
+{
+    std::vector<uint64_t> latencies;
+    host::SdStats before = host::sd_stats();
+    uint32_t accepted = 0;
+
+    for (const String &key : keys)
+    {
+        uint64_t start_us = host::clock_now_us();
+        accepted += auth.authenticate_user(key.c_str()) ? 1 : 0;
+        latencies.push_back(host::clock_now_us() - start_us);
+    }
+
+    char scenario[32];
+    snprintf(scenario, sizeof(scenario), "users.%lu", (unsigned long)size);
+    report(scenario, metric, latencies);
+    printf("BENCH %s.%s.accepted %u\n", scenario, metric, accepted);
+    printf("BENCH %s.%s.sd_bytes_read_per_card %.0f\n", scenario, metric,
+           (double)(host::sd_stats().bytes_read - before.bytes_read) / keys.size());
+}
+
+/*!
+* @brief Function to get the size of a file of the card.
+* @param[in] path const std::string& of the file.
+* @return The size in bytes, 0 when the file is missing.
+*/
+static uint64_t
+card_file_size(const std::string &path)
+{
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? (uint64_t)info.st_size : 0;
+}
+
+/*!
+* @brief Function to remove every third user from the store, then run the
+*        background compaction to its end. The known cards are checked again
+*        against the compacted tree.
+* @param[in] card_dir const std::string& of the card directory.
+* @param[in] auth AuthenticationService& checking the cards.
+* @param[in] known const std::vector<String>& of the known card keys.
+* @param[in] size uint32_t number of users in the store.
+*/
+static void
+time_removals(const std::string &card_dir, AuthenticationService &auth,
+              const std::vector<String> &known, uint32_t size)
+{
+    UserStore *store = UserStore::get_instance();
+    Database *database = Database::get_instance();
+    char scenario[32];
+    snprintf(scenario, sizeof(scenario), "users.%lu", (unsigned long)size);
+
+    uint64_t bytes_before = card_file_size(card_dir + "/temp/users.db") +
+                            card_file_size(card_dir + "/temp/users2.db");
+
+    std::vector<uint64_t> latencies;
+    for (uint32_t i = 0; i < size; i += 3)
+    {
+        uint64_t start_us = host::clock_now_us();
+        database->delete_user(String(100000 + 2 * i));
+        latencies.push_back(host::clock_now_us() - start_us);
+    }
+    report(scenario, "remove", latencies);
+
+    // Steps as the store task runs them, until the compaction and the
+    // rebuild of the user filter end
+    //
+    UserFilter *filter = UserFilter::get_instance();
+    std::vector<uint64_t> steps;
+    std::vector<uint64_t> filter_steps;
+    store->run();
+    while (store->is_compacting() || filter->is_building())
+    {
+        bool is_compacting = store->is_compacting();
+        bool is_building = filter->is_building();
+
+        uint64_t start_us = host::clock_now_us();
+        store->run();
+        uint64_t filter_us = host::clock_now_us();
+        filter->run();
+
+        if (is_compacting)
+        {
+            steps.push_back(filter_us - start_us);
+        }
+        if (is_building)
+        {
+            filter_steps.push_back(host::clock_now_us() - filter_us);
+        }
+    }
+
+    uint64_t bytes_after = card_file_size(card_dir + "/temp/users.db") +
+                           card_file_size(card_dir + "/temp/users2.db");
+    printf("  compaction: %zu steps, %.1f KB before, %.1f KB after\n",
+           steps.size(), bytes_before / 1024.0, bytes_after / 1024.0);
+    if (!steps.empty())
+    {
+        report(scenario, "compact_step", steps);
+    }
+    printf("BENCH %s.compact_steps %zu\n", scenario, steps.size());
+    if (!filter_steps.empty())
+    {
+        report(scenario, "filter_step", filter_steps);
+    }
+    printf("BENCH %s.filter_steps %zu\n", scenario, filter_steps.size());
+    printf("BENCH %s.store_kb_before %.1f\n", scenario, bytes_before / 1024.0);
+    printf("BENCH %s.store_kb_after %.1f\n", scenario, bytes_after / 1024.0);
+
+    // Cards of the removed users must now be refused
+    //
+    uint32_t expected = 0;
+    for (const String &key : known)
+    {
+        uint32_t empid = key.substring(key.indexOf(',') + 1).toInt();
+        expected += ((empid - 100000) / 2 % 3 != 0) ? 1 : 0;
+    }
+    time_authentications(auth, known, size, "known_after");
+    printf("BENCH %s.known_after.expected %u\n", scenario, expected);
+}
+
+/*!
+* @brief Function to measure the SD user store at several sizes: the import
+*        of a user file and the authentication of cards in random order.
+* @param[in] card_dir const std::string& of the card directory.
+*/
+static void
+run_users(const std::string &card_dir)
+{
+    UserStore *store = UserStore::get_instance();
+    AuthenticationService auth;
+    std::mt19937 rng(1);
+
+    printf("\nusers: %u known and %u unknown cards in random order, %u byte page cache\n",
+           bench_known_cards, bench_unknown_cards, (unsigned)(user_store_cache_pages * user_page_size));
+
+    for (uint32_t size : bench_store_sizes)
+    {
+        // Registered ids are even, the unknown cards use the odd ids between them
+        //
+        std::string users;
+        for (uint32_t i = 0; i < size; i++)
+        {
+            users += user_name(i) + "," + std::to_string(100000 + 2 * i) + "\n";
+        }
+
+        store->close();
+        unlink((card_dir + "/temp/users.db").c_str());
+        unlink((card_dir + "/temp/users2.db").c_str());
+        write_card_file(card_dir, "temp/user.txt", users);
+
+        uint64_t start_us = host::clock_now_us();
+        Database::get_instance()->load_users();
+        uint64_t import_us = host::clock_now_us() - start_us;
+
+        printf("\n%lu users, imported in %.1f ms\n", (unsigned long)store->size(), import_us / 1000.0);
+        printf("BENCH users.%lu.import_ms %.1f\n", (unsigned long)size, import_us / 1000.0);
+
+        std::vector<String> known;
+        for (uint16_t i = 0; i < bench_known_cards; i++)
+        {
+            uint32_t n = rng() % size;
+            known.push_back(String(user_name(n).c_str()) + "," + String(100000 + 2 * n));
+        }
+        std::vector<String> unknown;
+        for (uint16_t i = 0; i < bench_unknown_cards; i++)
+        {
+            uint32_t n = rng() % size;
+            unknown.push_back(String(user_name(n).c_str()) + "," + String(100000 + 2 * n + 1));
+        }
+
+        store->reset_stats();
+        UserFilter::get_instance()->reset_stats();
+        time_authentications(auth, known, size, "known");
+        time_authentications(auth, unknown, size, "unknown");
+        time_removals(card_dir, auth, known, size);
+
+        host::serial_set_echo(true);
+        store->print_stats();
+        UserFilter::get_instance()->print_stats();
+        host::serial_set_echo(false);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    std::string card_dir = prepare_card();
+
+    host::clock_use_virtual(true);
+    host::sd_set_root(card_dir.c_str());
+    host::serial_set_echo(false);
+    host::set_trace_listener(on_trace);
+
+    setup();
+
+    printf("Scan-to-door latency, %u users, SD card in %s\n", bench_user_count, card_dir.c_str());
+    for (const Scenario &scenario : scenarios)
+    {
+        if (argc > 1 && strcmp(argv[1], scenario.name) != 0)
+        {
+            continue;
+        }
+        run_scenario(scenario);
+    }
+
+    if (argc <= 1 || strcmp(argv[1], "idle") == 0)
+    {
+        printf("\nidle: nobody at the door for %lu ms\n", (unsigned long)bench_idle_ms);
+        run_idle(RFIDreader::DETECT_POLLING, "polling");
+        run_idle(RFIDreader::DETECT_IRQ, "irq");
+    }
+
+    if (argc <= 1 || strcmp(argv[1], "boot") == 0)
+    {
+        run_boot(card_dir);
+    }
+
+    if (argc <= 1 || strcmp(argv[1], "day") == 0)
+    {
+        run_day();
+    }
+
+    // Last, the store no longer holds the users of the other scenarios
+    //
+    if (argc <= 1 || strcmp(argv[1], "users") == 0)
+    {
+        run_users(card_dir);
+    }
+    return 0;
+}
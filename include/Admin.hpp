@@ -18,7 +18,7 @@ class Admin : public Person
 
 public:
 
-    void    set_password(const String& admin_password);      // Set admin password
+    bool    set_password(const String& admin_password);      // Set admin password, false when the name pool is full
     String  get_password() const;                            // Retrieve admin password
     
     // TODO : Specific authenticaiton if required for admins
@@ -27,7 +27,7 @@ public:
 
 private:
 
-    String  password;                                       // Admin's password
+    PooledName password;                                    // Admin's password, held in the name pool
 
 };
 
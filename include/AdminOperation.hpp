@@ -48,7 +48,17 @@ public:
         REGISTER_USER,
         SAVE_USER,
         DELELTE_USER,
-        MAIN_MENU
+        MAIN_MENU,
+        PRINT_USERS,
+        PRINT_LOGS,
+        READ_SCAN_DATE,
+        PRINT_SCANS,
+        READ_CARD_EMPID,
+        WRITE_CARD,
+        ENROLL_CARDS,
+        READ_LOG_EMPID,
+        PRINT_USER_LOG,
+        PRINT_STATS
     };
 
     // Static variables for state, username, password, and authentication status
@@ -57,6 +67,9 @@ public:
     static String   username;
     static String   password;
     static bool     authenticated;
+    static uint16_t report_row;     // Next row of the table or section of the stats being printed
+    static String   enroll_name;    // User of the enrollment list waiting for a card
+    static uint32_t enroll_empid;
 
     // Singleton access method
     //
@@ -77,6 +90,13 @@ public:
     void view_log();
     void delete_user(String empid);
     void register_user(String name, String uid);
+    uint16_t stats_view(uint16_t section);
+    void stats_reset();
+    bool print_report_row(State report);
+    bool start_card_write(const String &empid);
+    bool print_card_write();
+    bool enroll_next_user();
+    bool print_enrollment();
 
     // Set and get authentication service
     //
@@ -14,6 +14,33 @@
 
 #include<Arduino.h>
 #include "Database.hpp"
+#include "NamePool.hpp"
+
+// Cards remembered by their UID, the people going in and out at the same time
+//
+const uint8_t auth_uid_cache_size = 16;
+
+// Longest UID of a card, triple size
+//
+const uint8_t auth_uid_size = 10;
+
+// Hits after which a cached card is read and looked up again, so a card
+// rewritten or cloned onto a known UID is noticed
+//
+const uint8_t auth_uid_verify_hits = 16;
+
+// Decision taken for a recently authenticated card
+//
+struct UidCacheEntry
+{
+    byte     uid[auth_uid_size];
+    uint8_t  uid_size;                // 0 when the entry is free
+    bool     is_allowed;
+    bool     is_referenced;           // Used since the clock hand last passed
+    uint8_t  hits;                    // Hits since the card was last read
+    uint16_t name;                    // Name pool handle of the user of an allowed card
+    uint32_t empid;
+};
 
 // Class handling authentication for users and admins
 //
@@ -24,6 +51,22 @@ private:
 
     Database *database;          // Pointer to the database
 
+    // UID cache, replaced with the CLOCK policy and cleared when the users change
+    //
+    UidCacheEntry* find_entry(const byte *uid, uint8_t uid_size);
+    void remember(const byte *uid, uint8_t uid_size, const char *rfid, bool is_allowed);
+    void check_generation();
+    void drop_entry(UidCacheEntry &entry);
+
+    UidCacheEntry uid_cache[auth_uid_cache_size];
+    uint8_t       clock_hand;
+    uint16_t      generation;    // User generation of the database the entries belong to
+
+    uint32_t hits;               // Cards answered from the cache
+    uint32_t misses;             // Cards read and looked up
+    uint32_t verifications;      // Cached cards read again to verify them
+    uint32_t invalidations;      // Cache cleared after a user change
+
 public:
 
     AuthenticationService();     // Constructor
@@ -31,7 +74,26 @@ public:
 
     // Authenticate a user
     //
-    bool authenticate_user(const String &rfid);  
+    bool authenticate_user(const char *rfid);  
+
+    // Key of a card in the UID cache, written to a card_key_size buffer and
+    // empty for a denied card. A hit spares reading the key from the card, a
+    // card due for verification is a miss
+    //
+    bool find_card(const byte *uid, uint8_t uid_size, char *rfid);
+
+    // Authenticate a card, its decision is cached under its UID
+    //
+    bool authenticate_card(const byte *uid, uint8_t uid_size, const char *rfid);
+
+    // Drop the decision of a card whose content was rewritten
+    //
+    void forget_card(const byte *uid, uint8_t uid_size);
+
+    // Statistics of the UID cache
+    //
+    void reset_stats();
+    void print_stats();
 
     // Authenticate an admin
     //
@@ -0,0 +1,61 @@
+/** @file CardFormat.hpp
+*
+* @brief Defines the data layouts of the employee cards. Version 1 spends
+         two blocks of sector 2 on text, the name in block 8 and the
+         employee id in block 9. Version 2 packs the binary employee id, a
+         short name, the format and a CRC into block 8 alone, so a card is
+         read with a single MIFARE_Read. A version 2 block is recognised
+         by its format byte, which is not a text character, and its CRC.
+*
+*
+*/
+
+#ifndef CARD_FORMAT_HPP
+#define CARD_FORMAT_HPP
+
+#include <Arduino.h>
+
+// Blocks of sector 2 holding the card data, the trailer holds its keys
+//
+const uint8_t card_data_block    = 8;    // Version 1 name, version 2 data
+const uint8_t card_empid_block   = 9;    // Version 1 employee id
+const uint8_t card_trailer_block = 11;
+
+// Format byte of a version 2 block, high bit set so text never matches it
+//
+const uint8_t card_format_v2 = 0x82;
+
+// Longest name of a version 2 card, longer names are written as version 1
+//
+const uint8_t card_name_size = 9;
+
+// Longest card key "name,empid", the text of two version 1 blocks, the comma
+// and the terminator
+//
+const uint8_t card_key_size = 34;
+
+// Version 2 data, one 16 byte block
+//
+struct CardBlock
+{
+    uint32_t empid;                   // Little endian, like the board
+    uint8_t  format;                  // card_format_v2
+    char     name[card_name_size];    // Zero padded, not terminated when full
+    uint16_t crc;                     // CRC of the bytes before it
+};
+
+static_assert(sizeof(CardBlock) == 16, "CardBlock layout");
+
+// Build a version 2 block, fails when the name does not fit
+//
+bool card_make_block(CardBlock &block, const char *name, uint32_t empid);
+
+// Check a block read from a card, false for a version 1 card
+//
+bool card_check_block(const CardBlock &block);
+
+// Card key "name,empid" of a version 2 block, written without allocating
+//
+void card_block_key(const CardBlock &block, char *key);
+
+#endif  // CARD_FORMAT_HPP
@@ -22,6 +22,12 @@
 #include <Arduino.h>
 #include "Admin.hpp"
 #include "User.hpp"
+#include "UserStore.hpp"
+#include "UserFilter.hpp"
+#include "LogFormat.hpp"
+#include "LogWriter.hpp"
+#include "LogStore.hpp"
+#include "ScanRecord.hpp"
 
 class Database 
 {
@@ -44,24 +50,42 @@ public:
     // Admin Databse APIs
     //
     void load_admins();
-    void update_admin_size(uint8_t);
-    uint8_t get_admin_size();
+    void update_admin_size(uint16_t);
+    uint16_t get_admin_size();
 
     // User Databse APIs
     //
     void load_users();
-    void update_user_size(uint8_t);
-    uint8_t get_user_size();
-    bool is_user_present(const String &);
+    bool import_users();
+    void update_user_size(uint16_t);
+    uint16_t get_user_size();
+    bool is_user_present(const char *);
     bool is_emp_present(const String &);
     void write_user(const User &);
     void delete_user(const String& );
 
+    // Changed by every user added or removed, lets the caches of the users notice
+    //
+    uint16_t get_user_generation();
+
+    // Enrollment of the users of a list, committed to the user store at the end
+    //
+    uint16_t begin_enrollment();
+    bool next_enrollment(String &name, uint32_t &empid);
+    bool enroll_user(const String &name, uint32_t empid);
+    void end_enrollment();
+
     // RFID Databse APIs
     //
     void load_rfid_log_data();
     void load_rfid_user_log_data();
-    void log_rfid_scan(const String & , const String &, const String &);
+    void log_scan(const ScanRecord &);
+
+    // Append a low memory alarm to the memory log
+    //
+    void log_memory_alarm(const char *text);
+    bool convert_legacy_log();
+    bool split_log();
 
     
     // NOTE : Used to Debug values in the terminal,but later used in displaying in the terminal 
@@ -75,19 +99,31 @@ public:
     void display_users();
     void display_admins();
     void display_user_logs();
+
+    // Row by row display, returns the next row or 0 once the table is printed
+    //
+    uint16_t display_users_row(uint16_t row);
+    uint16_t display_user_logs_row(uint16_t row);
+
+    // Raw scans of one day, read from its log segment
+    //
+    bool select_log_day(const String &date);
+    uint16_t display_scans_row(uint16_t row);
+
+    // Days of one user, its entry looked up in the summary of every segment
+    //
+    bool select_user_log(const String &empid);
+    uint16_t display_user_log_row(uint16_t row);
     
     // Access Methods for private data
     //
     const std::vector<Admin> & get_admins();
-    const std::vector<User>  & get_users();
-
-    std::map<String, String> const get_rfid_start_time();
-    std::map<String, String> const get_rfid_end_time();
     
     // Time handling APIs using the RTC , provide support to other classes
     //
     String get_current_time();
     String get_current_date();
+    uint32_t get_current_epoch();
 
 private:
     
@@ -107,49 +143,52 @@ private:
     //
     RTC_DS3231 rtc;
 
-    // Sizes of present Admins and Users
+    // Size of present Admins, the users are counted by the user store
+    //
+    uint16_t admin_size;
+
+    // Users added or removed since the boot
     //
-    uint8_t admin_size;
-    uint8_t user_size;
+    uint16_t user_generation;
+
+    // List being enrolled, and the users enrolled from it
+    //
+    File     enroll_list;
+    uint16_t enrolled;
 
     // Warning : Check in the Database if the files are present or not 
     
     // Database files to be stored
     //
     const String admin_file         = "temp/admin.txt";
-    const String user_file          = "temp/user.txt";
-    const String rfid_log_file      = "temp/rfid_log.txt";
+    const String user_file          = "temp/user.txt";       // Users to import into the store
+    const String user_store_file    = "temp/users.db";
+    const String user_spare_file    = "temp/users2.db";      // The store after every other compaction
+    const String enroll_file        = "temp/enroll.txt";     // Users waiting for their card
+    const String rfid_log_file      = "temp/rfid_log.bin";   // Single log before the segments
+    const String legacy_log_file    = "temp/rfid_log.txt";   // Text log before the binary format
+    const String checkpoint_file    = "temp/rfid_ckp.bin";   // Left by the single log, removed with it
     const String person_size_file   = "temp/per_size.txt";
+    const String memory_log_file    = "temp/memory.txt";     // Low memory alarms
 
     // Variables regarding users and admins stored in runtime
     //
     static std::vector<Admin>       admins;
-    static std::vector<User>        users;
-    
-    // Maps for the usage other classes
-    //
-    static std::map<String, bool>   rfid_map;
-    static std::map<String, bool>   emp_map;
-    static std::map<String, String> rfid_start_time;
-    static std::map<String, String> rfid_end_time;
-    
-    // Delete functionality of user from the database
-    //
-    void delete_user_from_vector(const String & );
-    void delete_user_database();
-    void delete_user_from_rfid_map(const String &);
-    void delete_user_from_emp_map(const String &);
-    void delete_user_from_log_map(const String &);
 
-    // Retrieve the User based on employee ID
+    // Day whose raw scans are displayed, in days since 1970
     //
-    User* get_key(const String &);
+    uint32_t scan_day;
 
-    // Update the map functionality accordingly
+    // User whose days are displayed and the next segment to look up
+    //
+    UserRecord log_user;
+    uint16_t   log_position;
+    
+    // Log segment helpers
     //
-    void update_start_and_end_time(const String &rfid, const String &date, const String &time);
-    void update_rfid_map(const String &rfid);
-    void update_emp_map(const String &emp);
+    bool next_user_summary(SummaryEntry &entry, UserRecord &user);
+    static String format_date(uint32_t epoch);
+    static String format_time(uint32_t epoch);
     
     // TODO : Reduce the dependency between Database and RTC by separating these APIs
 
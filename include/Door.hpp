@@ -3,6 +3,9 @@
 * @brief Defines the Door class, which manages door operations for an embedded system (Arduino) 
          using a stepper motor. It includes states and
          methods for controlling the door's position and idle timing.
+         The motor is stepped from the step timer interrupt, one step per
+         compare match, following a trapezoidal speed profile; the main
+         loop only starts moves and watches for their end.
 *
 * 
 */
@@ -11,11 +14,16 @@
 #define DOOR_HPP
 
 #include <Arduino.h>
-#include <Stepper.h>
+#include "StepTimer.hpp"
 
 const uint16_t max_steps_per_revolution = 1024;  // Number of steps per revolution
 const uint32_t idle_time = 5000;                 // Idle time in milliseconds (5 seconds)
 
+// Default speed profile of the door motor
+//
+const uint16_t door_max_speed    = 500;          // Cruise speed in steps per second
+const uint16_t door_acceleration = 1000;         // Acceleration in steps per second^2
+
 // Enum for door state
 //
 enum door_state 
@@ -34,9 +42,26 @@ private:
 
     door_state doorstate = CLOSED;      // Initialize door state to CLOSED
     uint32_t start_time = 0;            // Start time for the idle state
-    int current_position = 0;           // Track current position of the door
-    
-    Stepper myStepper = Stepper(max_steps_per_revolution, 6, 8, 7, 9);
+
+    uint16_t max_speed = door_max_speed;
+    uint16_t acceleration = door_acceleration;
+
+    // Motion state shared with the step ISR, the position is only written
+    // by the ISR and read with interrupts disabled
+    //
+    static volatile int16_t position;
+    static volatile int16_t target;
+    static volatile bool    is_moving;
+
+    // Speed profile, intervals in 1/256 us, only used by the ISR during a move
+    //
+    static uint32_t step_interval;      // Interval until the next step
+    static uint32_t min_interval;       // Interval at cruise speed
+    static uint16_t ramp_steps;         // Steps accelerated so far
+
+    void move_to(int16_t);
+    static void step_isr();
+    static void write_coils(uint8_t);
 
 public:
     
@@ -46,6 +71,11 @@ public:
     void run();
     void open();
     void close();
+
+    // Speed profile used by the next move
+    //
+    void set_profile(uint16_t max_speed, uint16_t acceleration);
+    int16_t get_position();
 };
 
 #endif // DOOR_HPP
@@ -0,0 +1,108 @@
+/** @file LogFormat.hpp
+*
+* @brief Defines the binary format of the RFID access log. The file starts
+         with a small header (magic, version, record size) followed by
+         fixed size records, each protected by its own CRC so a torn or
+         corrupted record is skipped instead of breaking the replay.
+         Each log segment has a summary sidecar with the first and last
+         scan and the number of scans of every employee, and the segment
+         offset it covers, so queries and the boot skip the raw records.
+         Also parses the legacy "name,empid,d/m/yyyy,h:m:s" text lines so
+         old logs can be converted, on the board or with tools/LogConvert.
+*
+*
+*/
+
+#ifndef LOG_FORMAT_HPP
+#define LOG_FORMAT_HPP
+
+#include <Arduino.h>
+
+const uint8_t log_format_version = 1;
+const char    log_magic[4]       = { 'A', 'E', 'S', 'L' };
+const char    summary_magic[4]   = { 'A', 'E', 'S', 'M' };
+
+// Event stored in a record
+//
+enum LogEvent : uint8_t
+{
+    LOG_EVENT_ACCESS = 1      // Access granted to a scanned card
+};
+
+// File header, written once when the log is created
+//
+struct LogHeader
+{
+    char     magic[4];
+    uint8_t  version;
+    uint8_t  record_size;
+    uint16_t crc;             // CRC of the bytes before it
+};
+
+// One access, 12 bytes. The user is identified by the numeric employee id,
+// which stays valid when users are added or removed
+//
+struct LogRecord
+{
+    uint32_t empid;
+    uint32_t epoch;           // Unix time of the scan
+    uint8_t  event;           // LogEvent
+    uint8_t  reserved;
+    uint16_t crc;             // CRC of the bytes before it
+};
+
+// Summary header, followed by entry_count entries. Written before the
+// entries, a torn summary fails the entries CRC and is ignored
+//
+struct SummaryHeader
+{
+    char     magic[4];
+    uint8_t  version;
+    uint8_t  entry_size;
+    uint16_t entry_count;
+    uint32_t log_offset;      // Segment bytes covered by the summary, header included
+    uint16_t entries_crc;     // CRC of all the entries
+    uint16_t crc;             // CRC of the bytes before it
+};
+
+// Scans of an employee in one segment
+//
+struct SummaryEntry
+{
+    uint32_t empid;
+    uint32_t first_epoch;
+    uint32_t last_epoch;
+    uint16_t count;
+    uint16_t reserved;
+};
+
+static_assert(sizeof(LogHeader) == 8, "LogHeader layout");
+static_assert(sizeof(LogRecord) == 12, "LogRecord layout");
+static_assert(sizeof(SummaryHeader) == 16, "SummaryHeader layout");
+static_assert(sizeof(SummaryEntry) == 16, "SummaryEntry layout");
+
+// CRC-16/CCITT-FALSE
+//
+uint16_t log_crc16(const uint8_t *data, size_t size);
+uint16_t log_crc16_update(uint16_t crc, const uint8_t *data, size_t size);
+
+// Build and check headers and records
+//
+void log_make_header(LogHeader &header);
+bool log_check_header(const LogHeader &header);
+void log_make_record(LogRecord &record, uint32_t empid, uint32_t epoch, LogEvent event);
+bool log_check_record(const LogRecord &record);
+void log_make_summary_header(SummaryHeader &header, uint16_t entry_count,
+                             uint32_t log_offset, uint16_t entries_crc);
+bool log_check_summary_header(const SummaryHeader &header);
+
+// Date "d/m/yyyy" and time "h:m:s" as written by the firmware to unix time,
+// 0 when they cannot be parsed
+//
+uint32_t log_parse_date_time(const char *date, const char *time);
+
+// Legacy text line "name,empid,d/m/yyyy,h:m:s" to employee id and unix time
+//
+bool log_parse_legacy_line(const char *line, uint32_t &empid, uint32_t &epoch);
+
+#endif  // LOG_FORMAT_HPP
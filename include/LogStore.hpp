@@ -0,0 +1,217 @@
+/** @file LogStore.hpp
+*
+* @brief Defines the LogStore class, a singleton which splits the RFID
+         access log into one segment file per period (a day by default)
+         below temp/logs. Every segment has a summary sidecar holding the
+         first and last scan and the scan count of each employee, so the
+         working hours are answered from the summaries and the raw records
+         are only read when an admin asks for the scans of one day.
+         The employees of the segment being appended to are counted in a
+         fixed table in RAM, sorted by employee id, and merged into its
+         summary file periodically with the segment offset it covers. A
+         day may see any number of employees: when the table is full, it
+         stops counting and the log task merges it into the file a few
+         entries per run, then counts the scans appended meanwhile from
+         their records. A scan never waits for a merge. At boot only the
+         records written after the saved offset are replayed.
+         segments.idx lists the segments in the order they were created.
+         Summary entries are written by employee id, so the entry of one
+         employee is found by a binary search of each summary without
+         reading the others.
+*
+*
+*/
+
+#ifndef LOG_STORE_HPP
+#define LOG_STORE_HPP
+
+#include <Arduino.h>
+#include <SD.h>
+#include "LogFormat.hpp"
+#include "LogWriter.hpp"
+
+// Days covered by one segment
+//
+const uint8_t  log_segment_days = 1;
+
+// The summary of the open segment is saved after this many scans, or once
+// the oldest scan it misses is older than the interval
+//
+const uint16_t summary_save_scans       = 64;
+const uint32_t summary_save_interval_ms = 600000UL;
+
+// Longest segment path, "temp/logs/yyyymmdd.bin"
+//
+const uint8_t  log_segment_path_size = 24;
+
+// Employees counted in RAM since the summary of the open segment was saved,
+// 16 bytes each. One more has the table merged into the summary file
+//
+const uint8_t  summary_table_entries = 32;
+
+// Summary entries merged, or records counted, per run of the log task
+//
+const uint8_t  summary_merge_step = 16;
+
+// Employees counted since the last save, by employee id
+//
+struct SummaryTable
+{
+    SummaryEntry entries[summary_table_entries];
+    uint8_t      count;
+};
+
+class LogStore
+{
+public:
+
+    // Singleton usage method
+    //
+    static LogStore* get_instance();
+
+    // Open the last segment of the index, its summary is loaded and the
+    // records written after it are replayed
+    //
+    bool begin();
+
+    // Remove every segment and the index
+    //
+    void clear();
+
+    // Append a scan to the segment of its date
+    //
+    bool append(uint32_t empid, uint32_t epoch);
+
+    // Bulk import of older logs, the records are written by whole sectors
+    //
+    void begin_import();
+    void end_import();
+
+    // Save the summary when due and run the next step of a merge, called
+    // periodically by the scheduler
+    //
+    void run();
+    bool save_summary();
+
+    // First day, in days since 1970, of the segment holding a unix time
+    //
+    static uint32_t segment_of(uint32_t epoch);
+
+    // Segment at a position of the index, oldest first
+    //
+    uint16_t get_segment_count();
+    bool get_segment(uint16_t position, uint32_t &segment);
+
+    // Summaries of all the segments, oldest segment first and by employee id
+    //
+    void rewind_summaries();
+    bool next_summary(SummaryEntry &entry);
+
+    // Summary entry of one employee in a segment
+    //
+    bool find_summary(uint32_t segment, uint32_t empid, SummaryEntry &entry);
+
+    // Raw records of one segment
+    //
+    bool rewind_records(uint32_t segment);
+    bool next_record(LogRecord &record);
+
+private:
+
+    LogStore();                                     // Private constructor for singleton
+    LogStore(const LogStore &) = delete;
+    LogStore &operator=(const LogStore &) = delete;
+
+    static LogStore* instance;   // Singleton instance
+
+    static void segment_path(uint32_t segment, const char *extension, char *path);
+    bool open_segment(uint32_t segment);
+    bool append_index(uint32_t segment);
+
+    // Summary files
+    //
+    bool open_summary(uint32_t segment, File &file, SummaryHeader &header);
+    static uint16_t seek_summary(File &file, const SummaryHeader &header, uint32_t empid);
+    uint32_t check_summary(uint32_t segment);
+    bool repair_summary(uint32_t segment);
+    bool next_in_segment(uint32_t segment, uint32_t empid, SummaryEntry &entry);
+
+    // Summary table
+    //
+    static uint8_t table_position(const SummaryTable &table, uint32_t empid);
+    static bool add_to_summary(SummaryTable &table, uint32_t empid, uint32_t epoch);
+    static void combine(SummaryEntry &entry, const SummaryEntry &counted);
+
+    // Merge of the table into a summary file and replay of the records it
+    // misses, one step per run of the log task
+    //
+    enum MergeState : uint8_t
+    {
+        MERGE_IDLE,         // The table counts the scans of the open segment
+        MERGE_OPEN,         // The table stopped counting, its merge starts
+        MERGE_COUNT,        // Employees of the table already in the file
+        MERGE_MOVE,         // Entries merged in place from the end of the file
+        MERGE_CRC,          // CRC of the entries, then the final header
+        MERGE_REPLAY        // Records not counted yet are counted from the segment
+    };
+    void start_merge(uint32_t segment, uint32_t offset);
+    void start_replay(uint32_t segment, uint32_t offset);
+    bool merge_step();
+    bool finish_summary();
+    void abort_merge();
+    bool open_merge();
+    bool count_step();
+    bool move_step();
+    bool crc_step();
+    bool replay_step();
+
+    // Segment being appended to and its employees counted since the last
+    // save, also used to repair the summary of a closed segment once saved
+    //
+    bool     is_segment_open;
+    uint32_t open_segment_day;
+    uint32_t open_summary_offset;   // Segment offset covered by the summary file of the open segment
+    SummaryTable summary;
+    uint16_t summary_merges;        // Summary files rewritten, a reader of the open one resumes
+
+    // Merge in progress
+    //
+    MergeState merge_state;
+    uint32_t merge_segment;         // Segment the table counts
+    uint32_t merge_offset;          // Offset covered once merged, then the next record to count
+    File     merge_file;
+    uint16_t merge_saved;           // Entries of the file before the merge
+    uint16_t merge_total;           // Entries of the file after the merge
+    uint16_t merge_position;        // File entries counted, left to move, or in the CRC
+    uint8_t  merge_entry;           // Table entries counted or left to move
+    uint16_t merge_at;              // Next entry written by the move
+    uint16_t merge_crc;
+    uint16_t replay_corrupted;      // Corrupted records skipped by the replay
+
+    // Scans appended since the summary was saved and the time of the first one
+    //
+    uint16_t scans_since_save;
+    uint32_t first_unsaved_scan_ms;
+
+    // Durability of the writer before an import
+    //
+    LogWriter::Durability import_durability;
+    uint16_t              import_interval;
+
+    // Summary cursor
+    //
+    File     index_file;            // Index, positioned on the next segment
+    bool     is_summary_segment;    // A segment is being read
+    bool     is_summary_open;       // The segment is the open one, its file may be rewritten
+    uint32_t summary_segment;       // Segment being read
+    uint32_t summary_empid;         // Employee id after the last entry read
+    uint16_t summary_seen_merges;   // summary_merges when the file was opened
+    uint16_t summary_left;          // Entries left in the summary file
+    File     summary_file;
+
+    // Records cursor
+    //
+    File     records_file;
+};
+
+#endif  // LOG_STORE_HPP
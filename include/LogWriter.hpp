@@ -0,0 +1,104 @@
+/** @file LogWriter.hpp
+*
+* @brief Defines the LogWriter class, a singleton which appends records to
+         the binary RFID log. The file stays open and records are collected
+         in a sector sized buffer, so a scan no longer pays for opening,
+         flushing and closing the file. The buffer is written to the card
+         according to the durability mode: after every record, once the
+         oldest buffered record is older than an interval, or only when a
+         full sector is buffered. sync() forces the buffer out at any time.
+*
+*
+*/
+
+#ifndef LOG_WRITER_HPP
+#define LOG_WRITER_HPP
+
+#include <Arduino.h>
+#include <SD.h>
+#include "LogFormat.hpp"
+
+// Records buffered before they are written, 42 records fill one 512 byte sector
+//
+const uint8_t  log_writer_buffer_records = 42;
+
+// Default age of the oldest buffered record before the buffer is synced
+//
+const uint16_t log_writer_sync_interval_ms = 1000;
+
+class LogWriter
+{
+public:
+
+    // When the buffered records reach the card
+    //
+    enum Durability : uint8_t
+    {
+        SYNC_EVERY_RECORD,    // Written and flushed by append()
+        SYNC_INTERVAL,        // Flushed by run() once the oldest record is interval_ms old
+        SYNC_FULL_SECTOR      // Flushed only when the buffer is full
+    };
+
+    // Singleton usage method
+    //
+    static LogWriter* get_instance();
+
+    // Open the log for appending, the header is written when the file is new
+    //
+    bool open(const char *path);
+    void close();
+    bool is_open() const;
+
+    // Size of the log on the card, records still buffered excluded
+    //
+    uint32_t size();
+
+    // Offset of the next record, records still buffered included
+    //
+    uint32_t end_offset();
+
+    // Queue a record, it is written according to the durability mode
+    //
+    bool append(const LogRecord &record);
+
+    // Write and flush the buffered records
+    //
+    void sync();
+
+    // Check the time threshold, called periodically by the scheduler
+    //
+    void run();
+
+    // Durability mode, SYNC_INTERVAL by default
+    //
+    void set_durability(Durability mode, uint16_t interval = log_writer_sync_interval_ms);
+    Durability get_durability() const;
+    uint16_t get_sync_interval() const;
+
+    // Statistics of the writes to the card
+    //
+    void reset_stats();
+    void print_stats();
+
+private:
+
+    LogWriter();                                      // Private constructor for singleton
+    LogWriter(const LogWriter &) = delete;
+    LogWriter &operator=(const LogWriter &) = delete;
+
+    static LogWriter* instance;   // Singleton instance
+
+    File       file;
+    Durability durability;
+    uint16_t   interval_ms;
+
+    LogRecord  buffer[log_writer_buffer_records];
+    uint8_t    buffered;
+    uint32_t   first_buffered_ms;   // Time the oldest buffered record was appended
+
+    uint32_t   records;             // Records appended
+    uint32_t   flushes;             // Buffers flushed to the card
+    uint32_t   bytes_written;       // Bytes written to the card, header included
+};
+
+#endif  // LOG_WRITER_HPP
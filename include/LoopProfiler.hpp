@@ -0,0 +1,106 @@
+/** @file LoopProfiler.hpp
+*
+* @brief Defines the LoopProfiler class, a singleton that measures how long
+         every task of the main loop() runs. For each task it keeps the
+         min/avg/max execution time and a histogram with power of two
+         buckets, and for the loop itself the number of passes so the loop
+         frequency can be reported in the admin terminal. The duration of
+         each phase of setup() is kept for the boot report. The heap
+         allocations of every task and boot phase are counted as well, when
+         the build counts them (see MemoryStats.hpp).
+*
+*
+*/
+
+#ifndef LOOP_PROFILER_HPP
+#define LOOP_PROFILER_HPP
+
+#include <Arduino.h>
+
+// Number of histogram buckets: bucket 0 holds runs below 64 us, bucket n
+// holds runs in [2^(n+5), 2^(n+6)) us and the last one everything above
+//
+const uint8_t profiler_bucket_count      = 18;
+const uint8_t profiler_first_bucket_log2 = 6;
+const uint8_t profiler_boot_phases       = 8;   // Phases of setup() which are reported
+
+class LoopProfiler
+{
+public:
+
+    // Tasks executed by loop(), TASK_LOOP measures a whole pass
+    //
+    enum Task : uint8_t
+    {
+        TASK_USER_OPERATION,
+        TASK_ADMIN_OPERATION,
+        TASK_BUTTON,
+        TASK_DOOR,
+        TASK_SCREEN,
+        TASK_LOG,
+        TASK_STORE,
+        TASK_MEMORY,
+        TASK_LOOP,
+        TASK_COUNT
+    };
+
+    // Singleton usage method
+    //
+    static LoopProfiler* get_instance();
+
+    // Measurement APIs called around every task
+    //
+    void begin_task(Task task);
+    void end_task(Task task);
+
+    // Reset all the statistics and restart the frequency measurement
+    //
+    void reset();
+
+    // Display the statistics in the terminal, the histogram apart
+    //
+    void print_stats();
+    void print_histogram();
+    static const char* task_name(Task task);
+
+    // Boot report, each call closes the phase which started at the previous one
+    //
+    void end_boot_phase(const char *name);
+    void print_boot_report();
+
+private:
+
+    // Statistics of one task
+    //
+    struct TaskStats
+    {
+        uint32_t count;
+        uint32_t min_us;
+        uint32_t max_us;
+        uint64_t total_us;
+        uint32_t allocs;              // Heap allocations made by the task
+        uint16_t histogram[profiler_bucket_count];
+    };
+
+    LoopProfiler();                                         // Private constructor for singleton
+    LoopProfiler(const LoopProfiler &) = delete;
+    LoopProfiler &operator=(const LoopProfiler &) = delete;
+
+    static uint8_t bucket_of(uint32_t duration_us);
+
+    static LoopProfiler* instance;    // Singleton instance
+
+    TaskStats stats[TASK_COUNT];
+    uint32_t  task_start_us[TASK_COUNT];
+    uint32_t  task_start_allocs[TASK_COUNT];
+    uint32_t  reset_us;               // Time of the last reset, base of the loop frequency
+
+    const char *boot_phase_name[profiler_boot_phases];
+    uint32_t    boot_phase_us[profiler_boot_phases];
+    uint32_t    boot_phase_allocs[profiler_boot_phases];
+    uint8_t     boot_phase_count;
+    uint32_t    boot_mark_us;         // End of the previous boot phase
+    uint32_t    boot_mark_allocs;
+};
+
+#endif  // LOOP_PROFILER_HPP
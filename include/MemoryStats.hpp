@@ -0,0 +1,86 @@
+/** @file MemoryStats.hpp
+*
+* @brief Heap allocation counter, used to check that a card scan does not
+         touch the heap: after weeks of uptime a fragmented heap is what
+         locks a unit up. On the board malloc and realloc are wrapped by
+         the linker when MEMORY_ALLOC_COUNT is defined (megaatmega2560_debug
+         environment), otherwise nothing is counted. On the native build
+         the String fake counts the buffers the AVR core would allocate.
+
+         Defines as well the MemoryStats class, a singleton sampling the
+         free RAM of the board from loop(): the gap between the heap and
+         the stack with the blocks of the heap free list, the largest
+         block malloc would hand out, and the stack headroom, the bytes
+         between the heap and the deepest point the stack reached since
+         the boot. The RAM above the static data is painted before main()
+         and the headroom is the run of paint left untouched. A headroom
+         or free RAM below memory_alarm_bytes is logged to the SD card.
+         These measures are only taken on the board.
+*
+*
+*/
+
+#ifndef MEMORY_STATS_HPP
+#define MEMORY_STATS_HPP
+
+#include <Arduino.h>
+
+// Heap allocations since the boot, 0 when they are not counted
+//
+uint32_t memory_alloc_count();
+
+// Period of the memory task, the headroom scan walks the free RAM
+//
+const uint16_t memory_sample_period_ms = 1000;
+
+// Free RAM or stack headroom below which an alarm is logged, and the RAM to
+// recover before another one is
+//
+const uint16_t memory_alarm_bytes      = 512;
+const uint16_t memory_alarm_hysteresis = 128;
+
+class MemoryStats
+{
+public:
+
+    // Singleton usage method
+    //
+    static MemoryStats* get_instance();
+
+    // Take a sample, called from loop() by the memory task
+    //
+    void sample();
+
+    // Statistics of the samples, the stack headroom is kept since the boot
+    //
+    void reset_stats();
+    void print_stats();
+
+private:
+
+    MemoryStats();                                      // Private constructor for singleton
+    MemoryStats(const MemoryStats &) = delete;
+    MemoryStats &operator=(const MemoryStats &) = delete;
+
+    static MemoryStats* instance;   // Singleton instance
+
+    // Measures of the board, false on the native build
+    //
+    static bool is_measured();
+    static uint16_t free_ram();
+    static uint16_t largest_block();
+    static uint16_t stack_headroom();
+
+    void check_alarm();
+
+    uint32_t samples;
+    uint16_t last_free_ram;
+    uint16_t min_free_ram;          // Since the last reset
+    uint16_t last_largest_block;
+    uint16_t min_largest_block;     // Since the last reset
+    uint16_t min_headroom;          // Since the boot
+    uint16_t alarms;                // Alarms logged since the boot
+    bool     is_alarmed;            // Low on RAM since the last alarm
+};
+
+#endif  // MEMORY_STATS_HPP
@@ -0,0 +1,107 @@
+/** @file NamePool.hpp
+*
+* @brief Defines the NamePool class, a singleton arena holding the names and
+         passwords kept in RAM: the admin records loaded from the SD card
+         and the users of the UID cache. Each text is stored once, with a
+         reference count, and referred to by a 16 bit handle, so equal
+         texts are shared and no String buffer is left on the heap per
+         record. The names freed by a removed user or an evicted card are
+         compacted away, the handles staying the same.
+*
+*
+*/
+
+#ifndef NAME_POOL_HPP
+#define NAME_POOL_HPP
+
+#include <Arduino.h>
+
+// Bytes of the arena, a name takes its length plus 3
+//
+const uint16_t name_pool_size  = 384;
+
+// Names held at once, the admins and the UID cache entries
+//
+const uint8_t  name_pool_slots = 40;
+
+// Handle of no name, when the pool is full
+//
+const uint16_t name_pool_none  = 0xFFFF;
+
+// Bytes a String costs per reference on the AVR core, its object and the
+// header of its heap buffer, used to report the saving of the pool
+//
+const uint8_t  name_string_overhead = 8;
+
+class NamePool
+{
+public:
+
+    // Singleton usage method
+    //
+    static NamePool* get_instance();
+
+    // Handle of the text, shared with an equal one already held,
+    // name_pool_none when the pool is full
+    //
+    uint16_t intern(const char *text);
+
+    // References of a handle, the text is freed with its last one
+    //
+    void retain(uint16_t handle);
+    void release(uint16_t handle);
+
+    // Text of a handle, empty for name_pool_none
+    //
+    const char* get(uint16_t handle) const;
+
+    // Squeeze the freed texts out of the arena
+    //
+    void compact();
+
+    // Statistics of the pool
+    //
+    void reset_stats();
+    void print_stats();
+
+private:
+
+    NamePool();                                     // Private constructor for singleton
+    NamePool(const NamePool &) = delete;
+    NamePool &operator=(const NamePool &) = delete;
+
+    static NamePool* instance;   // Singleton instance
+
+    // A text is stored as its reference count, its slot and its characters
+    // with the terminating zero, the count being 0 once freed
+    //
+    char     arena[name_pool_size];
+    uint16_t offsets[name_pool_slots];   // Offset of each text, name_pool_none when free
+    uint16_t used;                       // Bytes from the start of the arena, freed texts included
+    uint16_t freed;                      // Bytes of the freed texts
+
+    uint32_t shared;             // Texts found already held
+    uint32_t compactions;        // Arena compactions
+    uint32_t failures;           // Texts refused, the pool being full
+};
+
+// Name held in the pool, copied by reference
+//
+class PooledName
+{
+public:
+
+    PooledName() : handle(name_pool_none) {}
+    PooledName(const PooledName &other);
+    PooledName &operator=(const PooledName &other);
+    ~PooledName();
+
+    bool set(const char *text);     // False and left empty when the pool is full
+    const char* c_str() const;
+
+private:
+
+    uint16_t handle;
+};
+
+#endif  // NAME_POOL_HPP
@@ -9,6 +9,7 @@
 #define PERSON_HPP
 
 #include <Arduino.h>
+#include "NamePool.hpp"
 
 // Class representing a person
 //
@@ -18,16 +19,16 @@ public:
     virtual ~Person() {}
     virtual void authenticate() = 0;
     
-    // Set the name of the person
+    // Set the name of the person, false when the name pool is full
     //
-    virtual void set_name(const String& person_name);
+    virtual bool set_name(const String& person_name);
     
     // Retrieve the name of the person
     //
     virtual String get_name() const;
 
 protected:
-    String name;  // Person's name
+    PooledName name;  // Person's name, held in the name pool
 };
 
 #endif  // End of PERSON_HPP
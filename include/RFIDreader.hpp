@@ -1,7 +1,9 @@
 /** @file RFIDreader.hpp
 *
 * @brief Define a RFID reader class to handle rfid 
-         scan related functionality and APIs 
+         scan related functionality and APIs. Cards are detected either
+         by polling with REQA or, in IRQ mode, by arming a REQA with the
+         receive interrupt enabled and waiting for the reader IRQ line.
 *
 * 
 */
@@ -12,17 +14,57 @@
 #include <Arduino.h>
 #include <SPI.h>
 #include <MFRC522.h>
+#include "ScanRecord.hpp"
 
 // Define RFID reader pins (make sure to define SS_PIN and RST_PIN in your code)
 //
 #define RST_PIN 5      // RST pin for RFID
 #define SS_PIN 53      // Slave Select pin for RFID
+#define IRQ_PIN 3      // IRQ output of the RFID reader, external interrupt 1
+
+const uint16_t rfid_detect_period_ms = 50;   // Time between two REQA, polled or armed
+const uint8_t  rfid_card_queue_size  = 4;    // Cards read from the field at once
+
+class AuthenticationService;
 
 class RFIDreader 
 {
 
 public:
 
+    // Stages of a scan, the UID is known after the select and the card
+    // sector is only authenticated and read when the UID cache misses
+    //
+    enum ScanStage : uint8_t
+    {
+        STAGE_SELECT,       // Anticollision and select
+        STAGE_RESOLVE,      // UID cache lookup
+        STAGE_AUTH,         // Authentication of sector 2
+        STAGE_READ,         // Reads of blocks 8 and 9
+        STAGE_DECIDE,       // Access decision
+        STAGE_COUNT
+    };
+
+    // Result of writing a card, see encode_next_card()
+    //
+    enum EncodeStatus : uint8_t
+    {
+        ENCODE_IDLE,
+        ENCODE_PENDING,     // Waiting for a card in the field
+        ENCODE_V2,          // Written in the single block format
+        ENCODE_V1,          // Name too long for version 2, written as text
+        ENCODE_NOT_BLANK,   // Card of another employee, left as it was
+        ENCODE_FAILED       // Not written, or different when read back
+    };
+
+    // How a new card in the field is noticed
+    //
+    enum DetectMode
+    {
+        DETECT_POLLING,     // REQA and wait for the answer on every read
+        DETECT_IRQ          // Only touch the card once the IRQ line fired
+    };
+
     static RFIDreader *get_instance();    // Singleton pattern to get RFID reader instance
     void release_instance();              // Release RFID reader instance
     void set_tag(const char *tag);        // Set the RFID tag
@@ -30,16 +72,39 @@ public:
     void remove_tag();                    // Remove the RFID tag
     String scan_card();                   // Scan an RFID card
 
-    void set_current_date(String&);  // Setter Current Date
-    void set_current_time(String&);  // Setter Current Time
+    void set_scan_time(uint32_t epoch);   // Time of the decision of the scanned card
+    const ScanRecord& get_scan();         // Scanned card
 
-    String& get_current_date();      // Getter Current Date
-    String& get_current_time();      // Setter Current Time
-    String handleCardRead();         // Card read functionality
+    bool handleCardRead();           // Card read functionality, true once a card is scanned
+    bool next_queued_card();         // Next card read together with the last one
     
     void set_is_scan_card(bool);     // Setter for scan card
     bool get_is_scan_card();         // Getter for scan card
 
+    bool set_detect_mode(DetectMode);   // Falls back to polling without IRQ pin
+    DetectMode get_detect_mode();       // Getter for detect mode
+
+    void set_uid_cache(AuthenticationService *);   // Cards it knows are not read
+    const byte* get_uid();                         // UID of the scanned card
+    byte get_uid_size();                           // Size of the UID of the scanned card
+    void record_allocs(uint32_t allocs);           // Heap allocations of one scan, expected 0
+
+    // Card encoder, the next blank card or card of the same employee in the
+    // field is written instead of read
+    //
+    void encode_next_card(const String &name, uint32_t empid);
+    void cancel_encoding();
+    EncodeStatus get_encode_status();
+    const byte* get_encode_uid();                  // UID of the card written or refused
+    byte get_encode_uid_size();
+
+    // Timing of the scan stages
+    //
+    void record_stage(ScanStage stage, uint32_t elapsed_us);
+    void reset_stats();
+    void print_stats();
+    static const char* stage_name(ScanStage stage);
+
 private:
 
     RFIDreader();                      // Private constructor
@@ -49,19 +114,53 @@ private:
     RFIDreader &operator=(const RFIDreader &) = delete;  // Delete assignment operator
 
     void initializeRFID();
+
+    // IRQ mode helpers
+    //
+    void arm_card_irq();
+    static void card_irq_isr();
     
     // Helper functions
     //
-    String readName(byte blockAddr);
-    String readEmpID(byte blockAddr);
+    bool read_block(byte blockAddr, byte *buffer);
+    bool read_card();
+    void queue_card(const char *card_key);
+    bool is_card_writable();
+    void write_card();
+    static void block_text(const byte *buffer, char *text);
+
+    // Statistics of one scan stage
+    //
+    struct StageStats
+    {
+        uint32_t count;
+        uint32_t max_us;
+        uint32_t total_us;
+    };
 
     static MFRC522 mfrc522;               // MFRC522 instance
     static MFRC522::MIFARE_Key key;       // MFRC522 key
     static RFIDreader *instance;          // Singleton instance
     static bool is_scan_card ;            // scanned or not 
-    String rfid_tag;                      // RFID tag storage
-    String current_date;                  // Current Date Storage
-    String current_time;                  // Current Time Storage
+    static volatile bool is_card_pending; // IRQ line fired since the last arm
+    DetectMode detect_mode;               // Card detection mode
+    AuthenticationService *uid_cache;     // Decisions of the recent cards, may be nullptr
+    uint32_t request_at_ms;               // Time of the last REQA
+    EncodeStatus encode_status;           // Card encoder state
+    String encode_name;                   // User to write on the next card
+    uint32_t encode_empid;
+    byte encode_uid[scan_uid_size];       // Card the encoder last wrote or refused
+    byte encode_uid_size;
+    StageStats stage_stats[STAGE_COUNT];  // Time spent in every scan stage
+    uint32_t cached_scans;                // Scans resolved from the UID
+    uint32_t read_scans;                  // Scans which read the card sector
+    uint32_t v2_scans;                    // Read scans of version 2 cards
+    uint32_t queued_scans;                // Cards read after another one in the field
+    uint32_t scan_allocs;                 // Heap allocations on the scan path, expected 0
+    ScanRecord card_queue[rfid_card_queue_size];  // Cards read from the field at once
+    uint8_t queue_size;
+    uint8_t queue_next;                   // Next card of the queue to hand out
+    ScanRecord current_card;              // Card being decided, its key is the tag
 
 };
 
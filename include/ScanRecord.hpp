@@ -0,0 +1,30 @@
+/** @file ScanRecord.hpp
+*
+* @brief Defines the ScanRecord, a card scan carried from the RFIDreader
+         through UserAccessControl to the Database and the Screen. It holds
+         its text in fixed arrays, so a scan never allocates on the heap.
+*
+*
+*/
+
+#ifndef SCAN_RECORD_HPP
+#define SCAN_RECORD_HPP
+
+#include <Arduino.h>
+#include "CardFormat.hpp"
+
+// Longest UID of a card, triple size
+//
+const uint8_t scan_uid_size = 10;
+
+// A card read from the field, waiting for or going through its decision
+//
+struct ScanRecord
+{
+    byte     uid[scan_uid_size];
+    uint8_t  uid_size;
+    char     key[card_key_size];      // "name,empid", empty when the card could not be read
+    uint32_t epoch;                   // Unix time of the decision, set when access is granted
+};
+
+#endif  // SCAN_RECORD_HPP
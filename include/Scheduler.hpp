@@ -0,0 +1,71 @@
+/** @file Scheduler.hpp
+*
+* @brief Defines the Scheduler class, a singleton cooperative scheduler
+         which replaces the fixed round-robin of loop(). Every subsystem
+         registers a task with a period and a priority; each call to run()
+         executes the released task with the earliest deadline (release +
+         period), the priority breaking ties. A task that finishes after
+         its deadline is counted as an overrun.
+*
+*
+*/
+
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <Arduino.h>
+#include "LoopProfiler.hpp"
+
+const uint8_t scheduler_max_tasks = 8;   // Maximum number of registered tasks
+
+// Function executed by a task
+//
+typedef void (*task_function)();
+
+class Scheduler
+{
+public:
+
+    // Singleton usage method
+    //
+    static Scheduler* get_instance();
+
+    // Register a task, priority 0 is the most important
+    //
+    bool add_task(task_function function, uint16_t period_ms, uint8_t priority, LoopProfiler::Task profile);
+
+    // Run the released task with the earliest deadline, if any
+    //
+    void run();
+
+    // Overrun statistics
+    //
+    void reset_stats();
+    void print_stats();
+
+private:
+
+    // Registered task
+    //
+    struct TaskEntry
+    {
+        task_function      function;
+        uint32_t           period_us;
+        uint32_t           release_us;     // Next time the task may run
+        uint8_t            priority;
+        LoopProfiler::Task profile;        // Profiler slot the run time is recorded in
+        uint32_t           runs;
+        uint16_t           overruns;       // Runs finished after their deadline
+    };
+
+    Scheduler();                                      // Private constructor for singleton
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    static Scheduler* instance;   // Singleton instance
+
+    TaskEntry tasks[scheduler_max_tasks];
+    uint8_t   task_count;
+};
+
+#endif  // SCHEDULER_HPP
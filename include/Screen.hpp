@@ -1,7 +1,12 @@
 /** @file Screen.hpp
 *
 * @brief Define a Screen class to handle display 
-         related functionality and APIs 
+         related functionality and APIs. Pages shown on the lcd are
+         queued as timed frames; run() is ticked by the scheduler and
+         draws the next frame once the current one has been shown long
+         enough, so no print API waits for the display. A shadow copy of
+         the display is kept and only the cells which changed are sent
+         over I2C, the display is never cleared to draw a frame.
 *
 * 
 */
@@ -12,6 +17,11 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include "LiquidCrystal_I2C.h"
+#include "ScanRecord.hpp"
+
+const uint8_t screen_cols       = 16;   // Columns of the lcd display
+const uint8_t screen_rows       = 2;    // Rows of the lcd display
+const uint8_t screen_queue_size = 4;    // Frames waiting to be displayed
 
 // Singleton class representing the screen display
 //
@@ -27,15 +37,48 @@ public:
     //
     void print_line(uint8_t , uint8_t , const char *);
     void print_access_granted(const String& , const String& );
-    void print_access_granted(const String&, const String& , const String& );
+    void print_access_granted(const ScanRecord& );
     void print_access_denied();
     void print_idle_state();
     void print_register_user_state(const String& );
     void display_menu_page(uint8_t );
     void clear_screen();
     void display_menu_page_console();
+
+    // Advance the frame queue, called periodically by the scheduler
+    //
+    void run();
+    bool is_busy() const;
+
+    // Bus traffic to the lcd display
+    //
+    uint32_t get_i2c_bytes() const;
+    void reset_i2c_bytes();
     
 private:
+
+    // One page of the lcd display and how long it stays visible
+    //
+    struct Frame
+    {
+        char     cells[screen_rows][screen_cols];
+        uint16_t hold_ms;                 // 0 keeps the frame until the next one
+    };
+
+    // Steps of drawing a frame, one row per run() so a tick stays short
+    //
+    enum DrawStep : uint8_t
+    {
+        DRAW_ROW_0,
+        DRAW_ROW_1,
+        DRAW_DONE
+    };
+
+    // Frame queue handling
+    //
+    void push_frame(const char *, uint8_t, const char *, uint8_t, uint16_t);
+    void flush_frames();
+    void draw_row(uint8_t);
     
     // Privatizaiton of the construtor and destructor for the Singleton class
     //
@@ -51,6 +94,21 @@ private:
     // I2C display object
     //
     LiquidCrystal_I2C lcd;
+
+    // Frame queue, current is the frame on the display
+    //
+    Frame    frames[screen_queue_size];
+    uint8_t  frame_head;                  // Oldest queued frame
+    uint8_t  frame_count;                 // Queued frames, not counting the current one
+    Frame    current;
+    DrawStep draw_step;
+    uint32_t shown_at_ms;                 // Time the current frame was completely drawn
+    bool     is_idle;                     // Idle page is on the display or queued
+
+    // Cells as they are on the display, and lcd bytes sent since the reset
+    //
+    char     shadow[screen_rows][screen_cols];
+    uint32_t lcd_bytes;
 };
 
 #endif  // End of SCREEN_HPP
@@ -0,0 +1,37 @@
+/** @file StepTimer.hpp
+*
+* @brief Declares the step timer, a periodic compare match interrupt
+         (Timer1 in CTC mode on the Arduino Mega) used to generate motor
+         steps without blocking the main loop. The period can be changed
+         from the ISR itself to shape the speed profile.
+*
+*
+*/
+
+#ifndef STEP_TIMER_HPP
+#define STEP_TIMER_HPP
+
+#include <Arduino.h>
+
+// Resolution and range of the timer, prescaler 64 at 16 MHz
+//
+const uint32_t step_timer_tick_us    = 4;
+const uint32_t step_timer_max_period = 65536UL * step_timer_tick_us;
+
+// Function executed on every compare match, in interrupt context
+//
+typedef void (*step_timer_isr)();
+
+// Start the timer, the ISR first runs one period from now
+//
+void step_timer_start(uint32_t period_us, step_timer_isr isr);
+
+// Change the period, called from the ISR it applies to the next step
+//
+void step_timer_set_period(uint32_t period_us);
+
+// Stop the timer, can be called from the ISR
+//
+void step_timer_stop();
+
+#endif  // STEP_TIMER_HPP
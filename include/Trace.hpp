@@ -0,0 +1,20 @@
+/** @file Trace.hpp
+*
+* @brief Trace points on the scan path. On the native build they are
+*        reported to the benchmark harness through HostHal, on the board
+*        they compile to nothing.
+*
+*
+*/
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#ifdef NATIVE_HAL
+#include <HostHal.h>
+#define TRACE_EVENT(event) host::trace(host::event)
+#else
+#define TRACE_EVENT(event)
+#endif
+
+#endif  // End of TRACE_HPP
@@ -16,12 +16,12 @@
 class User : public Person 
 {
 public:
-    void set_rfid(const String& rfid);      // Set the RFID tag
+    bool set_rfid(const String& rfid);      // Set the RFID tag, false when the name pool is full
     String get_rfid() const;                // Retrieve the RFID tag
     void authenticate();                    // Authenticate the user using RFID
 
 private:
-    String rfid_tag;                        // RFID tag of the user
+    PooledName rfid_tag;                    // RFID tag of the user, held in the name pool
 };
 
 #endif  // End of USER_HPP
@@ -36,7 +36,7 @@ public:
 
     // Function to authenticate a user based on the RFID tag
     //
-    bool user_auth_function(Database *db, RFIDreader *rfid_reader, Screen *screen ,AuthenticationService & auth);
+    bool user_auth_function(RFIDreader *rfid_reader, AuthenticationService & auth);
 
 private:
     
@@ -0,0 +1,116 @@
+/** @file UserFilter.hpp
+*
+* @brief Defines the UserFilter class, a singleton Bloom filter over the card
+         keys of the registered users, kept in RAM and sized from the user
+         count. A card it rejects is certainly not registered, so most
+         unknown cards are turned away without a lookup in the user store
+         and without reading the SD card. A card it passes is looked up as
+         before, a small share of them being false positives.
+         The bits are allocated by a rebuild at the size of the users, and
+         only allocated again when they outgrow the block. A rebuild, when
+         users outgrow the filter or enough were
+         removed, runs a few users per call of run() from the store task;
+         every card passes meanwhile. The removed users are kept in a small
+         second filter so that their cards, which still pass, are not
+         counted as false positives.
+*
+*
+*/
+
+#ifndef USER_FILTER_HPP
+#define USER_FILTER_HPP
+
+#include <Arduino.h>
+#include "UserStore.hpp"
+
+// Bits per user, about 2% false positives with the matching number of hashes
+//
+const uint8_t  user_filter_bits_per_user = 8;
+
+// Bounds of the filter size, the false positives rise above the largest one
+// once more than about a thousand users are registered
+//
+const uint16_t user_filter_min_bytes = 32;
+const uint16_t user_filter_max_bytes = 1024;
+
+const uint8_t  user_filter_max_hashes = 8;
+
+// Users set per call of run() while the filter is rebuilt
+//
+const uint8_t  user_filter_build_step = 16;
+
+// Filter of the users removed since the last build, only used to tell their
+// cards from the false positives
+//
+const uint8_t  user_filter_stale_bytes  = 64;
+const uint8_t  user_filter_stale_hashes = 2;
+
+class UserFilter
+{
+public:
+
+    // Singleton usage method
+    //
+    static UserFilter* get_instance();
+
+    // Size the filter from the users of the store and set their bits, at
+    // once at boot or a few users per call of run()
+    //
+    void build();
+    void start_build();
+    void run();
+    bool is_building() const;
+
+    // Keep the filter in step with the store, called after a successful change
+    //
+    void add(const char *name, uint32_t empid);
+    void remove(const char *name, uint32_t empid);
+
+    // False when the card is certainly not registered
+    //
+    bool might_contain(const char *key);
+
+    // Count a passed card which the store did not find, a false positive
+    // unless it belongs to a removed user
+    //
+    void count_false_positive(const char *key);
+
+    // Statistics of the filter
+    //
+    void reset_stats();
+    void print_stats();
+
+private:
+
+    UserFilter();                                       // Private constructor for singleton
+    UserFilter(const UserFilter &) = delete;
+    UserFilter &operator=(const UserFilter &) = delete;
+
+    static UserFilter* instance;  // Singleton instance
+
+    static uint32_t hash(const char *name, uint8_t name_length, uint32_t empid);
+    static void set_bits(uint8_t *array, uint16_t bytes, uint8_t count,
+                         const char *name, uint8_t name_length, uint32_t empid);
+    static bool test_bits(const uint8_t *array, uint16_t bytes, uint8_t count,
+                          const char *name, uint8_t name_length, uint32_t empid);
+    float estimated_fp_rate() const;
+
+    uint8_t *bits;                // The first size bytes of the block are used
+    uint16_t allocated;           // Bytes of the block
+    uint8_t  stale_bits[user_filter_stale_bytes];  // Users removed since the last build
+    uint16_t size;                // Bytes of bits, 0 until built and every card then passes
+    uint8_t  hashes;              // Bits set per user
+    bool     is_built;            // False while rebuilt, every card then passes
+    uint32_t build_empid;         // Next employee id to set while rebuilt
+    uint32_t capacity;            // Users the size was chosen for
+    uint32_t users;               // Users added since the last build
+    uint32_t stale;               // Users removed, their bits stay set
+
+    uint32_t rejected;            // Cards rejected by the filter
+    uint32_t passed;              // Cards passed to the store
+    uint32_t false_positives;     // Passed cards the store did not find
+    uint32_t stale_hits;          // Passed cards of removed users
+    uint32_t builds;              // Rebuilds started since the boot
+};
+
+#endif  // USER_FILTER_HPP
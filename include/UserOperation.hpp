@@ -45,7 +45,6 @@ private:
     Screen* p_screen;
     static AuthenticationService* p_auth;
     static Door* p_door;
-    static String uid;
 };
 
 #endif // USEROPERATION_HPP
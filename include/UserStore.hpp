@@ -0,0 +1,294 @@
+/** @file UserStore.hpp
+*
+* @brief Defines the UserStore class, a singleton keeping the registered
+         users in a B+tree stored on the SD card (temp/users.db), keyed by
+         the employee id. Pages are 512 byte sectors: page 0 holds the tree
+         metadata, the leaves hold the user records and the inner pages the
+         first employee id below each child. A change to a single leaf is
+         written in place; a split writes the halves and every page above
+         them to new pages, which the tree on the card only references once
+         the metadata pointing to the new root is written. Only a few
+         pages are cached in RAM, so memory does not grow with the number
+         of users and a lookup reads at most one page per tree level.
+         A card key "name,empid" carries the employee id, it is looked up
+         in the same tree and the name is verified against the record.
+         A removal takes the record out of its leaf at once; leaves are not
+         merged, so once enough users were removed the tree is rebuilt
+         densely into a spare file, a few pages per call of run(). Its
+         metadata is written last with a newer generation, which makes it
+         the tree in place of the old file (the SD library cannot rename).
+*
+*
+*/
+
+#ifndef USER_STORE_HPP
+#define USER_STORE_HPP
+
+#include <Arduino.h>
+#include <SD.h>
+
+const uint8_t  user_store_version = 1;
+const char     user_store_magic[4] = { 'A', 'E', 'S', 'U' };
+
+// Longest name, one 16 byte block of the card, and its terminator
+//
+const uint8_t  user_name_size = 17;
+
+// Page size, one sector of the card
+//
+const uint16_t user_page_size = 512;
+
+// Pages cached in RAM, a parent and a child: the pages of a split that do
+// not fit are written through to their new place at the end of the file
+//
+const uint8_t  user_store_cache_pages = 2;
+
+// Users copied at once from a leaf by the filter rebuild, so the path from
+// the root is not walked again for each of them
+//
+const uint8_t  user_store_read_batch = 4;
+
+// Deepest tree, 21 users per leaf and 63 children per inner page
+//
+const uint8_t  user_store_max_height = 5;
+
+// Users removed before the tree is compacted, and at least a quarter of the
+// users left
+//
+const uint16_t user_store_compact_removed = 64;
+
+// Pages left behind by the splits, beyond those the users can fill, before
+// the tree is compacted
+//
+const uint16_t user_store_compact_garbage = 128;
+
+// Records per leaf and branches per inner page of a compacted tree, room is
+// left for the next additions
+//
+const uint8_t  user_compact_leaf_fill  = 16;
+const uint8_t  user_compact_inner_fill = 48;
+
+// Branches written per compaction step, each one reads the page of a child
+//
+const uint8_t  user_compact_branch_step = 8;
+
+// A registered user, 24 bytes
+//
+struct UserRecord
+{
+    uint32_t empid;
+    char     name[user_name_size];
+    uint8_t  since_day[3];            // Day registered since 1970, little endian, 0 when unknown
+};
+
+// First employee id of a child subtree and its page
+//
+struct UserBranch
+{
+    uint32_t empid;
+    uint32_t page;
+};
+
+enum UserPageType : uint8_t
+{
+    USER_PAGE_LEAF  = 1,
+    USER_PAGE_INNER = 2
+};
+
+const uint8_t  user_leaf_records  = (user_page_size - 4) / sizeof(UserRecord);
+const uint8_t  user_inner_branches = (user_page_size - 4) / sizeof(UserBranch);
+
+// A page of the tree
+//
+struct UserPage
+{
+    uint8_t  type;            // UserPageType
+    uint8_t  count;           // Records or branches used
+    uint16_t reserved;
+    union
+    {
+        UserRecord records[user_leaf_records];
+        UserBranch branches[user_inner_branches];
+    };
+    uint8_t  padding[user_page_size - 4 - user_inner_branches * sizeof(UserBranch)];
+};
+
+// Page 0, written after the pages of every change
+//
+struct UserStoreMeta
+{
+    char     magic[4];
+    uint8_t  version;
+    uint8_t  height;          // Levels, 1 when the root is a leaf
+    uint16_t generation;      // Raised by a compaction, the newer valid file is the tree
+    uint32_t root;            // Page of the root
+    uint32_t page_count;      // Pages in the file, metadata included
+    uint32_t user_count;
+    uint16_t removed;         // Users removed since the last compaction
+    uint16_t crc;             // CRC of the bytes before it
+};
+
+static_assert(sizeof(UserRecord) == 24, "UserRecord layout");
+static_assert(sizeof(UserPage) == user_page_size, "UserPage layout");
+static_assert(sizeof(UserStoreMeta) == 24, "UserStoreMeta layout");
+
+class UserStore
+{
+public:
+
+    // Singleton usage method
+    //
+    static UserStore* get_instance();
+
+    // Open the tree, an empty one is created when no file is valid. The tree
+    // moves to the spare file, and back, at every compaction
+    //
+    bool begin(const char *path, const char *spare_path);
+    void close();
+
+    // Add a user, fails on a duplicate employee id or a name too long. The
+    // day of the registration hides the log days of a previous holder of
+    // the employee id
+    //
+    bool add(const String &name, uint32_t empid, uint32_t since_day = 0);
+    static uint32_t registered_day(const UserRecord &record);
+
+    // Remove a user, its leaf is not merged with its neighbours
+    //
+    bool remove(uint32_t empid);
+
+    // Background compaction, one step per call. A change to the users
+    // abandons a compaction in progress, it starts over later
+    //
+    void run();
+    bool is_compacting() const;
+
+    // Lookups, the record is filled when the user is registered
+    //
+    bool find_card(const char *key, UserRecord &record);
+    bool find_empid(uint32_t empid, UserRecord &record);
+
+    // Users by employee id
+    //
+    void rewind();
+    bool next(UserRecord &record);
+
+    // First users whose employee id is not lower, for readers keeping their
+    // own place in the tree, at most count of them from one leaf
+    //
+    bool find_next(uint32_t empid, UserRecord &record);
+    uint8_t find_next(uint32_t empid, UserRecord *records, uint8_t count);
+
+    uint32_t size() const;
+
+    // Bulk additions, written as one change by end_batch()
+    //
+    void begin_batch();
+    void end_batch();
+
+    // Statistics of the page cache
+    //
+    void reset_stats();
+    void print_stats();
+
+    // Strict decimal parsing of an employee id
+    //
+    static bool parse_empid(const char *text, uint32_t &empid);
+
+    // Split of a card key "name,empid", the name is not copied
+    //
+    static bool parse_card(const char *key, uint8_t &name_length, uint32_t &empid);
+
+private:
+
+    UserStore();                                      // Private constructor for singleton
+    UserStore(const UserStore &) = delete;
+    UserStore &operator=(const UserStore &) = delete;
+
+    static UserStore* instance;   // Singleton instance
+
+    // Page cache
+    //
+    UserPage* load_page(uint32_t page);
+    UserPage* new_page(uint8_t type, uint32_t &page);
+    void mark_dirty(const UserPage *cached);
+    uint32_t move_page(const UserPage *cached);
+    bool write_slot(uint8_t slot);
+    bool commit();
+    bool write_meta();
+    void reset_tree();
+
+    // Tree helpers
+    //
+    static uint8_t leaf_position(const UserPage *leaf, uint32_t empid);
+    static uint8_t branch_position(const UserPage *inner, uint32_t empid);
+    UserPage* find_leaf(uint32_t empid);
+    UserPage* find_from(uint32_t page, uint8_t level, uint32_t empid, uint8_t &position);
+    bool insert_branch(uint8_t level, uint32_t moved, uint32_t empid, uint32_t child);
+
+    // Compaction helpers
+    //
+    static bool read_meta(File &tree, UserStoreMeta &tree_meta);
+    bool is_compaction_due() const;
+    void start_compaction();
+    bool compact_leaf();
+    bool compact_branches();
+    bool close_level();
+    bool finish_compaction(uint32_t root);
+    void abort_compaction();
+
+    // Stage of the compaction
+    //
+    enum CompactStage : uint8_t
+    {
+        COMPACT_IDLE,
+        COMPACT_LEAVES,       // Copying the users into full leaves
+        COMPACT_BRANCHES      // Writing the inner pages above the last level
+    };
+
+    File          file;
+    const char   *active_path;
+    const char   *spare_path;
+    UserStoreMeta meta;
+    uint32_t      committed_pages;   // Pages of the tree on the card, the others may change in place
+    bool          is_batch;
+
+    // Cached pages, the least recently used one is replaced
+    //
+    UserPage cache[user_store_cache_pages];
+    uint32_t cache_page[user_store_cache_pages];
+    uint32_t cache_used[user_store_cache_pages];
+    bool     cache_dirty[user_store_cache_pages];
+    uint32_t cache_clock;
+
+    // Pages from the root to the leaf of the last insertion
+    //
+    uint32_t path[user_store_max_height];
+
+    // Cursor of next(), the next employee id to return
+    //
+    uint32_t next_empid;
+    bool     is_cursor_done;
+
+    // Compaction into the spare file, the pages of a level are written after
+    // those of the level below
+    //
+    File         spare;
+    CompactStage compact_stage;
+    bool         is_compact_failed;  // Not retried before the next removal
+    uint8_t      compact_height;
+    uint32_t     compact_pages;      // Pages written to the spare file
+    uint32_t     compact_empid;      // Next employee id to copy
+    uint32_t     compact_left;       // Users left to copy
+    uint32_t     level_start;        // First page of the level being written
+    uint32_t     next_child;         // Next page of the level below to branch to
+    uint8_t      page_branches;      // Branches written to the current inner page
+    uint8_t      page_fill;          // Branches the current inner page gets
+    uint32_t     compactions;
+
+    uint32_t hits;                // Pages found in the cache
+    uint32_t misses;              // Pages read from the card
+    uint32_t writes;              // Pages written to the card
+};
+
+#endif  // USER_STORE_HPP
@@ -0,0 +1,100 @@
+/** @file Arduino.h
+*
+* @brief Host replacement of the Arduino core header for the native build.
+*        Provides the core types, timing, pin and interrupt APIs on top of
+*        the virtual clock in HostHal.h.
+*
+*
+*/
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t  byte;
+typedef bool     boolean;
+typedef uint16_t word;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define NOT_AN_INTERRUPT -1
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define PROGMEM
+#define PSTR(s) (s)
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+#define bitRead(value, bit)  (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit)   ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+
+// Arduino defines min/max as macros, which would break the host STL headers
+//
+template <class T, class L>
+inline auto min(const T &a, const L &b) -> decltype(a < b ? a : b)
+{
+    return (b < a) ? b : a;
+}
+
+template <class T, class L>
+inline auto max(const T &a, const L &b) -> decltype(a < b ? a : b)
+{
+    return (a < b) ? b : a;
+}
+
+template <class T, class L, class H>
+inline T constrain(const T &x, const L &lo, const H &hi)
+{
+    return (x < lo) ? lo : ((x > hi) ? hi : x);
+}
+
+// Timing
+//
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// Pins and interrupts
+//
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+int  digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t interrupt_num, void (*isr)(), int mode);
+void detachInterrupt(uint8_t interrupt_num);
+void noInterrupts();
+void interrupts();
+
+// Sketch entry points
+//
+void setup();
+void loop();
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "HardwareSerial.h"
+
+#endif  // End of ARDUINO_H
@@ -0,0 +1,17 @@
+/** @file ArxContainer.h
+*
+* @brief On the board ArxContainer supplies std::vector and std::map for
+*        avr-gcc; the host toolchain ships the real STL.
+*
+*
+*/
+
+#ifndef ARX_CONTAINER_H
+#define ARX_CONTAINER_H
+
+#include <array>
+#include <deque>
+#include <map>
+#include <vector>
+
+#endif  // End of ARX_CONTAINER_H
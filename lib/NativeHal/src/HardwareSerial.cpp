@@ -0,0 +1,134 @@
+#include "HardwareSerial.h"
+#include "HostHal.h"
+
+#include <stdio.h>
+
+// Size of the TX ring buffer in the AVR core
+//
+static const double serial_tx_buffer_size = 64.0;
+
+HardwareSerial Serial;
+
+/*!
+* @brief Function to start the console at the given baud rate.
+* @param[in] baud_rate unsigned long of the line speed used for the TX model.
+*/
+void
+HardwareSerial::begin(unsigned long baud_rate)
+{
+    baud = baud_rate;
+    host::costs().serial_baud = (uint32_t)baud_rate;
+    tx_stamp = host::clock_now_us();
+}
+
+int
+HardwareSerial::available()
+{
+    return (int)rx.size();
+}
+
+int
+HardwareSerial::read()
+{
+    if (rx.empty())
+    {
+        return -1;
+    }
+    char c = rx.front();
+    rx.pop_front();
+    return (unsigned char)c;
+}
+
+int
+HardwareSerial::peek()
+{
+    return rx.empty() ? -1 : (unsigned char)rx.front();
+}
+
+/*!
+* @brief Function to empty the TX ring by the bytes sent since the last call.
+*/
+void
+HardwareSerial::drain_tx()
+{
+    unsigned long long now = host::clock_now_us();
+    double bytes_per_us = (double)host::costs().serial_baud / 10.0 / 1000000.0;
+
+    tx_level -= (double)(now - tx_stamp) * bytes_per_us;
+    if (tx_level < 0.0)
+    {
+        tx_level = 0.0;
+    }
+    tx_stamp = now;
+}
+
+/*!
+* @brief Function to send one byte, waiting for room in the TX ring like the AVR core.
+* @param[in] c uint8_t byte to send.
+* @return The number of bytes written.
+*/
+size_t
+HardwareSerial::write(uint8_t c)
+{
+    if (host::clock_is_virtual())
+    {
+        drain_tx();
+        if (tx_level + 1.0 > serial_tx_buffer_size)
+        {
+            double bytes_per_us = (double)host::costs().serial_baud / 10.0 / 1000000.0;
+            double wait_us = (tx_level + 1.0 - serial_tx_buffer_size) / bytes_per_us;
+            host::clock_advance_us((uint64_t)wait_us + 1);
+            drain_tx();
+        }
+        tx_level += 1.0;
+    }
+
+    if (is_echo)
+    {
+        if (c != '\r')
+        {
+            fputc(c, stdout);
+        }
+        if (c == '\n')
+        {
+            fflush(stdout);
+        }
+    }
+    return 1;
+}
+
+int
+HardwareSerial::availableForWrite()
+{
+    drain_tx();
+    return (int)(serial_tx_buffer_size - tx_level);
+}
+
+/*!
+* @brief Function to wait until the TX ring is empty.
+*/
+void
+HardwareSerial::flush()
+{
+    if (host::clock_is_virtual())
+    {
+        drain_tx();
+        double bytes_per_us = (double)host::costs().serial_baud / 10.0 / 1000000.0;
+        host::clock_advance_us((uint64_t)(tx_level / bytes_per_us));
+        drain_tx();
+    }
+    fflush(stdout);
+}
+
+/*!
+* @brief Function to append text to the receive queue.
+* @param[in] text const char * to the characters typed on the console.
+*/
+void
+HardwareSerial::inject(const char *text)
+{
+    while (*text)
+    {
+        rx.push_back(*text++);
+    }
+}
@@ -0,0 +1,53 @@
+/** @file HardwareSerial.h
+*
+* @brief Host implementation of the USB serial console. Input comes from
+*        host::serial_inject (the native main feeds stdin into it), output
+*        goes to stdout. The 64 byte TX ring of the AVR core is modelled so a
+*        long report costs the same virtual time as at the configured baud.
+*
+*
+*/
+
+#ifndef HARDWARE_SERIAL_H
+#define HARDWARE_SERIAL_H
+
+#include <deque>
+#include "Stream.h"
+
+class HardwareSerial : public Stream
+{
+public:
+
+    void begin(unsigned long baud);
+    void end() {}
+
+    int available() override;
+    int read() override;
+    int peek() override;
+
+    size_t write(uint8_t c) override;
+    using Print::write;
+    int availableForWrite() override;
+    void flush() override;
+
+    operator bool() const { return true; }
+
+    // Host side helpers
+    //
+    void inject(const char *text);
+    void set_echo(bool echo) { is_echo = echo; }
+
+private:
+
+    void drain_tx();
+
+    std::deque<char> rx;
+    unsigned long    baud       = 9600;
+    double           tx_level   = 0.0;   // Bytes waiting in the TX ring
+    unsigned long long tx_stamp = 0;     // Virtual time of the last drain
+    bool             is_echo    = true;
+};
+
+extern HardwareSerial Serial;
+
+#endif  // End of HARDWARE_SERIAL_H
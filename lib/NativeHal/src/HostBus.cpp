@@ -0,0 +1,5 @@
+#include "SPI.h"
+#include "Wire.h"
+
+SPIClass SPI;
+TwoWire  Wire;
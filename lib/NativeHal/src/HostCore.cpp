@@ -0,0 +1,442 @@
+#include "Arduino.h"
+#include "HostHal.h"
+
+#include <chrono>
+#include <thread>
+
+// Number of digital pins on the Arduino Mega
+//
+static const uint8_t host_pin_count = 70;
+
+// External interrupts available on the Arduino Mega
+//
+static const uint8_t host_interrupt_count = 6;
+
+static bool     is_virtual_clock = true;
+static uint64_t virtual_now_us   = 0;
+
+static std::chrono::steady_clock::time_point real_epoch = std::chrono::steady_clock::now();
+
+static host::TraceListener trace_listener = nullptr;
+
+static uint8_t pin_levels[host_pin_count];
+static void (*interrupt_handlers[host_interrupt_count])() = {};
+static bool is_interrupt_enabled = true;
+
+// Compare match timer
+//
+struct HostTimer
+{
+    bool     is_running;
+    bool     is_in_isr;
+    uint32_t period_us;
+    uint64_t next_us;      // Clock instant of the next compare match
+    uint32_t ticks;
+    void   (*isr)();
+};
+
+static HostTimer host_timer = {};
+
+// Default costs, approximated from the datasheets of the parts on the board
+//
+static host::Costs host_costs =
+{
+    2,       // clock_read_us
+    1100,    // lcd_byte_us    : 2 nibbles x 3 PCF8574 writes at 100 kHz plus enable pulses
+    2000,    // lcd_clear_us
+    4000,    // sd_open_us
+    6000,    // sd_flush_us
+    4,       // sd_byte_us
+    1000,    // rfid_poll_us
+    2500,    // rfid_select_us
+    3000,    // rfid_auth_us
+    1800,    // rfid_read_us
+    4500,    // rfid_write_us
+    600,     // rfid_halt_us
+    10,      // rfid_register_us : 2 bytes at 4 MHz plus chip select and call overhead
+    9600     // serial_baud
+};
+
+/*!
+* @brief Function to read the selected clock without running the timer.
+* @return The time since reset in microseconds.
+*/
+static uint64_t
+raw_now_us()
+{
+    if (is_virtual_clock)
+    {
+        return virtual_now_us;
+    }
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - real_epoch).count();
+}
+
+/*!
+* @brief Function to run the timer ISR for every compare match up to a clock
+*        instant. In virtual mode the clock is moved to each match first.
+* @param[in] until_us uint64_t of the clock instant to catch up to.
+*/
+static void
+run_timer_until(uint64_t until_us)
+{
+    // Interrupts do not nest and stay pending while disabled
+    //
+    if (host_timer.is_in_isr || !is_interrupt_enabled)
+    {
+        return;
+    }
+
+    while (host_timer.is_running && host_timer.next_us <= until_us)
+    {
+        uint64_t match_us = host_timer.next_us;
+        if (is_virtual_clock && virtual_now_us < match_us)
+        {
+            virtual_now_us = match_us;
+        }
+
+        host_timer.is_in_isr = true;
+        host_timer.ticks++;
+        host_timer.isr();
+        host_timer.is_in_isr = false;
+
+        host_timer.next_us = match_us + host_timer.period_us;
+    }
+}
+
+/*!
+* @brief Function to move the virtual clock forward, running the timer on the way.
+* @param[in] us uint64_t of the time to pass in microseconds.
+*/
+static void
+advance_virtual_us(uint64_t us)
+{
+    uint64_t target_us = virtual_now_us + us;
+    run_timer_until(target_us);
+    if (virtual_now_us < target_us)
+    {
+        virtual_now_us = target_us;
+    }
+}
+
+namespace host
+{
+
+/*!
+* @brief Function to select the virtual or the real clock.
+* @param[in] is_virtual bool true for the virtual clock.
+*/
+void
+clock_use_virtual(bool is_virtual)
+{
+    is_virtual_clock = is_virtual;
+    clock_reset();
+}
+
+/*!
+* @brief Function to check the clock mode.
+* @return The status if the virtual clock is used.
+*/
+bool
+clock_is_virtual()
+{
+    return is_virtual_clock;
+}
+
+/*!
+* @brief Function to read the current time of the selected clock.
+* @return The time since reset in microseconds.
+*/
+uint64_t
+clock_now_us()
+{
+    if (!is_virtual_clock)
+    {
+        run_timer_until(raw_now_us());
+    }
+    return raw_now_us();
+}
+
+/*!
+* @brief Function to move the clock forward, sleeping when the real clock is used.
+* @param[in] us uint64_t of the time to pass in microseconds.
+*/
+void
+clock_advance_us(uint64_t us)
+{
+    if (is_virtual_clock)
+    {
+        advance_virtual_us(us);
+    }
+    else
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    }
+}
+
+/*!
+* @brief Function to restart the clock at zero.
+*/
+void
+clock_reset()
+{
+    virtual_now_us = 0;
+    real_epoch = std::chrono::steady_clock::now();
+}
+
+/*!
+* @brief Function to charge the cost of a hardware operation to the virtual clock.
+* @param[in] us uint32_t of the modelled duration in microseconds.
+*/
+void
+charge_us(uint32_t us)
+{
+    if (is_virtual_clock)
+    {
+        advance_virtual_us(us);
+    }
+}
+
+/*!
+* @brief Function to access the cost model.
+* @return The modifiable cost table.
+*/
+Costs&
+costs()
+{
+    return host_costs;
+}
+
+/*!
+* @brief Function to type text on the serial console.
+* @param[in] text const char * of characters to queue.
+*/
+void
+serial_inject(const char *text)
+{
+    Serial.inject(text);
+}
+
+/*!
+* @brief Function to mirror or mute the firmware console output.
+* @param[in] echo bool true to print to stdout.
+*/
+void
+serial_set_echo(bool echo)
+{
+    Serial.set_echo(echo);
+}
+
+/*!
+* @brief Function to fire the ISR attached to a pin, as an edge on the pin would.
+* @param[in] pin uint8_t of the digital pin.
+*/
+void
+raise_interrupt(uint8_t pin)
+{
+    int num = digitalPinToInterrupt(pin);
+    if (num >= 0 && num < host_interrupt_count && interrupt_handlers[num] != nullptr)
+    {
+        interrupt_handlers[num]();
+    }
+}
+
+/*!
+* @brief Function to read the level last written to a pin.
+* @param[in] pin uint8_t of the digital pin.
+* @return The pin level.
+*/
+uint8_t
+pin_state(uint8_t pin)
+{
+    return (pin < host_pin_count) ? pin_levels[pin] : LOW;
+}
+
+/*!
+* @brief Function to start the compare match timer.
+* @param[in] period_us uint32_t of the time between two ISR runs.
+* @param[in] isr void (*)() to run on every compare match.
+*/
+void
+timer_start(uint32_t period_us, void (*isr)())
+{
+    host_timer.is_running = (isr != nullptr && period_us > 0);
+    host_timer.period_us = period_us;
+    host_timer.next_us = raw_now_us() + period_us;
+    host_timer.ticks = 0;
+    host_timer.isr = isr;
+}
+
+/*!
+* @brief Function to change the period, from the ISR it applies to the next match.
+* @param[in] period_us uint32_t of the time between two ISR runs.
+*/
+void
+timer_set_period(uint32_t period_us)
+{
+    if (period_us > 0)
+    {
+        host_timer.period_us = period_us;
+    }
+}
+
+/*!
+* @brief Function to stop the compare match timer.
+*/
+void
+timer_stop()
+{
+    host_timer.is_running = false;
+}
+
+/*!
+* @brief Function to check if the timer is running.
+* @return The status if the timer is running.
+*/
+bool
+timer_is_running()
+{
+    return host_timer.is_running;
+}
+
+/*!
+* @brief Function to count the ISR runs.
+* @return The ISR runs since the last timer_start.
+*/
+uint32_t
+timer_ticks()
+{
+    return host_timer.ticks;
+}
+
+/*!
+* @brief Function to report a trace point to the registered listener.
+* @param[in] event TraceEvent that happened.
+* @param[in] tag uint32_t of event specific data.
+*/
+void
+trace(TraceEvent event, uint32_t tag)
+{
+    if (trace_listener != nullptr)
+    {
+        trace_listener(event, tag, clock_now_us());
+    }
+}
+
+/*!
+* @brief Function to register the trace listener.
+* @param[in] listener TraceListener to call, nullptr to stop tracing.
+*/
+void
+set_trace_listener(TraceListener listener)
+{
+    trace_listener = listener;
+}
+
+}  // namespace host
+
+unsigned long
+millis()
+{
+    host::charge_us(host_costs.clock_read_us);
+    return (unsigned long)(host::clock_now_us() / 1000);
+}
+
+unsigned long
+micros()
+{
+    host::charge_us(host_costs.clock_read_us);
+    return (unsigned long)host::clock_now_us();
+}
+
+void
+delay(unsigned long ms)
+{
+    host::clock_advance_us((uint64_t)ms * 1000);
+}
+
+void
+delayMicroseconds(unsigned int us)
+{
+    host::clock_advance_us(us);
+}
+
+void
+pinMode(uint8_t pin, uint8_t mode)
+{
+    if (pin < host_pin_count && mode == INPUT_PULLUP)
+    {
+        pin_levels[pin] = HIGH;
+    }
+}
+
+void
+digitalWrite(uint8_t pin, uint8_t val)
+{
+    if (pin < host_pin_count)
+    {
+        pin_levels[pin] = val ? HIGH : LOW;
+    }
+}
+
+int
+digitalRead(uint8_t pin)
+{
+    return host::pin_state(pin);
+}
+
+/*!
+* @brief Function to map a pin to its external interrupt, using the Arduino Mega table.
+* @param[in] pin uint8_t of the digital pin.
+* @return The interrupt number or NOT_AN_INTERRUPT.
+*/
+int
+digitalPinToInterrupt(uint8_t pin)
+{
+    switch (pin)
+    {
+        case 2:  return 0;
+        case 3:  return 1;
+        case 21: return 2;
+        case 20: return 3;
+        case 19: return 4;
+        case 18: return 5;
+        default: return NOT_AN_INTERRUPT;
+    }
+}
+
+void
+attachInterrupt(uint8_t interrupt_num, void (*isr)(), int mode)
+{
+    (void)mode;
+    if (interrupt_num < host_interrupt_count)
+    {
+        interrupt_handlers[interrupt_num] = isr;
+    }
+}
+
+void
+detachInterrupt(uint8_t interrupt_num)
+{
+    if (interrupt_num < host_interrupt_count)
+    {
+        interrupt_handlers[interrupt_num] = nullptr;
+    }
+}
+
+void
+noInterrupts()
+{
+    is_interrupt_enabled = false;
+}
+
+/*!
+* @brief Function to enable interrupts, a timer match which came while they
+*        were disabled runs now like a pending interrupt flag would.
+*/
+void
+interrupts()
+{
+    is_interrupt_enabled = true;
+    run_timer_until(raw_now_us());
+}
@@ -0,0 +1,175 @@
+/** @file HostHal.h
+*
+* @brief Control surface of the native hardware fakes. The firmware only
+*        sees the regular Arduino headers; host programs (the native main,
+*        benchmarks) use this header to drive the virtual clock, point the
+*        SD card at a directory, script card presentations and feed the
+*        serial console.
+*
+*
+*/
+
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace host
+{
+
+// Virtual clock
+//
+// In virtual mode time only moves when the firmware waits (delay, busy
+// loops on millis/micros) or when a fake device charges the cost of a bus
+// transaction, so runs are deterministic and independent of the host CPU.
+// In real mode the clock follows the host monotonic clock.
+//
+void     clock_use_virtual(bool is_virtual);
+bool     clock_is_virtual();
+uint64_t clock_now_us();
+void     clock_advance_us(uint64_t us);
+void     clock_reset();
+
+// Charge the cost of an operation to the virtual clock (no-op in real mode)
+//
+void     charge_us(uint32_t us);
+
+// Modelled cost of hardware operations, in microseconds
+//
+struct Costs
+{
+    uint32_t clock_read_us;      // Cost of a millis()/micros() read
+    uint32_t lcd_byte_us;        // One HD44780 byte through the PCF8574 backpack
+    uint32_t lcd_clear_us;       // Clear / home command execution time
+    uint32_t sd_open_us;         // Directory walk when opening a file
+    uint32_t sd_flush_us;        // Writing back a dirty sector and directory entry
+    uint32_t sd_byte_us;         // Per byte read or written over SPI
+    uint32_t rfid_poll_us;       // REQA with no card in the field
+    uint32_t rfid_select_us;     // Anticollision and select
+    uint32_t rfid_auth_us;       // Three pass authentication
+    uint32_t rfid_read_us;       // MIFARE_Read of one block
+    uint32_t rfid_write_us;      // MIFARE_Write of one block
+    uint32_t rfid_halt_us;       // HLTA and crypto stop
+    uint32_t rfid_register_us;   // One register access over SPI
+    uint32_t serial_baud;        // Console baud rate used to drain the TX buffer
+};
+
+Costs& costs();
+
+// Wall clock time the RTC reports at the current clock instant
+//
+void rtc_set(uint32_t unixtime);
+
+// SD card backed by a host directory
+//
+void        sd_set_root(const char *dir);
+const char* sd_root();
+
+struct SdStats
+{
+    uint32_t opens;
+    uint32_t flushes;
+    uint32_t bytes_read;
+    uint32_t bytes_written;
+};
+
+SdStats& sd_stats();
+
+// Scripted card presentations for the MFRC522 fake
+//
+struct Card
+{
+    uint8_t uid[10];
+    uint8_t uid_size;
+    uint8_t sak;
+    uint8_t blocks[64][16];
+};
+
+// Build a MIFARE Classic 1K card with name in block 8 and employee id in block 9
+//
+Card make_card(uint32_t uid, const char *name, const char *empid);
+
+// Queue a card to enter the field at at_ms (virtual time) for hold_ms
+//
+void present_card(const Card &card, uint32_t at_ms, uint32_t hold_ms);
+void clear_cards();
+size_t pending_cards();
+
+struct RfidStats
+{
+    uint32_t polls;
+    uint32_t selects;
+    uint32_t auths;
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t irqs;               // Receive interrupts raised on the IRQ line
+    uint32_t spi_bytes;          // Estimated SPI traffic to the reader
+};
+
+RfidStats& rfid_stats();
+
+// Pin the reader IRQ output is wired to (pin 3 by default, 0xFF for none).
+// The line is raised when a REQA started through the registers, with the
+// receive interrupt enabled in ComIEnReg, gets an answer.
+//
+void rfid_wire_irq(uint8_t pin);
+
+// Heap allocations String would have made on the board, where every
+// String allocates its buffer and reallocates it to grow
+//
+uint32_t string_allocs();
+
+// Serial console
+//
+void serial_inject(const char *text);
+void serial_set_echo(bool echo);   // Mirror firmware output to stdout
+
+// Pins and external interrupts
+//
+void    raise_interrupt(uint8_t pin);
+uint8_t pin_state(uint8_t pin);
+
+// LCD inspection
+//
+const char* lcd_row(uint8_t row);   // Visible 16 characters of a row
+
+struct LcdStats
+{
+    uint32_t commands;
+    uint32_t data_bytes;
+    uint32_t i2c_bytes;
+};
+
+LcdStats& lcd_stats();
+
+// Hardware timer, modelled on Timer1 in CTC mode
+//
+// The ISR runs every period_us. In virtual mode it runs at the exact
+// virtual instant the period elapses, in real mode from the first clock
+// read after it elapsed. noInterrupts() holds it back until interrupts().
+// A period changed from inside the ISR applies to the next period.
+//
+void     timer_start(uint32_t period_us, void (*isr)());
+void     timer_set_period(uint32_t period_us);
+void     timer_stop();
+bool     timer_is_running();
+uint32_t timer_ticks();              // ISR runs since the last timer_start
+
+// Trace points the benchmarks listen to
+//
+enum TraceEvent
+{
+    TRACE_CARD_DETECTED,   // First selection of a presentation, tag = UID
+    TRACE_DOOR_OPEN,       // Door::open called by the firmware
+    TRACE_EVENT_COUNT
+};
+
+typedef void (*TraceListener)(TraceEvent event, uint32_t tag, uint64_t at_us);
+
+void trace(TraceEvent event, uint32_t tag = 0);
+void set_trace_listener(TraceListener listener);
+
+}  // namespace host
+
+#endif  // End of HOST_HAL_H
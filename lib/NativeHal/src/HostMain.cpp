@@ -0,0 +1,136 @@
+/** @file HostMain.cpp
+*
+* @brief Entry point of the native build: runs setup() once and loop()
+*        forever, like the Arduino core, while feeding stdin to the serial
+*        console. Benchmarks define NATIVE_HAL_NO_MAIN and drive the sketch
+*        themselves.
+*
+*        Usage: program [--sd DIR] [--cards FILE] [--virtual] [--loops N]
+*
+*        The cards file holds one presentation per line:
+*        <at_ms> <hold_ms> <uid_hex> <name> <empid>
+*        A line without the name and the employee id presents a blank card.
+*
+*
+*/
+
+#if !defined(NATIVE_HAL_NO_MAIN) && !defined(PIO_UNIT_TESTING)
+
+#include "Arduino.h"
+#include "HostHal.h"
+
+#include <poll.h>
+#include <unistd.h>
+
+/*!
+* @brief Function to queue the presentations listed in a cards file.
+* @param[in] path const char * of the file.
+* @return The status if the file could be read.
+*/
+static bool
+load_card_script(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == nullptr)
+    {
+        fprintf(stderr, "Could not open card script %s\n", path);
+        return false;
+    }
+
+    char line[128];
+    while (fgets(line, sizeof(line), fp) != nullptr)
+    {
+        unsigned long at_ms = 0;
+        unsigned long hold_ms = 0;
+        unsigned long uid = 0;
+        char name[17] = {};
+        char empid[17] = {};
+
+        if (line[0] == '#')
+        {
+            continue;
+        }
+        int fields = sscanf(line, "%lu %lu %lx %16s %16s", &at_ms, &hold_ms, &uid, name, empid);
+        if (fields == 5 || fields == 3)
+        {
+            host::present_card(host::make_card((uint32_t)uid, name, empid), (uint32_t)at_ms, (uint32_t)hold_ms);
+        }
+    }
+    fclose(fp);
+    return true;
+}
+
+/*!
+* @brief Function to move pending stdin input into the serial receive queue.
+* @return The status if stdin is still open.
+*/
+static bool
+poll_stdin()
+{
+    struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+    while (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLIN | POLLHUP)))
+    {
+        char buffer[256];
+        ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer) - 1);
+        if (n <= 0)
+        {
+            return false;
+        }
+        buffer[n] = '\0';
+        host::serial_inject(buffer);
+    }
+    return true;
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned long max_loops = 0;
+    bool is_virtual = false;
+    const char *cards = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--sd") == 0 && i + 1 < argc)
+        {
+            host::sd_set_root(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--cards") == 0 && i + 1 < argc)
+        {
+            cards = argv[++i];
+        }
+        else if (strcmp(argv[i], "--virtual") == 0)
+        {
+            is_virtual = true;
+        }
+        else if (strcmp(argv[i], "--loops") == 0 && i + 1 < argc)
+        {
+            max_loops = strtoul(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            fprintf(stderr, "Usage: %s [--sd DIR] [--cards FILE] [--virtual] [--loops N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    host::clock_use_virtual(is_virtual);
+    if (cards != nullptr && !load_card_script(cards))
+    {
+        return 1;
+    }
+
+    bool is_stdin_open = true;
+    setup();
+    for (unsigned long n = 0; max_loops == 0 || n < max_loops; n++)
+    {
+        if (is_stdin_open)
+        {
+            is_stdin_open = poll_stdin();
+        }
+        loop();
+    }
+    return 0;
+}
+
+#endif  // !NATIVE_HAL_NO_MAIN && !PIO_UNIT_TESTING
@@ -0,0 +1,154 @@
+#include "LiquidCrystal_I2C.h"
+#include "HostHal.h"
+
+// HD44780 display RAM: 40 characters per row, row 1 starts at 0x40
+//
+static const uint8_t lcd_ddram_row_len = 40;
+static const uint8_t lcd_visible_cols  = 16;
+
+// Each HD44780 byte is sent as two nibbles, each nibble as three PCF8574
+// writes (data, enable high, enable low) of address plus payload
+//
+static const uint8_t lcd_i2c_bytes_per_lcd_byte = 12;
+
+static char           lcd_ddram[2][lcd_ddram_row_len];
+static char           lcd_visible[2][lcd_visible_cols + 1];
+static host::LcdStats lcd_counters = {};
+
+namespace host
+{
+
+/*!
+* @brief Function to read the visible part of a display row.
+* @param[in] row uint8_t of the row (0 or 1).
+* @return The 16 visible characters.
+*/
+const char*
+lcd_row(uint8_t row)
+{
+    row = (row > 1) ? 1 : row;
+    for (uint8_t i = 0; i < lcd_visible_cols; i++)
+    {
+        char c = lcd_ddram[row][i];
+        lcd_visible[row][i] = (c == '\0') ? ' ' : c;
+    }
+    lcd_visible[row][lcd_visible_cols] = '\0';
+    return lcd_visible[row];
+}
+
+/*!
+* @brief Function to access the display counters.
+* @return The modifiable counters.
+*/
+LcdStats&
+lcd_stats()
+{
+    return lcd_counters;
+}
+
+}  // namespace host
+
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t lcd_addr, uint8_t lcd_cols, uint8_t lcd_rows)
+    : cols(lcd_cols), rows(lcd_rows), address_counter(0)
+{
+    (void)lcd_addr;
+    memset(lcd_ddram, ' ', sizeof(lcd_ddram));
+}
+
+/*!
+* @brief Function to account one command byte.
+* @param[in] value uint8_t of the HD44780 instruction.
+*/
+void
+LiquidCrystal_I2C::command(uint8_t value)
+{
+    (void)value;
+    lcd_counters.commands++;
+    lcd_counters.i2c_bytes += lcd_i2c_bytes_per_lcd_byte;
+    host::charge_us(host::costs().lcd_byte_us);
+}
+
+void
+LiquidCrystal_I2C::init()
+{
+    begin(cols, rows);
+}
+
+void
+LiquidCrystal_I2C::begin(uint8_t lcd_cols, uint8_t lcd_rows)
+{
+    cols = lcd_cols;
+    rows = lcd_rows;
+    command(0x28);  // Function set: 4 bit, 2 lines
+    command(0x0C);  // Display on
+    clear();
+    command(0x06);  // Entry mode: increment
+    home();
+}
+
+void
+LiquidCrystal_I2C::clear()
+{
+    command(0x01);
+    host::charge_us(host::costs().lcd_clear_us);
+    memset(lcd_ddram, ' ', sizeof(lcd_ddram));
+    address_counter = 0;
+}
+
+void
+LiquidCrystal_I2C::home()
+{
+    command(0x02);
+    host::charge_us(host::costs().lcd_clear_us);
+    address_counter = 0;
+}
+
+void
+LiquidCrystal_I2C::setCursor(uint8_t col, uint8_t row)
+{
+    static const uint8_t row_offsets[] = { 0x00, 0x40, 0x14, 0x54 };
+    if (row >= rows)
+    {
+        row = rows - 1;
+    }
+    address_counter = (uint8_t)(row_offsets[row] + col);
+    command(0x80 | address_counter);
+}
+
+void LiquidCrystal_I2C::backlight()   { lcd_counters.i2c_bytes += 2; }
+void LiquidCrystal_I2C::noBacklight() { lcd_counters.i2c_bytes += 2; }
+void LiquidCrystal_I2C::display()     { command(0x0C); }
+void LiquidCrystal_I2C::noDisplay()   { command(0x08); }
+
+/*!
+* @brief Function to write one character at the address counter, wrapping like the HD44780.
+* @param[in] value uint8_t character.
+* @return The number of bytes written.
+*/
+size_t
+LiquidCrystal_I2C::write(uint8_t value)
+{
+    lcd_counters.data_bytes++;
+    lcd_counters.i2c_bytes += lcd_i2c_bytes_per_lcd_byte;
+    host::charge_us(host::costs().lcd_byte_us);
+
+    uint8_t row = (address_counter >= 0x40) ? 1 : 0;
+    uint8_t col = address_counter - (row ? 0x40 : 0x00);
+    if (col < lcd_ddram_row_len)
+    {
+        lcd_ddram[row][col] = (char)value;
+    }
+
+    // The end of row 0 continues on row 1 and the end of row 1 on row 0
+    //
+    address_counter++;
+    if (address_counter == lcd_ddram_row_len)
+    {
+        address_counter = 0x40;
+    }
+    else if (address_counter == 0x40 + lcd_ddram_row_len)
+    {
+        address_counter = 0x00;
+    }
+    return 1;
+}
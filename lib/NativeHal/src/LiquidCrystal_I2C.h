@@ -0,0 +1,44 @@
+/** @file LiquidCrystal_I2C.h
+*
+* @brief Host implementation of the LiquidCrystal_I2C library. Keeps the
+*        HD44780 display RAM (two rows of 40 characters, 16 visible) and
+*        counts every command and data byte pushed over the I2C backpack.
+*
+*
+*/
+
+#ifndef LIQUID_CRYSTAL_I2C_H
+#define LIQUID_CRYSTAL_I2C_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+class LiquidCrystal_I2C : public Print
+{
+public:
+
+    LiquidCrystal_I2C(uint8_t lcd_addr, uint8_t lcd_cols, uint8_t lcd_rows);
+
+    void init();
+    void begin(uint8_t cols, uint8_t rows);
+    void clear();
+    void home();
+    void setCursor(uint8_t col, uint8_t row);
+    void backlight();
+    void noBacklight();
+    void display();
+    void noDisplay();
+
+    size_t write(uint8_t value) override;
+    using Print::write;
+
+private:
+
+    void command(uint8_t value);
+
+    uint8_t cols;
+    uint8_t rows;
+    uint8_t address_counter;   // DDRAM address the next character goes to
+};
+
+#endif  // End of LIQUID_CRYSTAL_I2C_H
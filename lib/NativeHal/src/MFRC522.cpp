@@ -0,0 +1,565 @@
+#include "MFRC522.h"
+#include "HostHal.h"
+
+#include <list>
+
+// ISO 14443A card states
+//
+enum card_state
+{
+    CARD_IDLE,
+    CARD_READY,
+    CARD_ACTIVE,
+    CARD_HALT
+};
+
+// A card in or on its way to the field
+//
+struct Presentation
+{
+    host::Card card;
+    uint64_t   at_us;
+    uint64_t   until_us;
+    card_state state;
+    bool       is_detected;
+};
+
+static std::list<Presentation> presentations;  // Stable addresses for active_card
+static Presentation *active_card = nullptr;
+static int authenticated_sector = -1;
+static host::RfidStats rfid_counters = {};
+
+// Register file, FIFO and IRQ wiring
+//
+static byte    registers[64];
+static byte    fifo[64];
+static uint8_t fifo_level = 0;
+static uint8_t irq_pin = 3;
+
+// SPI traffic model: register accesses are two bytes, commands are a few
+// register writes and the library then reads ComIrqReg about every 10 us
+// until the command completes
+//
+static const uint8_t spi_bytes_per_register = 2;
+static const uint8_t spi_poll_interval_us   = 10;
+
+static const uint8_t com_irq_rx    = 0x20;   // ComIrqReg / ComIEnReg RxIRq bit
+static const uint8_t com_irq_set1  = 0x80;   // ComIrqReg write sets instead of clears
+static const uint8_t start_send    = 0x80;   // BitFramingReg StartSend bit
+static const uint8_t fifo_flush    = 0x80;   // FIFOLevelReg FlushBuffer bit
+
+/*!
+* @brief Function to account the SPI traffic of a library command.
+* @param[in] setup_registers uint8_t of registers written to start the command.
+* @param[in] wait_us uint32_t of the time the library polls for completion.
+*/
+static void
+count_command_spi(uint8_t setup_registers, uint32_t wait_us)
+{
+    rfid_counters.spi_bytes += setup_registers * spi_bytes_per_register +
+                               (wait_us / spi_poll_interval_us) * spi_bytes_per_register;
+}
+
+/*!
+* @brief Function to drop the cards that left the field.
+*/
+static void
+expire_cards()
+{
+    uint64_t now = host::clock_now_us();
+
+    for (auto it = presentations.begin(); it != presentations.end(); )
+    {
+        if (now >= it->until_us)
+        {
+            if (&(*it) == active_card)
+            {
+                active_card = nullptr;
+                authenticated_sector = -1;
+            }
+            it = presentations.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+/*!
+* @brief Function to check whether a presentation is in the field right now.
+* @param[in] p const Presentation& to check.
+* @return The status if the card is in the field.
+*/
+static bool
+in_field(const Presentation &p)
+{
+    uint64_t now = host::clock_now_us();
+    return p.at_us <= now && now < p.until_us;
+}
+
+namespace host
+{
+
+/*!
+* @brief Function to build a MIFARE Classic 1K card in the layout written by the encoder program.
+* @param[in] uid uint32_t of the 4 byte UID.
+* @param[in] name const char * stored in block 8.
+* @param[in] empid const char * stored in block 9.
+* @return The card image.
+*/
+Card
+make_card(uint32_t uid, const char *name, const char *empid)
+{
+    Card card;
+    memset(&card, 0, sizeof(card));
+
+    card.uid_size = 4;
+    card.uid[0] = (uint8_t)(uid >> 24);
+    card.uid[1] = (uint8_t)(uid >> 16);
+    card.uid[2] = (uint8_t)(uid >> 8);
+    card.uid[3] = (uint8_t)uid;
+    card.sak = 0x08;
+
+    strncpy((char *)card.blocks[8], name, 16);
+    strncpy((char *)card.blocks[9], empid, 16);
+
+    // Transport configuration trailers: key A and key B all 0xFF
+    //
+    for (uint8_t trailer = 3; trailer < 64; trailer += 4)
+    {
+        memset(card.blocks[trailer], 0xFF, 6);
+        card.blocks[trailer][6] = 0xFF;
+        card.blocks[trailer][7] = 0x07;
+        card.blocks[trailer][8] = 0x80;
+        card.blocks[trailer][9] = 0x69;
+        memset(&card.blocks[trailer][10], 0xFF, 6);
+    }
+    return card;
+}
+
+/*!
+* @brief Function to queue a card presentation.
+* @param[in] card const Card& to present.
+* @param[in] at_ms uint32_t of the virtual time the card enters the field.
+* @param[in] hold_ms uint32_t of how long the card stays in the field.
+*/
+void
+present_card(const Card &card, uint32_t at_ms, uint32_t hold_ms)
+{
+    Presentation p;
+    p.card = card;
+    p.at_us = (uint64_t)at_ms * 1000;
+    p.until_us = p.at_us + (uint64_t)hold_ms * 1000;
+    p.state = CARD_IDLE;
+    p.is_detected = false;
+
+    presentations.push_back(p);
+}
+
+/*!
+* @brief Function to remove all queued cards.
+*/
+void
+clear_cards()
+{
+    presentations.clear();
+    active_card = nullptr;
+    authenticated_sector = -1;
+}
+
+/*!
+* @brief Function to count the cards not yet removed from the field.
+* @return The number of queued presentations.
+*/
+size_t
+pending_cards()
+{
+    expire_cards();
+    return presentations.size();
+}
+
+/*!
+* @brief Function to wire the reader IRQ output to a pin.
+* @param[in] pin uint8_t of the digital pin, 0xFF when not wired.
+*/
+void
+rfid_wire_irq(uint8_t pin)
+{
+    irq_pin = pin;
+}
+
+/*!
+* @brief Function to access the reader counters.
+* @return The modifiable counters.
+*/
+RfidStats&
+rfid_stats()
+{
+    return rfid_counters;
+}
+
+}  // namespace host
+
+MFRC522::MFRC522(byte chip_select_pin, byte reset_power_down_pin)
+{
+    (void)chip_select_pin;
+    (void)reset_power_down_pin;
+    memset(&uid, 0, sizeof(uid));
+}
+
+void
+MFRC522::PCD_Init()
+{
+    memset(registers, 0, sizeof(registers));
+    fifo_level = 0;
+}
+
+/*!
+* @brief Function to write a register, a StartSend of a REQA or WUPA in
+*        Transceive wakes the cards in the field and raises the IRQ line
+*        when one answers and the receive interrupt is enabled.
+* @param[in] reg PCD_Register to write.
+* @param[in] value byte to write.
+*/
+void
+MFRC522::PCD_WriteRegister(PCD_Register reg, byte value)
+{
+    host::charge_us(host::costs().rfid_register_us);
+    rfid_counters.spi_bytes += spi_bytes_per_register;
+
+    uint8_t addr = reg >> 1;
+    switch (reg)
+    {
+        case FIFODataReg:
+            if (fifo_level < sizeof(fifo))
+            {
+                fifo[fifo_level++] = value;
+            }
+            return;
+
+        case FIFOLevelReg:
+            if (value & fifo_flush)
+            {
+                fifo_level = 0;
+            }
+            return;
+
+        case ComIrqReg:
+            if (value & com_irq_set1)
+            {
+                registers[addr] |= (value & 0x7F);
+            }
+            else
+            {
+                registers[addr] &= ~value;
+            }
+            return;
+
+        default:
+            registers[addr] = value;
+            break;
+    }
+
+    bool is_request = fifo_level > 0 && (fifo[0] == PICC_CMD_REQA || fifo[0] == PICC_CMD_WUPA);
+    if (reg != BitFramingReg || !(value & start_send) ||
+        registers[CommandReg >> 1] != PCD_Transceive || !is_request)
+    {
+        return;
+    }
+
+    // REQA wakes idle cards, WUPA halted ones as well
+    //
+    expire_cards();
+    bool answered = false;
+    for (Presentation &p : presentations)
+    {
+        if (in_field(p) && (p.state == CARD_IDLE || p.state == CARD_READY ||
+                            (fifo[0] == PICC_CMD_WUPA && p.state == CARD_HALT)))
+        {
+            p.state = CARD_READY;
+            answered = true;
+        }
+    }
+    fifo_level = 0;
+
+    if (answered)
+    {
+        registers[ComIrqReg >> 1] |= com_irq_rx;
+        if ((registers[ComIEnReg >> 1] & com_irq_rx) && irq_pin != 0xFF)
+        {
+            rfid_counters.irqs++;
+            host::raise_interrupt(irq_pin);
+        }
+    }
+}
+
+/*!
+* @brief Function to write several bytes to a register, used for the FIFO.
+* @param[in] reg PCD_Register to write.
+* @param[in] count byte of values.
+* @param[in] values byte * to write.
+*/
+void
+MFRC522::PCD_WriteRegister(PCD_Register reg, byte count, byte *values)
+{
+    for (byte i = 0; i < count; i++)
+    {
+        PCD_WriteRegister(reg, values[i]);
+    }
+}
+
+/*!
+* @brief Function to read a register.
+* @param[in] reg PCD_Register to read.
+* @return The register value.
+*/
+byte
+MFRC522::PCD_ReadRegister(PCD_Register reg)
+{
+    host::charge_us(host::costs().rfid_register_us);
+    rfid_counters.spi_bytes += spi_bytes_per_register;
+
+    if (reg == FIFOLevelReg)
+    {
+        return fifo_level;
+    }
+    return registers[reg >> 1];
+}
+
+/*!
+* @brief Function to send REQA and report whether an idle card answered.
+* @return The status if a new card is in the field.
+*/
+bool
+MFRC522::PICC_IsNewCardPresent()
+{
+    expire_cards();
+    rfid_counters.polls++;
+    host::charge_us(host::costs().rfid_poll_us);
+    count_command_spi(8, host::costs().rfid_poll_us);
+
+    bool answered = false;
+    for (Presentation &p : presentations)
+    {
+        if (in_field(p) && (p.state == CARD_IDLE || p.state == CARD_READY))
+        {
+            p.state = CARD_READY;
+            answered = true;
+        }
+    }
+    return answered;
+}
+
+/*!
+* @brief Function to run anticollision and select one of the ready cards.
+* @return The status if a card was selected.
+*/
+bool
+MFRC522::PICC_ReadCardSerial()
+{
+    rfid_counters.selects++;
+    host::charge_us(host::costs().rfid_select_us);
+    count_command_spi(16, host::costs().rfid_select_us);
+
+    active_card = nullptr;
+    authenticated_sector = -1;
+
+    for (Presentation &p : presentations)
+    {
+        if (p.state != CARD_READY)
+        {
+            continue;
+        }
+        if (active_card == nullptr && in_field(p))
+        {
+            p.state = CARD_ACTIVE;
+            active_card = &p;
+        }
+        else
+        {
+            p.state = CARD_IDLE;  // Lost the anticollision, back to idle
+        }
+    }
+
+    if (active_card == nullptr)
+    {
+        return false;
+    }
+
+    if (!active_card->is_detected)
+    {
+        const uint8_t *u = active_card->card.uid;
+        active_card->is_detected = true;
+        host::trace(host::TRACE_CARD_DETECTED,
+                    ((uint32_t)u[0] << 24) | ((uint32_t)u[1] << 16) | ((uint32_t)u[2] << 8) | u[3]);
+    }
+
+    uid.size = active_card->card.uid_size;
+    memcpy(uid.uidByte, active_card->card.uid, sizeof(uid.uidByte));
+    uid.sak = active_card->card.sak;
+    return true;
+}
+
+MFRC522::PICC_Type
+MFRC522::PICC_GetType(byte sak)
+{
+    sak &= 0x7F;
+    switch (sak)
+    {
+        case 0x04: return PICC_TYPE_NOT_COMPLETE;
+        case 0x09: return PICC_TYPE_MIFARE_MINI;
+        case 0x08: return PICC_TYPE_MIFARE_1K;
+        case 0x18: return PICC_TYPE_MIFARE_4K;
+        case 0x00: return PICC_TYPE_MIFARE_UL;
+        case 0x10:
+        case 0x11: return PICC_TYPE_MIFARE_PLUS;
+        case 0x01: return PICC_TYPE_TNP3XXX;
+        case 0x20: return PICC_TYPE_ISO_14443_4;
+        case 0x40: return PICC_TYPE_ISO_18092;
+        default:   return PICC_TYPE_UNKNOWN;
+    }
+}
+
+/*!
+* @brief Function to authenticate a sector with key A or B against the selected card.
+* @return The status of the authentication.
+*/
+MFRC522::StatusCode
+MFRC522::PCD_Authenticate(byte command, byte block_addr, MIFARE_Key *key, Uid *card_uid)
+{
+    rfid_counters.auths++;
+    host::charge_us(host::costs().rfid_auth_us);
+    count_command_spi(20, host::costs().rfid_auth_us);
+
+    expire_cards();
+    if (active_card == nullptr || !in_field(*active_card) || block_addr >= 64)
+    {
+        return STATUS_TIMEOUT;
+    }
+    if (card_uid->size != active_card->card.uid_size ||
+        memcmp(card_uid->uidByte, active_card->card.uid, card_uid->size) != 0)
+    {
+        return STATUS_TIMEOUT;
+    }
+
+    const byte *trailer = active_card->card.blocks[(block_addr / 4) * 4 + 3];
+    const byte *stored_key = (command == PICC_CMD_MF_AUTH_KEY_A) ? &trailer[0] : &trailer[10];
+    if (memcmp(stored_key, key->keyByte, 6) != 0)
+    {
+        active_card->state = CARD_IDLE;
+        active_card = nullptr;
+        return STATUS_TIMEOUT;
+    }
+
+    authenticated_sector = block_addr / 4;
+    return STATUS_OK;
+}
+
+/*!
+* @brief Function to read one 16 byte block (plus 2 CRC bytes) from the selected card.
+* @return The status of the read.
+*/
+MFRC522::StatusCode
+MFRC522::MIFARE_Read(byte block_addr, byte *buffer, byte *buffer_size)
+{
+    rfid_counters.reads++;
+    host::charge_us(host::costs().rfid_read_us);
+    count_command_spi(8, host::costs().rfid_read_us);
+
+    if (buffer == nullptr || *buffer_size < 18)
+    {
+        return STATUS_NO_ROOM;
+    }
+    if (active_card == nullptr || !in_field(*active_card) || block_addr >= 64 ||
+        authenticated_sector != block_addr / 4)
+    {
+        return STATUS_TIMEOUT;
+    }
+
+    memcpy(buffer, active_card->card.blocks[block_addr], 16);
+    buffer[16] = 0;
+    buffer[17] = 0;
+    *buffer_size = 18;
+    return STATUS_OK;
+}
+
+/*!
+* @brief Function to write one 16 byte block to the selected card.
+* @return The status of the write.
+*/
+MFRC522::StatusCode
+MFRC522::MIFARE_Write(byte block_addr, byte *buffer, byte buffer_size)
+{
+    rfid_counters.writes++;
+    host::charge_us(host::costs().rfid_write_us);
+    count_command_spi(30, host::costs().rfid_write_us);
+
+    if (buffer == nullptr || buffer_size < 16)
+    {
+        return STATUS_INVALID;
+    }
+    if (active_card == nullptr || !in_field(*active_card) || block_addr >= 64 ||
+        authenticated_sector != block_addr / 4)
+    {
+        return STATUS_TIMEOUT;
+    }
+
+    memcpy(active_card->card.blocks[block_addr], buffer, 16);
+    return STATUS_OK;
+}
+
+/*!
+* @brief Function to halt the selected card, it stays silent until it leaves the field.
+* @return The status of the command.
+*/
+MFRC522::StatusCode
+MFRC522::PICC_HaltA()
+{
+    host::charge_us(host::costs().rfid_halt_us);
+    count_command_spi(8, host::costs().rfid_halt_us);
+
+    if (active_card != nullptr)
+    {
+        active_card->state = CARD_HALT;
+        active_card = nullptr;
+    }
+    return STATUS_OK;
+}
+
+void
+MFRC522::PCD_StopCrypto1()
+{
+    authenticated_sector = -1;
+}
+
+const __FlashStringHelper *
+MFRC522::GetStatusCodeName(StatusCode code)
+{
+    switch (code)
+    {
+        case STATUS_OK:             return F("Success.");
+        case STATUS_ERROR:          return F("Error in communication.");
+        case STATUS_COLLISION:      return F("Collision detected.");
+        case STATUS_TIMEOUT:        return F("Timeout in communication.");
+        case STATUS_NO_ROOM:        return F("A buffer is not big enough.");
+        case STATUS_INTERNAL_ERROR: return F("Internal error in the code. Should not happen.");
+        case STATUS_INVALID:        return F("Invalid argument.");
+        case STATUS_CRC_WRONG:      return F("The CRC_A does not match.");
+        case STATUS_MIFARE_NACK:    return F("A MIFARE PICC responded with NAK.");
+        default:                    return F("Unknown error");
+    }
+}
+
+const __FlashStringHelper *
+MFRC522::PICC_GetTypeName(PICC_Type type)
+{
+    switch (type)
+    {
+        case PICC_TYPE_MIFARE_1K:   return F("MIFARE 1KB");
+        case PICC_TYPE_MIFARE_4K:   return F("MIFARE 4KB");
+        case PICC_TYPE_MIFARE_MINI: return F("MIFARE Mini, 320 bytes");
+        case PICC_TYPE_MIFARE_UL:   return F("MIFARE Ultralight or Ultralight C");
+        default:                    return F("Unknown type");
+    }
+}
@@ -0,0 +1,125 @@
+/** @file MFRC522.h
+*
+* @brief Host implementation of the MFRC522 library API used by the firmware.
+*        Cards come from the scripted presentations queued through
+*        host::present_card and follow the ISO 14443A IDLE, READY, ACTIVE and
+*        HALT states, so a halted card is not reported again until it leaves
+*        the field. Every command is charged to the virtual clock and its
+*        SPI traffic is estimated. The registers needed to start a REQA
+*        and get a receive interrupt on the IRQ line are modelled as well.
+*
+*
+*/
+
+#ifndef MFRC522_H
+#define MFRC522_H
+
+#include <Arduino.h>
+#include <SPI.h>
+
+class MFRC522
+{
+public:
+
+    // Registers, shifted like the SPI address byte
+    //
+    enum PCD_Register : byte
+    {
+        CommandReg    = 0x01 << 1,
+        ComIEnReg     = 0x02 << 1,
+        DivIEnReg     = 0x03 << 1,
+        ComIrqReg     = 0x04 << 1,
+        DivIrqReg     = 0x05 << 1,
+        ErrorReg      = 0x06 << 1,
+        Status1Reg    = 0x07 << 1,
+        Status2Reg    = 0x08 << 1,
+        FIFODataReg   = 0x09 << 1,
+        FIFOLevelReg  = 0x0A << 1,
+        ControlReg    = 0x0C << 1,
+        BitFramingReg = 0x0D << 1,
+        CollReg       = 0x0E << 1
+    };
+
+    enum PCD_Command : byte
+    {
+        PCD_Idle       = 0x00,
+        PCD_Transceive = 0x0C,
+        PCD_SoftReset  = 0x0F
+    };
+
+    enum PICC_Command : byte
+    {
+        PICC_CMD_REQA          = 0x26,
+        PICC_CMD_WUPA          = 0x52,
+        PICC_CMD_HLTA          = 0x50,
+        PICC_CMD_MF_AUTH_KEY_A = 0x60,
+        PICC_CMD_MF_AUTH_KEY_B = 0x61,
+        PICC_CMD_MF_READ       = 0x30,
+        PICC_CMD_MF_WRITE      = 0xA0
+    };
+
+    enum PICC_Type : byte
+    {
+        PICC_TYPE_UNKNOWN,
+        PICC_TYPE_ISO_14443_4,
+        PICC_TYPE_ISO_18092,
+        PICC_TYPE_MIFARE_MINI,
+        PICC_TYPE_MIFARE_1K,
+        PICC_TYPE_MIFARE_4K,
+        PICC_TYPE_MIFARE_UL,
+        PICC_TYPE_MIFARE_PLUS,
+        PICC_TYPE_MIFARE_DESFIRE,
+        PICC_TYPE_TNP3XXX,
+        PICC_TYPE_NOT_COMPLETE = 0xff
+    };
+
+    enum StatusCode : byte
+    {
+        STATUS_OK,
+        STATUS_ERROR,
+        STATUS_COLLISION,
+        STATUS_TIMEOUT,
+        STATUS_NO_ROOM,
+        STATUS_INTERNAL_ERROR,
+        STATUS_INVALID,
+        STATUS_CRC_WRONG,
+        STATUS_MIFARE_NACK = 0xff
+    };
+
+    typedef struct
+    {
+        byte size;
+        byte uidByte[10];
+        byte sak;
+    } Uid;
+
+    typedef struct
+    {
+        byte keyByte[6];
+    } MIFARE_Key;
+
+    Uid uid;
+
+    MFRC522(byte chip_select_pin, byte reset_power_down_pin);
+
+    void PCD_Init();
+
+    void PCD_WriteRegister(PCD_Register reg, byte value);
+    void PCD_WriteRegister(PCD_Register reg, byte count, byte *values);
+    byte PCD_ReadRegister(PCD_Register reg);
+
+    bool PICC_IsNewCardPresent();
+    bool PICC_ReadCardSerial();
+    static PICC_Type PICC_GetType(byte sak);
+
+    StatusCode PCD_Authenticate(byte command, byte block_addr, MIFARE_Key *key, Uid *card_uid);
+    StatusCode MIFARE_Read(byte block_addr, byte *buffer, byte *buffer_size);
+    StatusCode MIFARE_Write(byte block_addr, byte *buffer, byte buffer_size);
+    StatusCode PICC_HaltA();
+    void       PCD_StopCrypto1();
+
+    static const __FlashStringHelper *GetStatusCodeName(StatusCode code);
+    static const __FlashStringHelper *PICC_GetTypeName(PICC_Type type);
+};
+
+#endif  // End of MFRC522_H
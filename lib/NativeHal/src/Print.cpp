@@ -0,0 +1,54 @@
+#include "Print.h"
+
+#include <string.h>
+
+size_t
+Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--)
+    {
+        if (write(*buffer++))
+        {
+            n++;
+        }
+        else
+        {
+            break;
+        }
+    }
+    return n;
+}
+
+size_t
+Print::write(const char *str)
+{
+    if (str == nullptr)
+    {
+        return 0;
+    }
+    return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::print(const __FlashStringHelper *str)      { return write(reinterpret_cast<const char *>(str)); }
+size_t Print::print(const String &str)                   { return write(str.c_str(), str.length()); }
+size_t Print::print(const char *str)                     { return write(str); }
+size_t Print::print(char c)                              { return write((uint8_t)c); }
+size_t Print::print(unsigned char value, int base)       { return print(String(value, (unsigned char)base)); }
+size_t Print::print(int value, int base)                 { return print(String(value, (unsigned char)base)); }
+size_t Print::print(unsigned int value, int base)        { return print(String(value, (unsigned char)base)); }
+size_t Print::print(long value, int base)                { return print(String(value, (unsigned char)base)); }
+size_t Print::print(unsigned long value, int base)       { return print(String(value, (unsigned char)base)); }
+size_t Print::print(double value, int digits)            { return print(String(value, (unsigned char)digits)); }
+
+size_t Print::println()                                  { return write("\r\n"); }
+size_t Print::println(const __FlashStringHelper *str)    { size_t n = print(str); return n + println(); }
+size_t Print::println(const String &str)                 { size_t n = print(str); return n + println(); }
+size_t Print::println(const char *str)                   { size_t n = print(str); return n + println(); }
+size_t Print::println(char c)                            { size_t n = print(c); return n + println(); }
+size_t Print::println(unsigned char value, int base)     { size_t n = print(value, base); return n + println(); }
+size_t Print::println(int value, int base)               { size_t n = print(value, base); return n + println(); }
+size_t Print::println(unsigned int value, int base)      { size_t n = print(value, base); return n + println(); }
+size_t Print::println(long value, int base)              { size_t n = print(value, base); return n + println(); }
+size_t Print::println(unsigned long value, int base)     { size_t n = print(value, base); return n + println(); }
+size_t Print::println(double value, int digits)          { size_t n = print(value, digits); return n + println(); }
@@ -0,0 +1,54 @@
+/** @file Print.h
+*
+* @brief Host implementation of the Arduino Print base class.
+*
+*
+*/
+
+#ifndef PRINT_H
+#define PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "WString.h"
+
+class __FlashStringHelper;
+
+class Print
+{
+public:
+
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str);
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper *str);
+    size_t print(const String &str);
+    size_t print(const char *str);
+    size_t print(char c);
+    size_t print(unsigned char value, int base = 10);
+    size_t print(int value, int base = 10);
+    size_t print(unsigned int value, int base = 10);
+    size_t print(long value, int base = 10);
+    size_t print(unsigned long value, int base = 10);
+    size_t print(double value, int digits = 2);
+
+    size_t println(const __FlashStringHelper *str);
+    size_t println(const String &str);
+    size_t println(const char *str);
+    size_t println(char c);
+    size_t println(unsigned char value, int base = 10);
+    size_t println(int value, int base = 10);
+    size_t println(unsigned int value, int base = 10);
+    size_t println(long value, int base = 10);
+    size_t println(unsigned long value, int base = 10);
+    size_t println(double value, int digits = 2);
+    size_t println();
+};
+
+#endif  // End of PRINT_H
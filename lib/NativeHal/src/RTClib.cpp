@@ -0,0 +1,164 @@
+#include "RTClib.h"
+#include "HostHal.h"
+
+// 2025-01-06 08:00:00, a Monday morning
+//
+static uint32_t rtc_base_unixtime = 1736150400UL;
+static uint64_t rtc_base_us       = 0;
+
+/*!
+* @brief Function to count the days since 1970-01-01 of a civil date.
+* @param[in] y int of the year.
+* @param[in] m unsigned of the month (1-12).
+* @param[in] d unsigned of the day (1-31).
+* @return The number of days since the epoch.
+*/
+static long
+days_from_civil(int y, unsigned m, unsigned d)
+{
+    y -= (m <= 2);
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (long)era * 146097 + (long)doe - 719468;
+}
+
+/*!
+* @brief Function to convert two ASCII digits.
+* @param[in] p const char * to the digits (a leading space counts as 0).
+* @return The value.
+*/
+static uint8_t
+conv2d(const char *p)
+{
+    uint8_t v = 0;
+    if ('0' <= *p && *p <= '9')
+    {
+        v = *p - '0';
+    }
+    return 10 * v + *++p - '0';
+}
+
+DateTime::DateTime(uint32_t t)
+{
+    long days = (long)(t / 86400UL);
+    uint32_t rem = t % 86400UL;
+
+    ss = rem % 60;
+    rem /= 60;
+    mm = rem % 60;
+    hh = rem / 60;
+
+    // Civil from days (H. Hinnant)
+    //
+    days += 719468;
+    const long era = days / 146097;
+    const unsigned doe = (unsigned)(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int y = (int)yoe + (int)era * 400;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    m = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+    y += (m <= 2);
+    yOff = (uint8_t)(y - 2000);
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec)
+{
+    if (year >= 2000U)
+    {
+        year -= 2000U;
+    }
+    yOff = (uint8_t)year;
+    m = month;
+    d = day;
+    hh = hour;
+    mm = min;
+    ss = sec;
+}
+
+DateTime::DateTime(const char *date, const char *time)
+{
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+    yOff = conv2d(date + 9);
+    m = 1;
+    for (uint8_t i = 0; i < 12; i++)
+    {
+        if (strncmp(date, &months[i * 3], 3) == 0)
+        {
+            m = i + 1;
+            break;
+        }
+    }
+    d = conv2d(date + 4);
+    hh = conv2d(time);
+    mm = conv2d(time + 3);
+    ss = conv2d(time + 6);
+}
+
+DateTime::DateTime(const __FlashStringHelper *date, const __FlashStringHelper *time)
+    : DateTime(reinterpret_cast<const char *>(date), reinterpret_cast<const char *>(time)) {}
+
+uint8_t
+DateTime::dayOfTheWeek() const
+{
+    long days = days_from_civil(2000 + yOff, m, d);
+    return (uint8_t)((days + 4) % 7);  // 1970-01-01 was a Thursday
+}
+
+uint32_t
+DateTime::unixtime() const
+{
+    long days = days_from_civil(2000 + yOff, m, d);
+    return (uint32_t)(days * 86400L + hh * 3600L + mm * 60L + ss);
+}
+
+bool
+RTC_DS3231::begin(TwoWire *wire)
+{
+    (void)wire;
+    return true;
+}
+
+bool
+RTC_DS3231::lostPower()
+{
+    return false;
+}
+
+void
+RTC_DS3231::adjust(const DateTime &dt)
+{
+    host::rtc_set(dt.unixtime());
+}
+
+/*!
+* @brief Function to read the RTC, advancing with the virtual clock.
+* @return The current date and time.
+*/
+DateTime
+RTC_DS3231::now()
+{
+    uint64_t now_us = host::clock_now_us();
+    uint64_t elapsed_s = (now_us > rtc_base_us) ? (now_us - rtc_base_us) / 1000000ULL : 0;
+    return DateTime((uint32_t)(rtc_base_unixtime + elapsed_s));
+}
+
+namespace host
+{
+
+/*!
+* @brief Function to set the RTC time at the current clock instant.
+* @param[in] unixtime uint32_t of the wall clock time.
+*/
+void
+rtc_set(uint32_t unixtime)
+{
+    rtc_base_unixtime = unixtime;
+    rtc_base_us = clock_now_us();
+}
+
+}  // namespace host
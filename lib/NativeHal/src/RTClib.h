@@ -0,0 +1,54 @@
+/** @file RTClib.h
+*
+* @brief Host implementation of the parts of Adafruit RTClib used by the
+*        firmware. The DS3231 reads its time from the virtual clock on top
+*        of an adjustable base date.
+*
+*
+*/
+
+#ifndef RTCLIB_H
+#define RTCLIB_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define SECONDS_FROM_1970_TO_2000 946684800
+
+class DateTime
+{
+public:
+
+    DateTime(uint32_t t = SECONDS_FROM_1970_TO_2000);
+    DateTime(uint16_t year, uint8_t month, uint8_t day,
+             uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0);
+    DateTime(const char *date, const char *time);
+    DateTime(const __FlashStringHelper *date, const __FlashStringHelper *time);
+
+    uint16_t year() const     { return yOff + 2000U; }
+    uint8_t  month() const    { return m; }
+    uint8_t  day() const      { return d; }
+    uint8_t  hour() const     { return hh; }
+    uint8_t  minute() const   { return mm; }
+    uint8_t  second() const   { return ss; }
+    uint8_t  dayOfTheWeek() const;
+
+    uint32_t unixtime() const;
+    uint32_t secondstime() const { return unixtime() - SECONDS_FROM_1970_TO_2000; }
+
+protected:
+
+    uint8_t yOff, m, d, hh, mm, ss;
+};
+
+class RTC_DS3231
+{
+public:
+
+    bool     begin(TwoWire *wire = &Wire);
+    bool     lostPower();
+    void     adjust(const DateTime &dt);
+    DateTime now();
+};
+
+#endif  // End of RTCLIB_H
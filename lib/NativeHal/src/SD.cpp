@@ -0,0 +1,471 @@
+#include "SD.h"
+#include "HostHal.h"
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Sector size of the card, the unit the SD library writes back
+//
+static const uint32_t sd_sector_size = 512;
+
+static std::string   sd_root_dir = "sd";
+static host::SdStats sd_counters = {};
+
+SDClass SD;
+
+// Open file or directory on the host
+//
+struct HostFileHandle
+{
+    FILE        *fp       = nullptr;
+    DIR         *dir      = nullptr;
+    std::string  path;               // Host path
+    std::string  name;               // 8.3 style name reported to the firmware
+    bool         is_dirty = false;
+
+    ~HostFileHandle()
+    {
+        if (fp != nullptr)
+        {
+            fclose(fp);
+        }
+        if (dir != nullptr)
+        {
+            closedir(dir);
+        }
+    }
+};
+
+/*!
+* @brief Function to map a card path onto the backing directory.
+* @param[in] filepath const char * of the path used by the firmware.
+* @return The host path, folded to lower case as FAT names are case insensitive.
+*/
+static std::string
+host_path(const char *filepath)
+{
+    std::string path = sd_root_dir;
+    if (*filepath != '/')
+    {
+        path += '/';
+    }
+    for (const char *p = filepath; *p; p++)
+    {
+        path += (char)tolower((unsigned char)*p);
+    }
+    while (path.size() > 1 && path.back() == '/')
+    {
+        path.pop_back();
+    }
+    return path;
+}
+
+/*!
+* @brief Function to build the upper case short name of a path as the SD library reports it.
+* @param[in] path const std::string& of the host path.
+* @return The last path component in upper case.
+*/
+static std::string
+short_name(const std::string &path)
+{
+    size_t slash = path.find_last_of('/');
+    std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+    for (char &c : name)
+    {
+        c = (char)toupper((unsigned char)c);
+    }
+    return name;
+}
+
+/*!
+* @brief Function to check whether a host path is a directory.
+* @param[in] path const std::string& of the host path.
+* @return The status if the path is a directory.
+*/
+static bool
+is_host_directory(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+namespace host
+{
+
+/*!
+* @brief Function to select the directory that backs the card.
+* @param[in] dir const char * of the host directory.
+*/
+void
+sd_set_root(const char *dir)
+{
+    sd_root_dir = dir;
+    while (sd_root_dir.size() > 1 && sd_root_dir.back() == '/')
+    {
+        sd_root_dir.pop_back();
+    }
+}
+
+/*!
+* @brief Function to get the directory that backs the card.
+* @return The host directory.
+*/
+const char*
+sd_root()
+{
+    return sd_root_dir.c_str();
+}
+
+/*!
+* @brief Function to access the SD counters.
+* @return The modifiable counters.
+*/
+SdStats&
+sd_stats()
+{
+    return sd_counters;
+}
+
+}  // namespace host
+
+File::File() {}
+
+File::File(std::shared_ptr<HostFileHandle> file_handle) : handle(file_handle) {}
+
+File::operator bool() const
+{
+    return handle != nullptr && (handle->fp != nullptr || handle->dir != nullptr);
+}
+
+size_t
+File::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+/*!
+* @brief Function to write bytes, charging a sector write back whenever a sector fills.
+* @param[in] buffer const uint8_t * of the data.
+* @param[in] size size_t of the number of bytes.
+* @return The number of bytes written.
+*/
+size_t
+File::write(const uint8_t *buffer, size_t size)
+{
+    if (!*this || handle->fp == nullptr)
+    {
+        return 0;
+    }
+
+    long before = ftell(handle->fp);
+    size_t n = fwrite(buffer, 1, size, handle->fp);
+    long after = ftell(handle->fp);
+
+    if (n > 0)
+    {
+        handle->is_dirty = true;
+        sd_counters.bytes_written += (uint32_t)n;
+        host::charge_us((uint32_t)n * host::costs().sd_byte_us);
+
+        if (before >= 0 && after >= 0 && (uint32_t)before / sd_sector_size != (uint32_t)after / sd_sector_size)
+        {
+            host::charge_us(host::costs().sd_flush_us);
+        }
+    }
+    return n;
+}
+
+int
+File::availableForWrite()
+{
+    return (*this) ? (int)sd_sector_size : 0;
+}
+
+int
+File::available()
+{
+    if (!*this || handle->fp == nullptr)
+    {
+        return 0;
+    }
+    uint32_t pos = position();
+    uint32_t len = size();
+    return (len > pos) ? (int)(len - pos) : 0;
+}
+
+int
+File::read()
+{
+    uint8_t c;
+    return (read(&c, 1) == 1) ? c : -1;
+}
+
+/*!
+* @brief Function to read bytes from the current position.
+* @param[in] buffer void * to the destination.
+* @param[in] size uint16_t of the maximum number of bytes.
+* @return The number of bytes read, -1 on error.
+*/
+int
+File::read(void *buffer, uint16_t size)
+{
+    if (!*this || handle->fp == nullptr)
+    {
+        return -1;
+    }
+    size_t n = fread(buffer, 1, size, handle->fp);
+    sd_counters.bytes_read += (uint32_t)n;
+    host::charge_us((uint32_t)n * host::costs().sd_byte_us);
+    return (int)n;
+}
+
+int
+File::peek()
+{
+    if (!*this || handle->fp == nullptr)
+    {
+        return -1;
+    }
+    int c = fgetc(handle->fp);
+    if (c != EOF)
+    {
+        ungetc(c, handle->fp);
+        return c;
+    }
+    return -1;
+}
+
+/*!
+* @brief Function to write back the cached sector and directory entry.
+*/
+void
+File::flush()
+{
+    if (!*this || handle->fp == nullptr)
+    {
+        return;
+    }
+    fflush(handle->fp);
+    if (handle->is_dirty)
+    {
+        handle->is_dirty = false;
+        sd_counters.flushes++;
+        host::charge_us(host::costs().sd_flush_us);
+    }
+}
+
+bool
+File::seek(uint32_t pos)
+{
+    if (!*this || handle->fp == nullptr || pos > size())
+    {
+        return false;
+    }
+    return fseek(handle->fp, (long)pos, SEEK_SET) == 0;
+}
+
+uint32_t
+File::position()
+{
+    if (!*this || handle->fp == nullptr)
+    {
+        return 0;
+    }
+    long pos = ftell(handle->fp);
+    return (pos < 0) ? 0 : (uint32_t)pos;
+}
+
+uint32_t
+File::size()
+{
+    if (!*this || handle->fp == nullptr)
+    {
+        return 0;
+    }
+    fflush(handle->fp);
+    struct stat st;
+    if (fstat(fileno(handle->fp), &st) != 0)
+    {
+        return 0;
+    }
+    return (uint32_t)st.st_size;
+}
+
+void
+File::close()
+{
+    if (handle == nullptr)
+    {
+        return;
+    }
+    flush();
+    if (handle->fp != nullptr)
+    {
+        fclose(handle->fp);
+        handle->fp = nullptr;
+    }
+    if (handle->dir != nullptr)
+    {
+        closedir(handle->dir);
+        handle->dir = nullptr;
+    }
+    handle.reset();
+}
+
+const char*
+File::name()
+{
+    return (handle != nullptr) ? handle->name.c_str() : "";
+}
+
+bool
+File::isDirectory()
+{
+    return handle != nullptr && handle->dir != nullptr;
+}
+
+/*!
+* @brief Function to open the next entry of a directory.
+* @param[in] mode uint8_t of the open mode for the entry.
+* @return The next entry, or an invalid File at the end of the directory.
+*/
+File
+File::openNextFile(uint8_t mode)
+{
+    if (!isDirectory())
+    {
+        return File();
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(handle->dir)) != nullptr)
+    {
+        if (entry->d_name[0] == '.')
+        {
+            continue;
+        }
+        std::string relative = handle->path.substr(sd_root_dir.size()) + "/" + entry->d_name;
+        return SD.open(relative.c_str(), mode);
+    }
+    return File();
+}
+
+void
+File::rewindDirectory()
+{
+    if (isDirectory())
+    {
+        rewinddir(handle->dir);
+    }
+}
+
+/*!
+* @brief Function to mount the card, creating the backing directory when missing.
+* @param[in] cs_pin uint8_t of the chip select pin (unused on the host).
+* @return The status if the card is available.
+*/
+bool
+SDClass::begin(uint8_t cs_pin)
+{
+    (void)cs_pin;
+    if (!is_host_directory(sd_root_dir))
+    {
+        ::mkdir(sd_root_dir.c_str(), 0755);
+    }
+    return is_host_directory(sd_root_dir);
+}
+
+/*!
+* @brief Function to open a file or directory on the card.
+* @param[in] filepath const char * of the path on the card.
+* @param[in] mode uint8_t FILE_READ, FILE_WRITE (append, create) or O_RDWR,
+*            optionally with O_CREAT, to write at the seek position.
+* @return The opened File, invalid on failure.
+*/
+File
+SDClass::open(const char *filepath, uint8_t mode)
+{
+    std::shared_ptr<HostFileHandle> handle = std::make_shared<HostFileHandle>();
+    handle->path = host_path(filepath);
+    handle->name = short_name(handle->path);
+
+    sd_counters.opens++;
+    host::charge_us(host::costs().sd_open_us);
+
+    if (is_host_directory(handle->path))
+    {
+        handle->dir = opendir(handle->path.c_str());
+        return (handle->dir != nullptr) ? File(handle) : File();
+    }
+
+    if ((mode & O_WRITE) == 0)
+    {
+        handle->fp = fopen(handle->path.c_str(), "rb");
+    }
+    else if (mode & O_APPEND)
+    {
+        handle->fp = fopen(handle->path.c_str(), "a+b");
+        if (handle->fp != nullptr)
+        {
+            fseek(handle->fp, 0, SEEK_END);
+        }
+    }
+    else
+    {
+        // Writes land at the seek position, the file starts at position 0
+        //
+        handle->fp = fopen(handle->path.c_str(), "r+b");
+        if (handle->fp == nullptr && (mode & O_CREAT))
+        {
+            handle->fp = fopen(handle->path.c_str(), "w+b");
+        }
+    }
+
+    return (handle->fp != nullptr) ? File(handle) : File();
+}
+
+bool
+SDClass::exists(const char *filepath)
+{
+    struct stat st;
+    return stat(host_path(filepath).c_str(), &st) == 0;
+}
+
+bool
+SDClass::mkdir(const char *filepath)
+{
+    std::string path = host_path(filepath);
+    std::string partial;
+
+    // Create the intermediate directories like the SD library does
+    //
+    for (size_t i = 0; i <= path.size(); i++)
+    {
+        if (i == path.size() || (path[i] == '/' && i > 0))
+        {
+            partial = path.substr(0, i);
+            if (!is_host_directory(partial) && ::mkdir(partial.c_str(), 0755) != 0 && errno != EEXIST)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool
+SDClass::remove(const char *filepath)
+{
+    return ::unlink(host_path(filepath).c_str()) == 0;
+}
+
+bool
+SDClass::rmdir(const char *filepath)
+{
+    return ::rmdir(host_path(filepath).c_str()) == 0;
+}
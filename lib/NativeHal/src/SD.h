@@ -0,0 +1,90 @@
+/** @file SD.h
+*
+* @brief Host implementation of the Arduino SD library backed by a directory.
+*        Paths are folded to lower case like the FAT 8.3 names on the card,
+*        and every open, flush and byte moved is charged to the virtual
+*        clock and counted in host::sd_stats().
+*
+*
+*/
+
+#ifndef SD_H
+#define SD_H
+
+#include <Arduino.h>
+#include <memory>
+
+// Open flags of the SdFat layer below the SD library
+//
+#define O_READ     0x01
+#define O_WRITE    0x02
+#define O_RDWR     (O_READ | O_WRITE)
+#define O_APPEND   0x04
+#define O_CREAT    0x10
+
+#define FILE_READ  O_READ
+#define FILE_WRITE (O_READ | O_WRITE | O_CREAT | O_APPEND)
+
+struct HostFileHandle;
+
+class File : public Stream
+{
+public:
+
+    File();
+    File(std::shared_ptr<HostFileHandle> handle);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    int availableForWrite() override;
+
+    int  available() override;
+    int  read() override;
+    int  peek() override;
+    int  read(void *buffer, uint16_t size);
+    void flush() override;
+
+    bool     seek(uint32_t pos);
+    uint32_t position();
+    uint32_t size();
+    void     close();
+
+    const char* name();
+    bool isDirectory();
+    File openNextFile(uint8_t mode = FILE_READ);
+    void rewindDirectory();
+
+    operator bool() const;
+
+private:
+
+    std::shared_ptr<HostFileHandle> handle;
+};
+
+class SDClass
+{
+public:
+
+    bool begin(uint8_t cs_pin = 10);
+    void end() {}
+
+    File open(const char *filepath, uint8_t mode = FILE_READ);
+    File open(const String &filepath, uint8_t mode = FILE_READ) { return open(filepath.c_str(), mode); }
+
+    bool exists(const char *filepath);
+    bool exists(const String &filepath) { return exists(filepath.c_str()); }
+
+    bool mkdir(const char *filepath);
+    bool mkdir(const String &filepath)  { return mkdir(filepath.c_str()); }
+
+    bool remove(const char *filepath);
+    bool remove(const String &filepath) { return remove(filepath.c_str()); }
+
+    bool rmdir(const char *filepath);
+    bool rmdir(const String &filepath)  { return rmdir(filepath.c_str()); }
+};
+
+extern SDClass SD;
+
+#endif  // End of SD_H
@@ -0,0 +1,44 @@
+/** @file SPI.h
+*
+* @brief Host stand-in for the Arduino SPI library. The devices on the bus
+*        are modelled inside their own fakes, so the bus itself only keeps
+*        a transfer counter.
+*
+*
+*/
+
+#ifndef SPI_H
+#define SPI_H
+
+#include <Arduino.h>
+
+#define MSBFIRST 1
+#define SPI_MODE0 0x00
+
+class SPISettings
+{
+public:
+    SPISettings() {}
+    SPISettings(uint32_t clock, uint8_t bit_order, uint8_t data_mode)
+    {
+        (void)clock;
+        (void)bit_order;
+        (void)data_mode;
+    }
+};
+
+class SPIClass
+{
+public:
+    void begin() {}
+    void end() {}
+    void beginTransaction(SPISettings settings) { (void)settings; }
+    void endTransaction() {}
+    uint8_t transfer(uint8_t data) { transfers++; (void)data; return 0; }
+
+    uint32_t transfers = 0;
+};
+
+extern SPIClass SPI;
+
+#endif  // End of SPI_H
@@ -0,0 +1,97 @@
+#include "Stream.h"
+
+String
+Stream::readString()
+{
+    String ret;
+    int c = read();
+    while (c >= 0)
+    {
+        ret += (char)c;
+        c = read();
+    }
+    return ret;
+}
+
+String
+Stream::readStringUntil(char terminator)
+{
+    String ret;
+    int c = read();
+    while (c >= 0 && c != terminator)
+    {
+        ret += (char)c;
+        c = read();
+    }
+    return ret;
+}
+
+size_t
+Stream::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = read();
+        if (c < 0)
+        {
+            break;
+        }
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+size_t
+Stream::readBytesUntil(char terminator, char *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = read();
+        if (c < 0 || c == terminator)
+        {
+            break;
+        }
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
+
+/*!
+* @brief Function to parse the next integer, skipping anything that is not a digit or '-'.
+* @return The parsed value, 0 when no digits are available.
+*/
+long
+Stream::parseInt()
+{
+    int c = peek();
+    while (c >= 0 && c != '-' && (c < '0' || c > '9'))
+    {
+        read();
+        c = peek();
+    }
+
+    bool negative = false;
+    long value = 0;
+    while (c >= 0)
+    {
+        if (c == '-')
+        {
+            negative = true;
+        }
+        else if (c >= '0' && c <= '9')
+        {
+            value = value * 10 + (c - '0');
+        }
+        else
+        {
+            break;
+        }
+        read();
+        c = peek();
+    }
+    return negative ? -value : value;
+}
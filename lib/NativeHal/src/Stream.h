@@ -0,0 +1,37 @@
+/** @file Stream.h
+*
+* @brief Host implementation of the Arduino Stream base class. Reads never
+*        block: a missing byte ends readStringUntil/parseInt the way the
+*        timeout does on the board.
+*
+*
+*/
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "Print.h"
+
+class Stream : public Print
+{
+public:
+
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout_ms) { timeout = timeout_ms; }
+    unsigned long getTimeout() const          { return timeout; }
+
+    String readString();
+    String readStringUntil(char terminator);
+    size_t readBytes(char *buffer, size_t length);
+    size_t readBytesUntil(char terminator, char *buffer, size_t length);
+    long   parseInt();
+
+protected:
+
+    unsigned long timeout = 1000;
+};
+
+#endif  // End of STREAM_H
@@ -0,0 +1,445 @@
+#include "WString.h"
+#include "HostHal.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*!
+* @brief Function to format an integer in the given base, as utoa/ltoa do on AVR.
+* @param[in] value unsigned long magnitude to format.
+* @param[in] base unsigned char radix between 2 and 16.
+* @param[in] negative bool prefix with a minus sign.
+* @return The formatted digits.
+*/
+static std::string
+format_integer(unsigned long value, unsigned char base, bool negative)
+{
+    if (base < 2 || base > 16)
+    {
+        base = 10;
+    }
+
+    char digits[sizeof(unsigned long) * 8 + 2];
+    size_t pos = sizeof(digits);
+    digits[--pos] = '\0';
+
+    do
+    {
+        unsigned long digit = value % base;
+        digits[--pos] = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value != 0);
+
+    if (negative)
+    {
+        digits[--pos] = '-';
+    }
+    return std::string(&digits[pos]);
+}
+
+/*!
+* @brief Function to format a signed integer, only base 10 keeps the sign as on AVR.
+* @param[in] value long value to format.
+* @param[in] base unsigned char radix.
+* @return The formatted digits.
+*/
+static std::string
+format_signed(long value, unsigned char base)
+{
+    if (base == 10 && value < 0)
+    {
+        return format_integer(0UL - (unsigned long)value, base, true);
+    }
+    return format_integer((unsigned long)value, base, false);
+}
+
+// Buffers the AVR core would have allocated or grown
+//
+static uint32_t heap_allocs = 0;
+
+namespace host
+{
+
+/*!
+* @brief Function to get the number of heap allocations the AVR String would
+*        have made so far.
+* @return The number of allocations.
+*/
+uint32_t
+string_allocs()
+{
+    return heap_allocs;
+}
+
+}  // namespace host
+
+/*!
+* @brief Function to count an allocation when the AVR String would need one:
+*        its buffer is allocated on the first content, even empty, and grown
+*        with realloc when the content outgrows it.
+* @param[in] size size_t of the content to hold.
+*/
+void
+String::note_size(size_t size)
+{
+    if (capacity < 0 || size > (size_t)capacity)
+    {
+        capacity = (int)size;
+        heap_allocs++;
+    }
+}
+
+String::String(const char *cstr) : buffer(cstr ? cstr : "") { note_size(buffer.length()); }
+
+String::String(const String &str) : buffer(str.buffer) { note_size(buffer.length()); }
+
+String::String(const __FlashStringHelper *str) : buffer(str ? reinterpret_cast<const char *>(str) : "") { note_size(buffer.length()); }
+
+String::String(char c) : buffer(1, c) { note_size(buffer.length()); }
+
+String::String(unsigned char value, unsigned char base) : buffer(format_integer(value, base, false)) { note_size(buffer.length()); }
+
+String::String(int value, unsigned char base) : buffer(format_signed(value, base)) { note_size(buffer.length()); }
+
+String::String(unsigned int value, unsigned char base) : buffer(format_integer(value, base, false)) { note_size(buffer.length()); }
+
+String::String(long value, unsigned char base) : buffer(format_signed(value, base)) { note_size(buffer.length()); }
+
+String::String(unsigned long value, unsigned char base) : buffer(format_integer(value, base, false)) { note_size(buffer.length()); }
+
+String::String(float value, unsigned char decimal_places) : String((double)value, decimal_places) {}
+
+String::String(double value, unsigned char decimal_places)
+{
+    char text[64];
+    snprintf(text, sizeof(text), "%.*f", (int)decimal_places, value);
+    buffer = text;
+    note_size(buffer.length());
+}
+
+String&
+String::operator=(const String &rhs)
+{
+    buffer = rhs.buffer;
+    note_size(buffer.length());
+    return *this;
+}
+
+String&
+String::operator=(const char *cstr)
+{
+    buffer = cstr ? cstr : "";
+    note_size(buffer.length());
+    return *this;
+}
+
+bool String::concat(const String &str)   { buffer += str.buffer; note_size(buffer.length()); return true; }
+bool String::concat(const char *cstr)    { if (!cstr) return false; buffer += cstr; note_size(buffer.length()); return true; }
+bool String::concat(char c)              { buffer += c; note_size(buffer.length()); return true; }
+bool String::concat(int num)             { buffer += format_signed(num, 10); note_size(buffer.length()); return true; }
+bool String::concat(unsigned int num)    { buffer += format_integer(num, 10, false); note_size(buffer.length()); return true; }
+bool String::concat(long num)            { buffer += format_signed(num, 10); note_size(buffer.length()); return true; }
+bool String::concat(unsigned long num)   { buffer += format_integer(num, 10, false); note_size(buffer.length()); return true; }
+
+int
+String::compareTo(const String &s) const
+{
+    return strcmp(buffer.c_str(), s.buffer.c_str());
+}
+
+bool
+String::equals(const String &s) const
+{
+    return buffer == s.buffer;
+}
+
+bool
+String::equals(const char *cstr) const
+{
+    return buffer == (cstr ? cstr : "");
+}
+
+bool
+String::equalsIgnoreCase(const String &s) const
+{
+    if (buffer.length() != s.buffer.length())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < buffer.length(); i++)
+    {
+        if (tolower((unsigned char)buffer[i]) != tolower((unsigned char)s.buffer[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+String::startsWith(const String &prefix) const
+{
+    return startsWith(prefix, 0);
+}
+
+bool
+String::startsWith(const String &prefix, unsigned int offset) const
+{
+    if (offset > buffer.length() || prefix.buffer.length() > buffer.length() - offset)
+    {
+        return false;
+    }
+    return buffer.compare(offset, prefix.buffer.length(), prefix.buffer) == 0;
+}
+
+bool
+String::endsWith(const String &suffix) const
+{
+    if (suffix.buffer.length() > buffer.length())
+    {
+        return false;
+    }
+    return buffer.compare(buffer.length() - suffix.buffer.length(), suffix.buffer.length(), suffix.buffer) == 0;
+}
+
+char
+String::charAt(unsigned int index) const
+{
+    return (*this)[index];
+}
+
+void
+String::setCharAt(unsigned int index, char c)
+{
+    if (index < buffer.length())
+    {
+        buffer[index] = c;
+    }
+}
+
+char
+String::operator[](unsigned int index) const
+{
+    return (index < buffer.length()) ? buffer[index] : '\0';
+}
+
+char&
+String::operator[](unsigned int index)
+{
+    static char dummy_writable_char;
+    if (index >= buffer.length())
+    {
+        dummy_writable_char = '\0';
+        return dummy_writable_char;
+    }
+    return buffer[index];
+}
+
+void
+String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const
+{
+    if (!bufsize || !buf)
+    {
+        return;
+    }
+    if (index >= buffer.length())
+    {
+        buf[0] = '\0';
+        return;
+    }
+    unsigned int n = bufsize - 1;
+    if (n > buffer.length() - index)
+    {
+        n = buffer.length() - index;
+    }
+    memcpy(buf, buffer.data() + index, n);
+    buf[n] = '\0';
+}
+
+void
+String::toCharArray(char *buf, unsigned int bufsize, unsigned int index) const
+{
+    getBytes((unsigned char *)buf, bufsize, index);
+}
+
+unsigned char
+String::reserve(unsigned int size)
+{
+    buffer.reserve(size);
+    note_size(size);
+    return 1;
+}
+
+int
+String::indexOf(char ch) const
+{
+    return indexOf(ch, 0);
+}
+
+int
+String::indexOf(char ch, unsigned int from_index) const
+{
+    size_t pos = buffer.find(ch, from_index);
+    return (pos == std::string::npos) ? -1 : (int)pos;
+}
+
+int
+String::indexOf(const String &str) const
+{
+    return indexOf(str, 0);
+}
+
+int
+String::indexOf(const String &str, unsigned int from_index) const
+{
+    if (from_index >= buffer.length())
+    {
+        return -1;
+    }
+    size_t pos = buffer.find(str.buffer, from_index);
+    return (pos == std::string::npos) ? -1 : (int)pos;
+}
+
+int
+String::lastIndexOf(char ch) const
+{
+    size_t pos = buffer.rfind(ch);
+    return (pos == std::string::npos) ? -1 : (int)pos;
+}
+
+int
+String::lastIndexOf(const String &str) const
+{
+    size_t pos = buffer.rfind(str.buffer);
+    return (pos == std::string::npos) ? -1 : (int)pos;
+}
+
+String
+String::substring(unsigned int begin_index) const
+{
+    return substring(begin_index, (unsigned int)buffer.length());
+}
+
+String
+String::substring(unsigned int begin_index, unsigned int end_index) const
+{
+    if (begin_index > end_index)
+    {
+        unsigned int temp = end_index;
+        end_index = begin_index;
+        begin_index = temp;
+    }
+
+    String out;
+    if (begin_index >= buffer.length())
+    {
+        return out;
+    }
+    if (end_index > buffer.length())
+    {
+        end_index = (unsigned int)buffer.length();
+    }
+    out.buffer = buffer.substr(begin_index, end_index - begin_index);
+    return out;
+}
+
+void
+String::replace(char find, char replace_with)
+{
+    for (char &c : buffer)
+    {
+        if (c == find)
+        {
+            c = replace_with;
+        }
+    }
+}
+
+void
+String::replace(const String &find, const String &replace_with)
+{
+    if (find.buffer.empty())
+    {
+        return;
+    }
+    size_t pos = 0;
+    while ((pos = buffer.find(find.buffer, pos)) != std::string::npos)
+    {
+        buffer.replace(pos, find.buffer.length(), replace_with.buffer);
+        pos += replace_with.buffer.length();
+    }
+}
+
+void
+String::remove(unsigned int index)
+{
+    remove(index, (unsigned int)-1);
+}
+
+void
+String::remove(unsigned int index, unsigned int count)
+{
+    if (index >= buffer.length())
+    {
+        return;
+    }
+    buffer.erase(index, count);
+}
+
+void
+String::toLowerCase()
+{
+    for (char &c : buffer)
+    {
+        c = (char)tolower((unsigned char)c);
+    }
+}
+
+void
+String::toUpperCase()
+{
+    for (char &c : buffer)
+    {
+        c = (char)toupper((unsigned char)c);
+    }
+}
+
+void
+String::trim()
+{
+    size_t begin = 0;
+    size_t end = buffer.length();
+
+    while (begin < end && isspace((unsigned char)buffer[begin]))
+    {
+        begin++;
+    }
+    while (end > begin && isspace((unsigned char)buffer[end - 1]))
+    {
+        end--;
+    }
+    buffer = buffer.substr(begin, end - begin);
+}
+
+long
+String::toInt() const
+{
+    return atol(buffer.c_str());
+}
+
+float
+String::toFloat() const
+{
+    return (float)atof(buffer.c_str());
+}
+
+String operator+(const String &lhs, const String &rhs)  { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, const char *rhs)    { String s(lhs); s.concat(rhs); return s; }
+String operator+(const char *lhs, const String &rhs)    { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, char rhs)           { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, int rhs)            { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, unsigned int rhs)   { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, long rhs)           { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, unsigned long rhs)  { String s(lhs); s.concat(rhs); return s; }
@@ -0,0 +1,131 @@
+/** @file WString.h
+*
+* @brief Host implementation of the Arduino String class, following the
+*        semantics of the AVR core (clamped substring, in-place trim and
+*        case conversion, toInt via atol). The heap allocations the AVR core
+*        would make are counted, see host::string_allocs().
+*
+*
+*/
+
+#ifndef WSTRING_H
+#define WSTRING_H
+
+#include <stdint.h>
+#include <string>
+
+class __FlashStringHelper;
+
+class String
+{
+public:
+
+    String(const char *cstr = "");
+    String(const String &str);
+    String(const __FlashStringHelper *str);
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimal_places = 2);
+    explicit String(double value, unsigned char decimal_places = 2);
+
+    String& operator=(const String &rhs);
+    String& operator=(const char *cstr);
+
+    // Concatenation
+    //
+    bool concat(const String &str);
+    bool concat(const char *cstr);
+    bool concat(char c);
+    bool concat(int num);
+    bool concat(unsigned int num);
+    bool concat(long num);
+    bool concat(unsigned long num);
+
+    String& operator+=(const String &rhs)    { concat(rhs); return *this; }
+    String& operator+=(const char *cstr)     { concat(cstr); return *this; }
+    String& operator+=(char c)               { concat(c); return *this; }
+    String& operator+=(int num)              { concat(num); return *this; }
+    String& operator+=(unsigned int num)     { concat(num); return *this; }
+    String& operator+=(long num)             { concat(num); return *this; }
+    String& operator+=(unsigned long num)    { concat(num); return *this; }
+
+    // Comparison
+    //
+    int  compareTo(const String &s) const;
+    bool equals(const String &s) const;
+    bool equals(const char *cstr) const;
+    bool equalsIgnoreCase(const String &s) const;
+    bool startsWith(const String &prefix) const;
+    bool startsWith(const String &prefix, unsigned int offset) const;
+    bool endsWith(const String &suffix) const;
+
+    bool operator==(const String &rhs) const { return equals(rhs); }
+    bool operator==(const char *cstr) const  { return equals(cstr); }
+    bool operator!=(const String &rhs) const { return !equals(rhs); }
+    bool operator!=(const char *cstr) const  { return !equals(cstr); }
+    bool operator<(const String &rhs) const  { return compareTo(rhs) < 0; }
+    bool operator>(const String &rhs) const  { return compareTo(rhs) > 0; }
+    bool operator<=(const String &rhs) const { return compareTo(rhs) <= 0; }
+    bool operator>=(const String &rhs) const { return compareTo(rhs) >= 0; }
+
+    // Character access
+    //
+    char  charAt(unsigned int index) const;
+    void  setCharAt(unsigned int index, char c);
+    char  operator[](unsigned int index) const;
+    char& operator[](unsigned int index);
+    void  getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const;
+    void  toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const;
+    const char* c_str() const   { return buffer.c_str(); }
+    unsigned int length() const { return (unsigned int)buffer.length(); }
+    unsigned char reserve(unsigned int size);
+
+    // Search
+    //
+    int indexOf(char ch) const;
+    int indexOf(char ch, unsigned int from_index) const;
+    int indexOf(const String &str) const;
+    int indexOf(const String &str, unsigned int from_index) const;
+    int lastIndexOf(char ch) const;
+    int lastIndexOf(const String &str) const;
+
+    String substring(unsigned int begin_index) const;
+    String substring(unsigned int begin_index, unsigned int end_index) const;
+
+    // Modification
+    //
+    void replace(char find, char replace_with);
+    void replace(const String &find, const String &replace_with);
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    // Parsing
+    //
+    long  toInt() const;
+    float toFloat() const;
+
+private:
+
+    void note_size(size_t size);
+
+    std::string buffer;
+    int capacity = -1;            // Buffer the AVR core would hold, -1 before the first content
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
+String operator+(const String &lhs, int rhs);
+String operator+(const String &lhs, unsigned int rhs);
+String operator+(const String &lhs, long rhs);
+String operator+(const String &lhs, unsigned long rhs);
+
+#endif  // End of WSTRING_H
@@ -0,0 +1,29 @@
+/** @file Wire.h
+*
+* @brief Host stand-in for the Arduino Wire (I2C) library. The devices on the
+*        bus are modelled inside their own fakes.
+*
+*
+*/
+
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <Arduino.h>
+
+class TwoWire
+{
+public:
+    void    begin() {}
+    void    setClock(uint32_t clock) { (void)clock; }
+    void    beginTransmission(uint8_t address) { (void)address; }
+    uint8_t endTransmission(bool stop = true) { (void)stop; return 0; }
+    size_t  write(uint8_t data) { (void)data; return 1; }
+    uint8_t requestFrom(uint8_t address, uint8_t quantity) { (void)address; (void)quantity; return 0; }
+    int     available() { return 0; }
+    int     read() { return -1; }
+};
+
+extern TwoWire Wire;
+
+#endif  // End of WIRE_H
@@ -4,11 +4,12 @@
 /*!
 * @brief Set the admin password.
 * @param[in] admin_password string saving the admin password.
+* @return The status if the password is held, false when the name pool is full.
 */
-void 
+bool 
 Admin::set_password(const String& admin_password) 
 {
-    password = admin_password;
+    return password.set(admin_password.c_str());
 }
 
 
@@ -19,7 +20,7 @@ Admin::set_password(const String& admin_password)
 String 
 Admin::get_password() const 
 {
-    return password;
+    return String(password.c_str());
 }
 
 
@@ -4,6 +4,16 @@
 #include "AuthenticationService.hpp"
 #include "RFIDreader.hpp"
 #include "Door.hpp"
+#include "LoopProfiler.hpp"
+#include "Scheduler.hpp"
+#include "LogWriter.hpp"
+#include "NamePool.hpp"
+#include "MemoryStats.hpp"
+
+// Free space required in the serial TX buffer before a table row is printed,
+// so printing never blocks the other tasks on a full buffer
+//
+const uint8_t report_row_tx_space = 48;
 
 // Initialize static variables
 //
@@ -12,6 +22,9 @@ AdminOperation::State AdminOperation::currentState = WAIT_FOR_CLI;
 String AdminOperation::username = "";
 String AdminOperation::password = "";
 bool AdminOperation::authenticated = false;
+uint16_t AdminOperation::report_row = 0;
+String   AdminOperation::enroll_name = "";
+uint32_t AdminOperation::enroll_empid = 0;
 Database* db = nullptr;
 Screen* screen = nullptr;
 
@@ -162,10 +175,14 @@ AdminOperation::delete_user(String empid)
 void 
 AdminOperation::register_user(String name, String uid)
 {
+    // A user left without its name or employee id would not be found
+    //
     User user;
-    user.set_name(name);
-    user.set_rfid(uid);
-
+    if (!user.set_name(name) || !user.set_rfid(uid))
+    {
+        Serial.println(F("Error: No room left for the user name!"));
+        return;
+    }
     
     db = Database::get_instance();
     db->write_user(user);
@@ -174,6 +191,242 @@ AdminOperation::register_user(String name, String uid)
 }
 
 
+/*!
+* @brief View one section of the loop profiler, scheduler and subsystem
+*        statistics.
+* @param[in] section uint16_t section to print, 0 for the first.
+* @return The next section, 0 after the last one.
+*/
+uint16_t 
+AdminOperation::stats_view(uint16_t section)
+{
+    switch (section)
+    {
+        case 0:
+            LoopProfiler::get_instance()->print_stats();
+            break;
+        case 1:
+            Serial.println();
+            LoopProfiler::get_instance()->print_histogram();
+            break;
+        case 2:
+            Serial.println();
+            LoopProfiler::get_instance()->print_boot_report();
+            break;
+        case 3:
+            Serial.println();
+            Scheduler::get_instance()->print_stats();
+            break;
+        case 4:
+            Serial.println();
+            Serial.print(F("LCD I2C bytes: "));
+            Serial.println(Screen::get_instance()->get_i2c_bytes());
+            UserStore::get_instance()->print_stats();
+            break;
+        case 5:
+            UserFilter::get_instance()->print_stats();
+            break;
+        case 6:
+            if (authService != nullptr)
+            {
+                authService->print_stats();
+            }
+            break;
+        case 7:
+            NamePool::get_instance()->print_stats();
+            break;
+        case 8:
+            MemoryStats::get_instance()->print_stats();
+            break;
+        case 9:
+            Serial.println();
+            RFIDreader::get_instance()->print_stats();
+            break;
+        default:
+            Serial.println();
+            LogWriter::get_instance()->print_stats();
+            return 0;
+    }
+    return section + 1;
+}
+
+
+/*!
+* @brief Reset the loop profiler and scheduler statistics.
+*/
+void 
+AdminOperation::stats_reset()
+{
+    LoopProfiler::get_instance()->reset();
+    Scheduler::get_instance()->reset_stats();
+    Screen::get_instance()->reset_i2c_bytes();
+    LogWriter::get_instance()->reset_stats();
+    UserStore::get_instance()->reset_stats();
+    UserFilter::get_instance()->reset_stats();
+    if (authService != nullptr)
+    {
+        authService->reset_stats();
+    }
+    NamePool::get_instance()->reset_stats();
+    MemoryStats::get_instance()->reset_stats();
+    RFIDreader::get_instance()->reset_stats();
+    Serial.println(F("Stats Reset."));
+}
+
+
+/*!
+* @brief Print the next row of a users or logs table, or the next section of
+*        the stats, when the serial buffer has room for it.
+* @param[in] report State PRINT_USERS, PRINT_LOGS, PRINT_SCANS, PRINT_USER_LOG
+*            or PRINT_STATS.
+* @return The status if the table is complete.
+*/
+bool 
+AdminOperation::print_report_row(State report)
+{
+    if (Serial.availableForWrite() < report_row_tx_space)
+    {
+        return false;
+    }
+
+    db = Database::get_instance();
+    if (report == PRINT_USERS)
+    {
+        report_row = db->display_users_row(report_row);
+    }
+    else if (report == PRINT_SCANS)
+    {
+        report_row = db->display_scans_row(report_row);
+    }
+    else if (report == PRINT_USER_LOG)
+    {
+        report_row = db->display_user_log_row(report_row);
+    }
+    else if (report == PRINT_STATS)
+    {
+        report_row = stats_view(report_row);
+    }
+    else
+    {
+        report_row = db->display_user_logs_row(report_row);
+    }
+    return report_row == 0;
+}
+
+
+/*!
+* @brief Function to have the next card in the field written for a user, a
+*        blank card or one of the same employee.
+* @param[in] empid const String& of the employee id of the user.
+* @return The status if the user is registered.
+*/
+bool 
+AdminOperation::start_card_write(const String &empid)
+{
+    uint32_t id;
+    UserRecord user;
+    if (!UserStore::parse_empid(empid.c_str(), id) || !UserStore::get_instance()->find_empid(id, user))
+    {
+        return false;
+    }
+
+    RFIDreader::get_instance()->encode_next_card(user.name, id);
+    return true;
+}
+
+/*!
+* @brief Function to report the card written once the encoder is done.
+* @return The status if the card was written or failed.
+*/
+bool 
+AdminOperation::print_card_write()
+{
+    RFIDreader *rfid = RFIDreader::get_instance();
+    switch (rfid->get_encode_status())
+    {
+        case RFIDreader::ENCODE_V2:
+            Serial.println(F("Card written, single block format."));
+            break;
+        case RFIDreader::ENCODE_V1:
+            Serial.println(F("Card written, name too long for the single block format."));
+            break;
+        case RFIDreader::ENCODE_NOT_BLANK:
+            Serial.println(F("Error: The card holds another employee, left unchanged!"));
+            break;
+        case RFIDreader::ENCODE_FAILED:
+            Serial.println(F("Error: Could not write the card!"));
+            break;
+        default:
+            return false;
+    }
+
+    // The UID tells which card of those near the reader was the one
+    //
+    const byte *uid = rfid->get_encode_uid();
+    if (rfid->get_encode_uid_size() > 0)
+    {
+        Serial.print(F("Card UID: "));
+        for (byte i = 0; i < rfid->get_encode_uid_size(); i++)
+        {
+            if (uid[i] < 0x10)
+            {
+                Serial.print(F("0"));
+            }
+            Serial.print(uid[i], HEX);
+        }
+        Serial.println();
+    }
+    rfid->cancel_encoding();
+    return true;
+}
+
+/*!
+* @brief Function to have the next blank card in the field written for the
+*        next user of the enrollment list.
+* @return The status if a user is left in the list.
+*/
+bool 
+AdminOperation::enroll_next_user()
+{
+    if (!Database::get_instance()->next_enrollment(enroll_name, enroll_empid))
+    {
+        return false;
+    }
+
+    Serial.print(F("Present a blank card for "));
+    Serial.print(enroll_name);
+    Serial.print(F(" ("));
+    Serial.print(enroll_empid);
+    Serial.println(F(")"));
+    RFIDreader::get_instance()->encode_next_card(enroll_name, enroll_empid);
+    return true;
+}
+
+/*!
+* @brief Function to register the user of the card written once the encoder
+*        is done, and move on to the next user of the list. A card refused
+*        or not written is retried with the same user.
+* @return The status if the enrollment list is done.
+*/
+bool 
+AdminOperation::print_enrollment()
+{
+    RFIDreader::EncodeStatus status = RFIDreader::get_instance()->get_encode_status();
+    if (!print_card_write())
+    {
+        return false;
+    }
+
+    if (status == RFIDreader::ENCODE_V2 || status == RFIDreader::ENCODE_V1)
+    {
+        Database::get_instance()->enroll_user(enroll_name, enroll_empid);
+        return !enroll_next_user();
+    }
+
+    RFIDreader::get_instance()->encode_next_card(enroll_name, enroll_empid);
+    return false;
+}
+
 /*!
 * @brief Main run method with state machine handling all admin operations.
 */
@@ -265,6 +518,12 @@ AdminOperation::run()
                 Serial.println("4. Register User");
                 Serial.println("5. Delete User");
                 Serial.println("6. Exit");
+                Serial.println(F("7. View Stats"));
+                Serial.println(F("8. Reset Stats"));
+                Serial.println(F("9. View Scans"));
+                Serial.println(F("10. Write Card"));
+                Serial.println(F("11. Enroll Cards"));
+                Serial.println(F("12. View User Log"));
                 currentState = WAIT_OPTION;
             }
             break;
@@ -283,6 +542,139 @@ AdminOperation::run()
                 }
             }
             break;
+        case READ_SCAN_DATE:
+            if (Serial.available())
+            {
+                String date = Serial.readStringUntil('\n');
+                date.trim();
+
+                // The end of the option line is still pending after parseInt
+                //
+                if (date.length() == 0)
+                {
+                    break;
+                }
+                Serial.println(date);
+                Serial.println();
+
+                db = Database::get_instance();
+                if (db->select_log_day(date))
+                {
+                    report_row = 0;
+                    currentState = PRINT_SCANS;
+                }
+                else
+                {
+                    Serial.println(F("No scans logged on this day"));
+                    Serial.println();
+                    Serial.println(F("Enter \"m\" to show the Menu"));
+                    currentState = WAIT_INPUT;
+                }
+            }
+            break;
+        case READ_LOG_EMPID:
+            if (Serial.available())
+            {
+                String empid = Serial.readStringUntil('\n');
+                empid.trim();
+
+                // The end of the option line is still pending after parseInt
+                //
+                if (empid.length() == 0)
+                {
+                    break;
+                }
+                Serial.println(empid);
+                Serial.println();
+
+                db = Database::get_instance();
+                if (db->select_user_log(empid))
+                {
+                    report_row = 0;
+                    currentState = PRINT_USER_LOG;
+                }
+                else
+                {
+                    Serial.println(F("User not found."));
+                    Serial.println();
+                    Serial.println(F("Enter \"m\" to show the Menu"));
+                    currentState = WAIT_INPUT;
+                }
+            }
+            break;
+        case READ_CARD_EMPID:
+            if (Serial.available())
+            {
+                String empid = Serial.readStringUntil('\n');
+                empid.trim();
+
+                // The end of the option line is still pending after parseInt
+                //
+                if (empid.length() == 0)
+                {
+                    break;
+                }
+                Serial.println(empid);
+                Serial.println();
+
+                if (start_card_write(empid))
+                {
+                    Serial.println(F("Present the card to write, \"m\" to cancel"));
+                    currentState = WRITE_CARD;
+                }
+                else
+                {
+                    Serial.println(F("User not found."));
+                    Serial.println();
+                    Serial.println(F("Enter \"m\" to show the Menu"));
+                    currentState = WAIT_INPUT;
+                }
+            }
+            break;
+        case WRITE_CARD:
+            if (Serial.available() && Serial.read() == 'm')
+            {
+                RFIDreader::get_instance()->cancel_encoding();
+                Serial.println(F("Card not written."));
+                currentState = SHOW_MENU;
+            }
+            else if (print_card_write())
+            {
+                Serial.println();
+                Serial.println(F("Enter \"m\" to show the Menu"));
+                currentState = WAIT_INPUT;
+            }
+            break;
+        case ENROLL_CARDS:
+            if (Serial.available() && Serial.read() == 'm')
+            {
+                RFIDreader::get_instance()->cancel_encoding();
+                Database::get_instance()->end_enrollment();
+                currentState = SHOW_MENU;
+            }
+            else if (print_enrollment())
+            {
+                Database::get_instance()->end_enrollment();
+                Serial.println();
+                Serial.println(F("Enter \"m\" to show the Menu"));
+                currentState = WAIT_INPUT;
+            }
+            break;
+        case PRINT_USERS:
+        case PRINT_LOGS:
+        case PRINT_SCANS:
+        case PRINT_USER_LOG:
+        case PRINT_STATS:
+            // One row or stats section per run, a long report does not hold up
+            // the other tasks
+            //
+            if (print_report_row(currentState))
+            {
+                Serial.println();
+                Serial.println(F("Enter \"m\" to show the Menu"));
+                currentState = WAIT_INPUT;
+            }
+            break;
         case WAIT_OPTION:
             if (Serial.available()) 
             {
@@ -291,10 +683,8 @@ AdminOperation::run()
                 switch (option) {
                     case 1:
                         Serial.println();
-                        user_view();
-                        Serial.println();
-                        Serial.println("Enter \"m\" to show the Menu");
-                        currentState = WAIT_INPUT;
+                        report_row = 0;
+                        currentState = PRINT_USERS;
                         break;
                     case 2:
                         admin_view();
@@ -304,10 +694,8 @@ AdminOperation::run()
                         break;
                     case 3:
                         Serial.println();
-                        view_log();
-                        Serial.println();
-                        Serial.println("Enter \"m\" to show menu");
-                        currentState = WAIT_INPUT;
+                        report_row = 0;
+                        currentState = PRINT_LOGS;
                         break;
                     case 4:
                         currentState = REGISTER_USER;
@@ -323,6 +711,44 @@ AdminOperation::run()
                         Serial.println("Exit. Enter CLI:");
                         currentState = WAIT_FOR_CLI;
                         break;
+                    case 7:
+                        Serial.println();
+                        report_row = 0;
+                        currentState = PRINT_STATS;
+                        break;
+                    case 8:
+                        stats_reset();
+                        currentState = SHOW_MENU;
+                        break;
+                    case 9:
+                        Serial.print(F("Enter date (d/m/yyyy):"));
+                        currentState = READ_SCAN_DATE;
+                        break;
+                    case 10:
+                        Serial.print(F("Enter employee id :"));
+                        currentState = READ_CARD_EMPID;
+                        break;
+                    case 12:
+                        Serial.print(F("Enter employee id :"));
+                        currentState = READ_LOG_EMPID;
+                        break;
+                    case 11:
+                        db = Database::get_instance();
+                        Serial.print(F("Users to enroll: "));
+                        Serial.println(db->begin_enrollment());
+                        if (enroll_next_user())
+                        {
+                            Serial.println(F("Enter \"m\" to stop"));
+                            currentState = ENROLL_CARDS;
+                        }
+                        else
+                        {
+                            db->end_enrollment();
+                            Serial.println();
+                            Serial.println(F("Enter \"m\" to show the Menu"));
+                            currentState = WAIT_INPUT;
+                        }
+                        break;
                     default:
                         Serial.println("Invalid Option. Try Again:");
                         currentState = SHOW_MENU;
@@ -3,8 +3,15 @@
 /*!
 * @brief Constructor.
 */
-AuthenticationService::AuthenticationService() {
+AuthenticationService::AuthenticationService() : clock_hand(0) {
     database = Database::get_instance();  // Initialize database instance
+    generation = database->get_user_generation();
+    memset(uid_cache, 0, sizeof(uid_cache));
+    for (uint8_t i = 0; i < auth_uid_cache_size; i++)
+    {
+        uid_cache[i].name = name_pool_none;
+    }
+    reset_stats();
 }
 
 
@@ -18,12 +25,20 @@ AuthenticationService::~AuthenticationService() {
 
 /*!
 * @brief Function to authenticate a user by RFID key eg.(name,employee_Id).
-* @param[in] rfid string of key to authenticate.
+* @param[in] rfid const char * of key to authenticate.
 * @return The status if user authenticated or not.
 */
 bool 
-AuthenticationService::authenticate_user(const String &rfid) {
+AuthenticationService::authenticate_user(const char *rfid) {
     
+    // Most unknown cards are rejected here, without reading the user store
+    //
+    UserFilter *filter = UserFilter::get_instance();
+    if (!filter->might_contain(rfid))
+    {
+        return false;
+    }
+
     if (database->is_user_present(rfid)) 
     {
         // DEBUG
@@ -35,9 +50,243 @@ AuthenticationService::authenticate_user(const String &rfid) {
     {
         // DEBUG
         // Serial.println("Authentication failed: User not found.");
+        filter->count_false_positive(rfid);
+        return false;
+    }
+
+}
+
+/*!
+* @brief Function to look a card up in the UID cache. Every few hits the card
+*        is dropped from the cache instead, so it is read, looked up and
+*        cached again.
+* @param[in] uid const byte * of the card UID.
+* @param[in] uid_size uint8_t of the UID.
+* @param[out] rfid char[card_key_size] receiving the key of an allowed card,
+*             empty for a denied one.
+* @return The status if the card is cached and not due for verification.
+*/
+bool 
+AuthenticationService::find_card(const byte *uid, uint8_t uid_size, char *rfid)
+{
+    check_generation();
+
+    UidCacheEntry *entry = find_entry(uid, uid_size);
+    if (entry == nullptr)
+    {
+        misses++;
+        return false;
+    }
+
+    if (++entry->hits >= auth_uid_verify_hits)
+    {
+        drop_entry(*entry);
+        verifications++;
         return false;
     }
 
+    hits++;
+    entry->is_referenced = true;
+    if (entry->is_allowed)
+    {
+        snprintf(rfid, card_key_size, "%s,%lu", NamePool::get_instance()->get(entry->name), (unsigned long)entry->empid);
+    }
+    else
+    {
+        rfid[0] = '\0';
+    }
+    return true;
+}
+
+/*!
+* @brief Function to authenticate a card, the decision of a cached card is
+*        reused and the one of a new card is cached.
+* @param[in] uid const byte * of the card UID.
+* @param[in] uid_size uint8_t of the UID.
+* @param[in] rfid const char * of key read from the card.
+* @return The status if user authenticated or not.
+*/
+bool 
+AuthenticationService::authenticate_card(const byte *uid, uint8_t uid_size, const char *rfid)
+{
+    check_generation();
+
+    UidCacheEntry *entry = find_entry(uid, uid_size);
+    if (entry != nullptr)
+    {
+        return entry->is_allowed;
+    }
+
+    bool is_allowed = authenticate_user(rfid);
+    remember(uid, uid_size, rfid, is_allowed);
+    return is_allowed;
+}
+
+/*!
+* @brief Function to drop the cached decision of a card.
+* @param[in] uid const byte * of the card UID.
+* @param[in] uid_size uint8_t of the UID.
+*/
+void 
+AuthenticationService::forget_card(const byte *uid, uint8_t uid_size)
+{
+    UidCacheEntry *entry = find_entry(uid, uid_size);
+    if (entry != nullptr)
+    {
+        drop_entry(*entry);
+    }
+}
+
+/*!
+* @brief Function to find the cache entry of a UID.
+* @param[in] uid const byte * of the card UID.
+* @param[in] uid_size uint8_t of the UID.
+* @return The entry, nullptr when the card is not cached.
+*/
+UidCacheEntry* 
+AuthenticationService::find_entry(const byte *uid, uint8_t uid_size)
+{
+    if (uid_size == 0 || uid_size > auth_uid_size)
+    {
+        return nullptr;
+    }
+
+    for (uint8_t i = 0; i < auth_uid_cache_size; i++)
+    {
+        if (uid_cache[i].uid_size == uid_size && memcmp(uid_cache[i].uid, uid, uid_size) == 0)
+        {
+            return &uid_cache[i];
+        }
+    }
+    return nullptr;
+}
+
+/*!
+* @brief Function to cache the decision of a card. The clock hand skips the
+*        entries used since it last passed, clearing their mark, and takes
+*        the first unused one.
+* @param[in] uid const byte * of the card UID.
+* @param[in] uid_size uint8_t of the UID.
+* @param[in] rfid const char * of key read from the card.
+* @param[in] is_allowed bool decision taken for the card.
+*/
+void 
+AuthenticationService::remember(const byte *uid, uint8_t uid_size, const char *rfid, bool is_allowed)
+{
+    if (uid_size == 0 || uid_size > auth_uid_size)
+    {
+        return;
+    }
+
+    // The key of an allowed card is the one of its user
+    //
+    uint8_t name_length = 0;
+    uint32_t empid = 0;
+    if (is_allowed && !UserStore::parse_card(rfid, name_length, empid))
+    {
+        return;
+    }
+
+    // An allowed card is not cached once the name pool is full
+    //
+    uint16_t name = name_pool_none;
+    if (is_allowed)
+    {
+        char user_name[user_name_size];
+        memcpy(user_name, rfid, name_length);
+        user_name[name_length] = '\0';
+
+        name = NamePool::get_instance()->intern(user_name);
+        if (name == name_pool_none)
+        {
+            return;
+        }
+    }
+
+    while (uid_cache[clock_hand].is_referenced)
+    {
+        uid_cache[clock_hand].is_referenced = false;
+        clock_hand = (clock_hand + 1) % auth_uid_cache_size;
+    }
+
+    UidCacheEntry &entry = uid_cache[clock_hand];
+    clock_hand = (clock_hand + 1) % auth_uid_cache_size;
+    drop_entry(entry);
+
+    memcpy(entry.uid, uid, uid_size);
+    entry.uid_size = uid_size;
+    entry.is_allowed = is_allowed;
+    entry.is_referenced = false;
+    entry.hits = 0;
+    entry.name = name;
+    entry.empid = empid;
+}
+
+/*!
+* @brief Function to clear the UID cache once users were added or removed.
+*/
+void 
+AuthenticationService::check_generation()
+{
+    if (generation == database->get_user_generation())
+    {
+        return;
+    }
+
+    generation = database->get_user_generation();
+    for (uint8_t i = 0; i < auth_uid_cache_size; i++)
+    {
+        drop_entry(uid_cache[i]);
+        uid_cache[i].is_referenced = false;
+    }
+    clock_hand = 0;
+    invalidations++;
+
+    // The names of the removed users are freed, their bytes given back now
+    //
+    NamePool::get_instance()->compact();
+}
+
+/*!
+* @brief Function to free a cache entry and release the name of its user.
+* @param[in] entry UidCacheEntry& freed.
+*/
+void 
+AuthenticationService::drop_entry(UidCacheEntry &entry)
+{
+    NamePool::get_instance()->release(entry.name);
+    entry.name = name_pool_none;
+    entry.uid_size = 0;
+}
+
+/*!
+* @brief Function to clear the UID cache counters.
+*/
+void 
+AuthenticationService::reset_stats()
+{
+    hits = 0;
+    misses = 0;
+    verifications = 0;
+    invalidations = 0;
+}
+
+/*!
+* @brief Function to display the UID cache counters in the terminal.
+*/
+void 
+AuthenticationService::print_stats()
+{
+    Serial.print(F("UID cache: "));
+    Serial.print((unsigned int)sizeof(uid_cache));
+    Serial.print(F(" bytes, hits "));
+    Serial.print(hits);
+    Serial.print(F(", misses "));
+    Serial.print(misses);
+    Serial.print(F(", verifications "));
+    Serial.print(verifications);
+    Serial.print(F(", invalidations "));
+    Serial.println(invalidations);
 }
 
 /*!
@@ -0,0 +1,53 @@
+#include "CardFormat.hpp"
+#include "LogFormat.hpp"
+#include <stddef.h>
+
+/*!
+* @brief Function to build the version 2 block of a card.
+* @param[out] block CardBlock to fill.
+* @param[in] name const char * of the user name.
+* @param[in] empid uint32_t employee id.
+* @return The status if the name fits in the block.
+*/
+bool 
+card_make_block(CardBlock &block, const char *name, uint32_t empid)
+{
+    size_t name_length = strlen(name);
+    if (name_length == 0 || name_length > card_name_size)
+    {
+        return false;
+    }
+
+    memset(&block, 0, sizeof(block));
+    block.empid = empid;
+    block.format = card_format_v2;
+    memcpy(block.name, name, name_length);
+    block.crc = log_crc16((const uint8_t *)&block, offsetof(CardBlock, crc));
+    return true;
+}
+
+/*!
+* @brief Function to check the block read from a card.
+* @param[in] block const CardBlock& read from block 8.
+* @return The status if the block is an intact version 2 block.
+*/
+bool 
+card_check_block(const CardBlock &block)
+{
+    return block.format == card_format_v2 &&
+           block.crc == log_crc16((const uint8_t *)&block, offsetof(CardBlock, crc));
+}
+
+/*!
+* @brief Function to build the card key of a version 2 block.
+* @param[in] block const CardBlock& checked by card_check_block().
+* @param[out] key char[card_key_size] receiving the key "name,empid".
+*/
+void 
+card_block_key(const CardBlock &block, char *key)
+{
+    char name[card_name_size + 1];
+    memcpy(name, block.name, card_name_size);
+    name[card_name_size] = '\0';
+    snprintf(key, card_key_size, "%s,%lu", name, (unsigned long)block.empid);
+}
@@ -1,20 +1,9 @@
 #include "Database.hpp"
 
-// Initialize the static RFID time maps
-//
-std::map<String, String> Database::rfid_start_time;
-std::map<String, String> Database::rfid_end_time;
-std::map<String, bool> Database::rfid_map;
-std::map<String, bool> Database::emp_map;
-
 // Initialize the Admins
 //
 std::vector<Admin> Database::admins;
 
-// Initialize the Users
-//
-std::vector<User> Database::users;
-
 // Initialize the static instance pointer to nullptr
 //
 Database *Database::instance = nullptr;
@@ -38,29 +27,10 @@ getMaxLengths(const std::vector<Admin>& admins, int& maxNameLength, int& maxPass
     }
 }
 
-/*!
-* @brief Function to get the max length of the name and password all the users present.
-* @param[in] users vector of users which will be checked.
-* @param[in] maxNameLength int of max name length which will be passed.
-* @param[in] maxEmpIDLength int of max employee id length which will be passed.
-*/
-void 
-getMaxLengthsUsers(const std::vector<User>& users, int& maxNameLength, int& maxEmpIDLength) 
-{
-    maxNameLength = 0;
-    maxEmpIDLength = 0;
-    
-    for (const auto& user : users) 
-    {
-        maxNameLength = max(maxNameLength, (int)user.get_name().length());
-        maxEmpIDLength = max(maxEmpIDLength, (int)user.get_rfid().length());
-    }
-}
-
 /*!
 * @brief Constructor.
 */
-Database::Database() {}
+Database::Database() : user_generation(0), enrolled(0), scan_day(0), log_position(0) {}
 
 /*!
 * @brief Destructor.
@@ -159,9 +129,14 @@ Database::load_admins()
             name.trim();
             password.trim();
             
+            // An admin left without its name or password would match empty credentials
+            //
             Admin admin;
-            admin.set_name(name);
-            admin.set_password(password);
+            if (!admin.set_name(name) || !admin.set_password(password))
+            {
+                Serial.println(F("Error: No room left for the admin names!"));
+                break;
+            }
 
             admins.push_back(admin);
 
@@ -172,10 +147,10 @@ Database::load_admins()
 
 /*!
 * @brief Function to update the admins size when new admin is added in SD card module.
-* @param[in] new_size uint8_t to the new size of the admins.
+* @param[in] new_size uint16_t to the new size of the admins.
 */
 void 
-Database::update_admin_size(uint8_t new_size)
+Database::update_admin_size(uint16_t new_size)
 {
     File input_file = SD.open(person_size_file.c_str(), FILE_READ);
 
@@ -217,26 +192,57 @@ Database::update_admin_size(uint8_t new_size)
 * @brief Function to get the admin size.
 * @return The admin size.
 */
-uint8_t 
+uint16_t 
 Database::get_admin_size()
 {
     return admin_size;
 }
 
 /*!
-* @brief Function to load the users stored inside SD card module.
+* @brief Function to open the user store on the SD card module. Users listed
+*        in a user file, as written before the store, are imported into it.
+*        The user filter is then built from the store.
 */
 void 
 Database::load_users() 
 {
-    
+    if (!UserStore::get_instance()->begin(user_store_file.c_str(), user_spare_file.c_str()))
+    {
+        Serial.println(F("Error: Could not open the user store!"));
+        return;
+    }
+
+    if (SD.exists(user_file.c_str()))
+    {
+        import_users();
+    }
+
+    UserFilter::get_instance()->build();
+}
+
+/*!
+* @brief Function to import the "name,empid" lines of the user file into the
+*        user store. The file is removed once imported, users already in the
+*        store are skipped, so an interrupted import is simply redone at the
+*        next boot.
+* @return The status if the user file was imported.
+*/
+bool 
+Database::import_users()
+{
     File file = SD.open(user_file.c_str());
     
     if (!file) 
     {
         Serial.println("Error: Could not open the user file!");
-        return;
+        return false;
     }
+
+    UserStore *store = UserStore::get_instance();
+    store->begin_batch();
+
+    uint32_t imported = 0;
+    uint32_t skipped = 0;
     
     while (file.available()) 
     {
@@ -250,13 +256,15 @@ Database::load_users()
             name.trim();
             rfid.trim();
 
-            update_emp_map(rfid);
-
-            User user;
-            user.set_name(name);
-            user.set_rfid(rfid);
-
-            users.push_back(user);
+            uint32_t empid;
+            if (UserStore::parse_empid(rfid.c_str(), empid) && store->add(name, empid))
+            {
+                imported++;
+            }
+            else
+            {
+                skipped++;
+            }
 
             // DEBUB
             //
@@ -264,24 +272,156 @@ Database::load_users()
             // Serial.print(name);
             // Serial.print(", RFID: ");
             // Serial.println(rfid);
-           
-            update_rfid_map(rfid);
             
         }
-        line.trim();
-        update_rfid_map(line);
     }
     
+    store->end_batch();
     file.close();
+    SD.remove(user_file.c_str());
+
+    Serial.print(F("Imported users: "));
+    Serial.print(imported);
+    Serial.print(F(", "));
+    Serial.print(skipped);
+    Serial.println(F(" skipped"));
+    return true;
+}
+
+/*!
+* @brief Function to split a "name,empid" line of a user list.
+* @param[in] line String of the line.
+* @param[out] name String of the user name.
+* @param[out] empid uint32_t employee id.
+* @return The status if the line holds a user.
+*/
+static bool
+parse_user_line(const String &line, String &name, uint32_t &empid)
+{
+    int comma_pos = line.indexOf(',');
+    if (comma_pos == -1)
+    {
+        return false;
+    }
+
+    String rfid = line.substring(comma_pos + 1);
+    name = line.substring(0, comma_pos);
+    name.trim();
+    rfid.trim();
+    return name.length() > 0 && name.length() < user_name_size &&
+           UserStore::parse_empid(rfid.c_str(), empid);
+}
+
+/*!
+* @brief Function to open the enrollment list, "name,empid" lines of the
+*        users waiting for their card. Each user is committed to the user
+*        store as soon as its card is written, an enrollment session may
+*        last for hours and a power cut must not lose the users whose
+*        cards were already handed out.
+* @return The number of users of the list which are not registered yet.
+*/
+uint16_t 
+Database::begin_enrollment()
+{
+    enroll_list = SD.open(enroll_file.c_str());
+    if (!enroll_list)
+    {
+        return 0;
+    }
 
+    UserStore *store = UserStore::get_instance();
+    uint16_t pending = 0;
+    String name;
+    uint32_t empid;
+    UserRecord user;
+    while (enroll_list.available())
+    {
+        String line = enroll_list.readStringUntil('\n');
+        if (parse_user_line(line, name, empid) && !store->find_empid(empid, user))
+        {
+            pending++;
+        }
+    }
+
+    enroll_list.seek(0);
+    enrolled = 0;
+    return pending;
+}
+
+/*!
+* @brief Function to get the next user of the enrollment list, the users
+*        already registered are skipped.
+* @param[out] name String of the user name.
+* @param[out] empid uint32_t employee id.
+* @return The status if a user is left in the list.
+*/
+bool 
+Database::next_enrollment(String &name, uint32_t &empid)
+{
+    UserRecord user;
+    while (enroll_list && enroll_list.available())
+    {
+        String line = enroll_list.readStringUntil('\n');
+        if (parse_user_line(line, name, empid) && !UserStore::get_instance()->find_empid(empid, user))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+* @brief Function to add a user whose card was written, committed at once:
+*        one leaf and the metadata page per card.
+* @param[in] name const String& of the user name.
+* @param[in] empid uint32_t employee id.
+* @return The status if the user was added.
+*/
+bool 
+Database::enroll_user(const String &name, uint32_t empid)
+{
+    if (!UserStore::get_instance()->add(name, empid, get_current_epoch() / 86400UL))
+    {
+        Serial.println(F("Error: Could not add the user!"));
+        return false;
+    }
+
+    UserFilter::get_instance()->add(name.c_str(), empid);
+    user_generation++;
+    enrolled++;
+    return true;
+}
+
+/*!
+* @brief Function to close the enrollment list. The list is removed once all
+*        its users are registered, otherwise the next enrollment resumes
+*        with the users left.
+*/
+void 
+Database::end_enrollment()
+{
+    if (!enroll_list)
+    {
+        return;
+    }
+
+    bool is_done = !enroll_list.available();
+    enroll_list.close();
+    if (is_done)
+    {
+        SD.remove(enroll_file.c_str());
+    }
+
+    Serial.print(F("Enrolled users: "));
+    Serial.println(enrolled);
 }
 
 /*!
 * @brief Function to update the users size when new user is added in SD card module.
-* @param[in] new_size uint8_t to the new size of the users.
+* @param[in] new_size uint16_t to the new size of the users.
 */
 void 
-Database::update_user_size(uint8_t new_size)
+Database::update_user_size(uint16_t new_size)
 {
     File input_file = SD.open(person_size_file.c_str(), FILE_READ);
 
@@ -323,21 +463,22 @@ Database::update_user_size(uint8_t new_size)
 * @brief Function to get the user size.
 * @return The user size.
 */
-uint8_t 
+uint16_t 
 Database::get_user_size()
 {
-    return user_size;
+    return UserStore::get_instance()->size();
 }
 
 /*!
 * @brief Function to check if user is present based on key(name,uuid).
-* @param[in] rfid string to the rfid present.
+* @param[in] rfid const char * of the key read from the card.
 * @return The status if present or not.
 */
 bool 
-Database::is_user_present(const String &rfid)
+Database::is_user_present(const char *rfid)
 {
-    return rfid_map[rfid];
+    UserRecord user;
+    return UserStore::get_instance()->find_card(rfid, user);
 }
 
 /*!
@@ -349,7 +490,9 @@ Database::is_user_present(const String &rfid)
 bool 
 Database::is_emp_present(const String &emp)
 {
-    return emp_map[emp];
+    uint32_t empid;
+    UserRecord user;
+    return UserStore::parse_empid(emp.c_str(), empid) && UserStore::get_instance()->find_empid(empid, user);
 }
 
 /*!
@@ -365,262 +508,351 @@ Database::write_user(const User &user)
 
     name.trim();
     rfid.trim();
-    String key=name+","+rfid;
-    update_emp_map(rfid);
-    update_rfid_map(key);
-    update_rfid_map(rfid);
 
-    File file = SD.open(user_file.c_str(), FILE_WRITE);
-    if (!file) 
+    uint32_t empid;
+    if (!UserStore::parse_empid(rfid.c_str(), empid) ||
+        !UserStore::get_instance()->add(name, empid, get_current_epoch() / 86400UL))
     {
-        Serial.println("Error: Could not open the user file!");
+        Serial.println(F("Error: Could not add the user!"));
         return;
     }
-    file.println(name + "," + rfid);
-    file.close();
 
-    users.push_back(user);
+    UserFilter::get_instance()->add(name.c_str(), empid);
+    user_generation++;
 }
 
 /*!
-* @brief Function to log user access information.
-* @param[in] rfid string of key(name,uuid) which is scanned from the rfid.
-* @param[in] date string of current date.
-* @param[in] time string of current time.
+* @brief Function to get the user generation, changed by every user added or removed.
+* @return The user generation.
+*/
+uint16_t 
+Database::get_user_generation()
+{
+    return user_generation;
+}
+
+// Records read from the single log at once while it is split into segments
+//
+const uint8_t log_split_batch = 8;
+
+// Longest legacy text line which is converted
+//
+const uint8_t legacy_line_max = 64;
+
+/*!
+* @brief Function to append a low memory alarm to the memory log, stamped
+*        with the date and time without using the heap.
+* @param[in] text const char * of the alarm.
 */
 void 
-Database::log_rfid_scan(const String &rfid ,  const String &date, const String &time) 
+Database::log_memory_alarm(const char *text)
 {
-    
-    File log_file = SD.open(rfid_log_file.c_str(), FILE_WRITE);
-    
-    if (!log_file) 
+    File file = SD.open(memory_log_file.c_str(), FILE_WRITE);
+    if (!file)
     {
-        Serial.println("Error: Could not open RFID log file!");
         return;
     }
 
-    String current_date = date;
-    String current_time = time;
-    log_file.println(rfid + "," + current_date + "," + current_time);
-    log_file.close();
-    
-    update_start_and_end_time(rfid, current_date, current_time);
-    
-    // DEBUG
-    //
-    // Serial.print("Logged RFID: ");
-    // Serial.print(rfid);
-    // Serial.print(", Date: ");
-    // Serial.print(current_date);
-    // Serial.print(", Time: ");
-    // Serial.println(current_time);
+    DateTime now = rtc.now();
+    char stamp[32];
+    snprintf(stamp, sizeof(stamp), "%u/%u/%u %u:%u:%u ", now.day(), now.month(), now.year(),
+             now.hour(), now.minute(), now.second());
+    file.print(stamp);
+    file.println(text);
+    file.close();
 }
 
-
 /*!
-* @brief Function to load the rfid access data stored inside SD card module.
+* @brief Function to log user access information.
+* @param[in] scan const ScanRecord& of the card granted, with the time of the decision.
 */
 void 
-Database::load_rfid_log_data() 
+Database::log_scan(const ScanRecord &scan) 
 {
-    File file = SD.open(rfid_log_file.c_str());
-
-    if (!file) 
+    // The key is "name,empid", only the employee id is stored
+    //
+    uint8_t name_length;
+    uint32_t empid;
+    if (!UserStore::parse_card(scan.key, name_length, empid))
     {
-        Serial.println("Error loading files");
         return;
     }
-    
-    String line;
-    while (file.available()) 
-    {
-        line = file.readStringUntil('\n');
-        int comma_pos = line.indexOf(',');
-        String rfid = line.substring(0, comma_pos);
-        String second_sep = line.substring(comma_pos + 1);
-
-        comma_pos = second_sep.indexOf(',');
-        String date = second_sep.substring(0, comma_pos);
-        String time = second_sep.substring(comma_pos + 1);
 
-        rfid.trim();
-        date.trim();
-        time.trim();
-        
-        update_start_and_end_time(rfid, date, time);
+    if (!LogStore::get_instance()->append(empid, scan.epoch))
+    {
+        Serial.println(F("Error: Could not open RFID log file!"));
+        return;
     }
-    
-    file.close();
-
 }
 
 /*!
-* @brief Function to load the rfid access data stored inside SD card module changed key.
+* @brief Function to convert the legacy text log into the single binary log,
+*        which is then split into segments. The text log is removed only
+*        once the conversion is complete, so an interrupted conversion is
+*        simply redone at the next boot.
+* @return The status if a legacy log was converted.
 */
-void 
-Database::load_rfid_user_log_data()
+bool 
+Database::convert_legacy_log()
 {
-    File file = SD.open(rfid_log_file.c_str());
-
-    if (!file) 
+    File legacy = SD.open(legacy_log_file.c_str());
+    if (!legacy)
     {
-        Serial.println("Error loading files");
-        return;
+        return false;
     }
-    
-    String line;
-    
-    while (file.available()) 
+
+    // Drop what a previous, interrupted conversion wrote
+    //
+    LogWriter *writer = LogWriter::get_instance();
+    writer->close();
+    SD.remove(rfid_log_file.c_str());
+    if (!writer->open(rfid_log_file.c_str()))
     {
-        
-        line = file.readStringUntil('\n');
-        int comma_pos = line.indexOf(',');
-        String rfid = line.substring(0, comma_pos);
-        String second_sep = line.substring(comma_pos + 1);
-        
-        rfid+=",";
-        
+        Serial.println(F("Error: Could not open RFID log file!"));
+        legacy.close();
+        return false;
+    }
 
-        comma_pos = second_sep.indexOf(',');
-        String id = second_sep.substring(0, comma_pos);
-        
-        id.trim();
-        rfid+=id;
+    // Records are written by whole sectors while converting
+    //
+    LogWriter::Durability durability = writer->get_durability();
+    uint16_t interval = writer->get_sync_interval();
+    writer->set_durability(LogWriter::SYNC_FULL_SECTOR);
 
-        String date = second_sep.substring(comma_pos + 1);
-        
-        comma_pos = date.indexOf(',');
-        String time = date.substring(comma_pos + 1);
-        date = date.substring(0,comma_pos);        
-        
-        rfid.trim();
-        date.trim();
-        time.trim();
+    char line[legacy_line_max];
+    uint8_t length = 0;
+    uint32_t converted = 0;
+    uint32_t skipped = 0;
+
+    while (legacy.available() || length > 0)
+    {
+        int c = legacy.available() ? legacy.read() : '\n';
+        if (c != '\n')
+        {
+            if (length < sizeof(line) - 1)
+            {
+                line[length++] = (char)c;
+            }
+            continue;
+        }
 
-        // DEBUG
-        //    
-        // Serial.print("Rfid = ");
-        // Serial.println(rfid);
+        line[length] = '\0';
+        length = 0;
 
-        // Serial.print("Date = ");
-        // Serial.println(date);
+        uint32_t empid, epoch;
+        if (!log_parse_legacy_line(line, empid, epoch))
+        {
+            skipped += (line[0] != '\0' && line[0] != '\r') ? 1 : 0;
+            continue;
+        }
 
-        // Serial.print("Time = ");
-        // Serial.println(time);
-        
-        update_start_and_end_time(rfid, date, time);
+        LogRecord record;
+        log_make_record(record, empid, epoch, LOG_EVENT_ACCESS);
+        writer->append(record);
+        converted++;
     }
 
-    file.close();
+    writer->set_durability(durability, interval);
+    writer->close();
+    legacy.close();
+    SD.remove(legacy_log_file.c_str());
+
+    Serial.print(F("Converted legacy RFID log: "));
+    Serial.print(converted);
+    Serial.print(F(" records, "));
+    Serial.print(skipped);
+    Serial.println(F(" lines skipped"));
+    return true;
 }
 
 /*!
-* @brief Function to print the working hours stored inside map and calculated.
+* @brief Function to split the single binary log written before the log
+*        segments into one segment per day. Segments left by an interrupted
+*        split are removed first, the single log and its checkpoint are
+*        removed once it is split.
+* @return The status if the single log was split.
 */
-void 
-Database::print_working_hours() 
+bool 
+Database::split_log()
 {
-   
-    Serial.println("Printing working hours:");
-   
-    for (const auto& entry : rfid_start_time) 
+    File file = SD.open(rfid_log_file.c_str());
+    if (!file)
+    {
+        return false;
+    }
+
+    LogHeader header;
+    if (file.read(&header, sizeof(header)) != sizeof(header) || !log_check_header(header))
     {
-        const String& key = entry.first;
-        const String& start_time = entry.second;
-        const String& end_time = rfid_end_time[key];
+        Serial.println(F("Error: Unknown RFID log format!"));
+        file.close();
+        return false;
+    }
 
-        double hours = calculate_working_hours(start_time.c_str(), end_time.c_str());
-        double minutes = calculate_working_minutes(start_time.c_str(), end_time.c_str());
+    LogStore *store = LogStore::get_instance();
+    store->clear();
+    store->begin_import();
 
-        Serial.print("ID: ");
-        Serial.print(key.substring(0, key.indexOf(',')));
-        Serial.print(" working hours: ");
-        Serial.println(hours, 2);
-        Serial.print("ID: ");
-        Serial.print(key.substring(0, key.indexOf(',')));
-        Serial.print(" working minutes: ");
-        Serial.println(minutes, 2);
+    LogRecord records[log_split_batch];
+    uint32_t split = 0;
+    uint32_t corrupted = 0;
+    int bytes;
+
+    // A torn record at the end of the file is ignored
+    //
+    while ((bytes = file.read(records, sizeof(records))) >= (int)sizeof(LogRecord))
+    {
+        uint8_t count = bytes / sizeof(LogRecord);
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (!log_check_record(records[i]))
+            {
+                corrupted++;
+                continue;
+            }
+            store->append(records[i].empid, records[i].epoch);
+            split++;
+        }
     }
+
+    store->end_import();
+    file.close();
+    SD.remove(rfid_log_file.c_str());
+
+    // The working hours checkpoint of the single log is not read any more,
+    // the summaries of the segments replace it
+    //
+    SD.remove(checkpoint_file.c_str());
+
+    Serial.print(F("Split RFID log into segments: "));
+    Serial.print(split);
+    Serial.print(F(" records, "));
+    Serial.print(corrupted);
+    Serial.println(F(" corrupted"));
+    return true;
 }
 
 /*!
-* @brief Function to get all the admins present in the system.
-* @return admins vector of all the admins.
+* @brief Function to load the rfid access data stored inside SD card module.
 */
-const 
-std::vector<Admin> & Database::get_admins()
+void 
+Database::load_rfid_log_data() 
 {
-    return admins;
+    load_rfid_user_log_data();
 }
 
 /*!
-* @brief Function to get all the users present in the system.
-* @return admins vector of all the users.
+* @brief Function to load the rfid access data stored inside SD card module changed key.
+*        Older logs are moved into segments, then the last segment is opened.
 */
-const 
-std::vector<User> & Database::get_users()
+void 
+Database::load_rfid_user_log_data()
 {
-    return users;
+    // Logs written before the binary format are converted once
+    //
+    if (SD.exists(legacy_log_file.c_str()))
+    {
+        convert_legacy_log();
+    }
+
+    // Logs written before the segments are split once
+    //
+    if (SD.exists(rfid_log_file.c_str()))
+    {
+        split_log();
+    }
+
+    if (!LogStore::get_instance()->begin())
+    {
+        Serial.println(F("Error: Could not open RFID log file!"));
+    }
 }
 
 /*!
-* @brief Function to get the start time based on rfid log of the users.
-* @return rfid_start_time map of start time when the user scan into the system.
+* @brief Function to format the date of a unix time as "d/m/yyyy".
+* @param[in] epoch uint32_t unix time.
+* @return The date.
 */
-std::map<String, String>
-const Database::get_rfid_start_time()
+String 
+Database::format_date(uint32_t epoch)
 {
-    return rfid_start_time;
+    DateTime at(epoch);
+    return String(at.day()) + "/" + String(at.month()) + "/" + String(at.year());
 }
 
 /*!
-* @brief Function to get the end time based on rfid log of the users.
-* @return rfid_start_time map of end time when the user scan into the system.
+* @brief Function to format the time of a unix time as "h:m:s".
+* @param[in] epoch uint32_t unix time.
+* @return The time.
 */
-std::map<String, String> 
-const Database::get_rfid_end_time()
+String 
+Database::format_time(uint32_t epoch)
 {
-    return rfid_end_time;
+    DateTime at(epoch);
+    return String(at.hour()) + ":" + String(at.minute()) + ":" + String(at.second());
 }
 
 /*!
-* @brief Function to update the map for start and end time based on logged in information.
-* @param[in] rfid string of key(name,uuid) which is scanned from the rfid.
-* @param[in] date string of current date.
-* @param[in] time string of current time.
+* @brief Function to read the next segment summary entry of a registered user.
+*        Entries which ended before the user was registered belong to a
+*        previous holder of the employee id and are skipped.
+* @param[out] entry SummaryEntry read.
+* @param[out] user UserRecord of the entry.
+* @return The status if an entry was read, false after the last entry.
 */
-void 
-Database::update_start_and_end_time(const String &rfid, const String &date, const String &time) 
+bool 
+Database::next_user_summary(SummaryEntry &entry, UserRecord &user)
 {
-    String key = rfid + "," + date;
-    
-    if (rfid_start_time.find(key) == rfid_start_time.end()) 
+    LogStore *store = LogStore::get_instance();
+    while (store->next_summary(entry))
     {
-        rfid_start_time[key] = time;
+        if (UserStore::get_instance()->find_empid(entry.empid, user) &&
+            entry.last_epoch / 86400UL >= UserStore::registered_day(user))
+        {
+            return true;
+        }
     }
-    
-    rfid_end_time[key] = time;
+    return false;
 }
 
 /*!
-* @brief Function to update the map rfid based on specific key.
-* @param[in] rfid string of key(name,uuid) which is scanned from the rfid.
+* @brief Function to print the working hours calculated from the segment summaries.
 */
 void 
-Database::update_rfid_map(const String &rfid)
+Database::print_working_hours() 
 {
-    rfid_map[rfid]=true;
+   
+    Serial.println(F("Printing working hours:"));
+   
+    SummaryEntry entry;
+    UserRecord user;
+    LogStore::get_instance()->rewind_summaries();
+    while (next_user_summary(entry, user)) 
+    {
+        // From the unix times, the formatted times are not zero padded
+        //
+        double hours = (entry.last_epoch - entry.first_epoch) / 3600.0;
+        double minutes = (entry.last_epoch - entry.first_epoch) / 60.0;
+
+        Serial.print(F("ID: "));
+        Serial.print(user.name);
+        Serial.print(F(" working hours: "));
+        Serial.println(hours, 2);
+        Serial.print(F("ID: "));
+        Serial.print(user.name);
+        Serial.print(F(" working minutes: "));
+        Serial.println(minutes, 2);
+    }
 }
 
 /*!
-* @brief Function to update the map fo start and end time based on logged in information.
-* @param[in] rfid string of key(name,empID) which is scanned from the rfid.
+* @brief Function to get all the admins present in the system.
+* @return admins vector of all the admins.
 */
-void 
-Database::update_emp_map(const String &emp)
+const 
+std::vector<Admin> & Database::get_admins()
 {
-    emp_map[emp]=true;
+    return admins;
 }
 
 /*!
@@ -645,6 +877,16 @@ Database::get_current_date()
     return String(now.day()) + "/" + String(now.month()) + "/" + String(now.year());
 }
 
+/*!
+* @brief Function to get the current time as a unix time.
+* @return The current time based on rtc.
+*/
+uint32_t 
+Database::get_current_epoch() 
+{
+    return rtc.now().unixtime();
+}
+
 /*!
 * @brief Function to get the time in seconds.
 * @param[in] time_str pointer to char which represent time in the format (hh/mm/ss).
@@ -760,31 +1002,25 @@ Database::addLeadingZeros(String time)
 void 
 Database::display_logs() 
 {
-    // Create iterators for the start and end time maps
-    //
-    std::map<String, String>::const_iterator it_start = rfid_start_time.begin();
-    std::map<String, String>::const_iterator it_end = rfid_end_time.begin();
-
     // Print the header
     //
     Serial.println("ID    Date        Start Time   End Time   Working mins");
 
-    // Iterate through the maps and display the values
+    // Iterate through the segment summaries and display the values
     //
-    while (it_start != rfid_start_time.end() && it_end != rfid_end_time.end()) 
+    SummaryEntry entry;
+    UserRecord user;
+    LogStore::get_instance()->rewind_summaries();
+    while (next_user_summary(entry, user)) 
     {
-        String start_time = it_start->second;
-        String end_time = it_end->second;
-
-        // Extract the date and RFID from the key
-        //
-        String full_key = it_start->first;
-        String date = full_key.substring(full_key.indexOf(',') + 1);
-        String rfid = full_key.substring(0, full_key.indexOf(','));
+        String start_time = format_time(entry.first_epoch);
+        String end_time = format_time(entry.last_epoch);
+        String date = format_date(entry.first_epoch);
+        String rfid = user.name;
 
-        // Calculate working minutes using the Database object
+        // Calculate working minutes from the unix times
         //
-        double working_minutes = calculate_working_minutes(start_time.c_str(), end_time.c_str());
+        double working_minutes = (entry.last_epoch - entry.first_epoch) / 60.0;
     
         // Display the values
         //
@@ -797,9 +1033,6 @@ Database::display_logs()
         Serial.print(end_time);
         Serial.print("   ");
         Serial.println(working_minutes);
-
-        it_start++;
-        it_end++;
     }
 }
 
@@ -809,31 +1042,58 @@ Database::display_logs()
 void 
 Database::display_users()
 {
-    // Get the maximum lengths
-    //
-    int maxNameLength = 0;
-    int maxEmpIDLength = 0;
-    getMaxLengthsUsers(users, maxNameLength, maxEmpIDLength);
+    uint16_t row = 0;
+    do
+    {
+        row = display_users_row(row);
+    } while (row != 0);
+}
 
-    Serial.print("NAME");
-    Serial.print("           ");
-    Serial.println("EMP ID");
-    Serial.println("----------------------------------");
-    
-    
-    for (uint8_t i = 0; i < users.size(); i++) 
+/*!
+* @brief Function to display one row of the users table, so a long table can
+*        be printed over several scheduler ticks. Users are listed by employee id.
+* @param[in] row uint16_t row to print, 0 prints the header.
+* @return The next row to print, 0 when the table is complete.
+*/
+uint16_t 
+Database::display_users_row(uint16_t row)
+{
+    UserStore *store = UserStore::get_instance();
+    if (row == 0)
     {
-        
-        Serial.print(users[i].get_name());
-        
-        int nameSpaces = maxNameLength - users[i].get_name().length() + 10; // +10 for extra padding
-        for (int j = 0; j < nameSpaces; j++) 
+        // Names are padded to the longest name a card holds, the users are
+        // not scanned up front
+        //
+        Serial.print(F("NAME"));
+        for (uint8_t j = 4; j < user_name_size + 9; j++) 
         {
             Serial.print(" ");
         }
-        
-        Serial.println(users[i].get_rfid());
+        Serial.println(F("EMP ID"));
+        Serial.println(F("----------------------------------"));
+        store->rewind();
+        return (store->size() == 0) ? 0 : 1;
     }
+
+    UserRecord user;
+    if (!store->next(user))
+    {
+        return 0;
+    }
+
+    Serial.print(user.name);
+    
+    int nameSpaces = user_name_size + 9 - strlen(user.name);
+    for (int j = 0; j < nameSpaces; j++) 
+    {
+        Serial.print(F(" "));
+    }
+    
+    Serial.println(user.empid);
+
+    // Rows are only counted to tell the header apart, the count may wrap
+    //
+    return (row == 0xFFFF) ? 1 : row + 1;
 }
 
 /*!
@@ -874,351 +1134,228 @@ Database::display_admins()
 void 
 Database::display_user_logs()
 {
-    // Create iterators for the start and end time maps
-    //
-    std::map<String, String>::const_iterator it_start = rfid_start_time.begin();
-    std::map<String, String>::const_iterator it_end = rfid_end_time.begin();
-
-    // Display the headers
-    //
-    Serial.print("NAME");
-    Serial.print("   ");
-    Serial.print("EMPID");
-    Serial.print("   ");
-    Serial.print("DATE");
-    Serial.print("     ");
-    Serial.print("START TIME");
-    Serial.print("  ");
-    Serial.print("END TIME");
-
-    // TODO : If admin wants the format to be in working hours
-    //
-    // Serial.print("  ");
-    // Serial.print("WORKING MINS");
-    
-    Serial.print("  ");
-    Serial.println("WORKING HOURS");
-    
-    Serial.println("--------------------------------------------------------");
-    
-    // Iterate through the maps and display the values
-    //
-    while (it_start != rfid_start_time.end() && it_end != rfid_end_time.end()) 
+    uint16_t row = 0;
+    do
     {
-        String start_time = it_start->second;
-        String end_time = it_end->second;
-
-        // Extract the date and RFID from the key
-        //
-        String full_key = it_start->first;
-        String id = full_key.substring(full_key.indexOf(',') + 1);
-        String date = id.substring(id.indexOf(',') + 1);
-        String name = full_key.substring(0, full_key.indexOf(','));
-        id = id.substring(0, id.indexOf(','));
-        
-        // Calculate working minutes
-        // 
-        double working_minutes = calculate_working_minutes(start_time.c_str(), end_time.c_str());
-
-        // Calculate working hours
-        // 
-        double working_hours = calculate_working_hours(start_time.c_str(), end_time.c_str());
-
+        row = display_user_logs_row(row);
+    } while (row != 0);
+}
 
-        // Display the values
+/*!
+* @brief Function to display one row of the user logs table, so a long table
+*        can be printed over several scheduler ticks.
+* @param[in] row uint16_t row to print, 0 prints the header.
+* @return The next row to print, 0 when the table is complete.
+*/
+uint16_t 
+Database::display_user_logs_row(uint16_t row)
+{
+    if (row == 0)
+    {
+        // Display the headers
         //
-        Serial.print(name);
+        Serial.print(F("NAME"));
         Serial.print("   ");
-        Serial.print(id);
-        Serial.print("   ");
-        Serial.print(date);
+        Serial.print(F("EMPID"));
         Serial.print("   ");
+        Serial.print(F("DATE"));
+        Serial.print(F("     "));
+        Serial.print(F("START TIME"));
+        Serial.print(F("  "));
+        Serial.print(F("END TIME"));
 
+        // TODO : If admin wants the format to be in working hours
+        //
+        // Serial.print(F("  "));
+        // Serial.print(F("WORKING MINS"));
         
-        String modified_start_time = addLeadingZeros(start_time);
-        String modified_end_time = addLeadingZeros(end_time);
-        
-        Serial.print(modified_start_time);
-        Serial.print("   ");
-        Serial.print(modified_end_time);
-        Serial.print("   ");
+        Serial.print(F("  "));
+        Serial.println(F("WORKING HOURS"));
         
-        // TODO : If admins wants working minutes
-        // 
-        // Serial.println(working_minutes);
-        // Serial.print("          ");
-        // Serial.println(working_hours);
+        Serial.println(F("--------------------------------------------------------"));
         
-        String modified_working_hour = convertToTimeFormat(working_hours);
-
-        Serial.println(modified_working_hour);
+        // Rows are read from the segment summaries, oldest day first
+        //
+        LogStore::get_instance()->rewind_summaries();
+        return 1;
+    }
 
-        it_start++;
-        it_end++;
+    SummaryEntry entry;
+    UserRecord user;
+    if (!next_user_summary(entry, user))
+    {
+        return 0;
     }
 
-}
+    String start_time = format_time(entry.first_epoch);
+    String end_time = format_time(entry.last_epoch);
+    String date = format_date(entry.first_epoch);
+    String name = user.name;
+    String id = String(user.empid);
+    
+    // Calculate working hours from the unix times
+    // 
+    double working_hours = (entry.last_epoch - entry.first_epoch) / 3600.0;
 
-/*!
-* @brief Function to delete user from the vector using only employee id.
-* @param[in] empid String  a key to the employee id which is embedded inside rfid.
-*/
-void 
-Database::delete_user_from_vector(const String &empid)
-{
-    std::vector<User>::iterator it;
 
-    for (it = users.begin(); it != users.end(); ) 
-    {
-        if (it->get_rfid() == empid) 
-        {
-            it = users.erase(it);  
-        } 
-        else 
-        {
-            ++it;  
-        }
-    }
+    // Display the values
+    //
+    Serial.print(name);
+    Serial.print(F("   "));
+    Serial.print(id);
+    Serial.print(F("   "));
+    Serial.print(date);
+    Serial.print(F("   "));
 
+    
+    String modified_start_time = addLeadingZeros(start_time);
+    String modified_end_time = addLeadingZeros(end_time);
+    
+    Serial.print(modified_start_time);
+    Serial.print(F("   "));
+    Serial.print(modified_end_time);
+    Serial.print(F("   "));
+    
+    // TODO : If admins wants working minutes
+    // 
+    // Serial.println(working_minutes);
+    // Serial.print(F("          "));
+    // Serial.println(working_hours);
+    
+    String modified_working_hour = convertToTimeFormat(working_hours);
 
+    Serial.println(modified_working_hour);
 
+    return row + 1;
 }
 
 /*!
-* @brief Function to delete user from the database.
+* @brief Function to select the day whose raw scans are displayed.
+* @param[in] date const String& of the day, "d/m/yyyy".
+* @return The status if the day has a log segment.
 */
-void 
-Database::delete_user_database()
+bool 
+Database::select_log_day(const String &date)
 {
-    String filepath = "TEMP/user.txt";
-    
-    // Delete the existing file if it exists
-    //
-    if (SD.exists(filepath)) 
-    {
-        if (SD.remove(filepath)) 
-        {
-            // DEBUG 
-            //
-            // Serial.print("Deleted old file: ");
-            // Serial.println(filepath);
-        } 
-        else 
-        {
-            Serial.print("Failed to delete file: ");
-            Serial.println(filepath);
-            return; 
-        }
-    } 
-    else 
+    uint32_t epoch = log_parse_date_time(date.c_str(), "0:0:0");
+    if (epoch == 0)
     {
-        Serial.println("File does not exist, creating a new one.");
+        return false;
     }
 
-    // Create a new file for users
-    //
-    File userFile = SD.open(filepath, FILE_WRITE);
-    if (!userFile) 
-    {
-        Serial.println("Failed to create new user file.");
-        return; // Exit if file creation fails
-    }
-
-    
-    for (const auto& user : users) 
-    { 
-        userFile.println(user.get_name() + "," + user.get_rfid());
-    }
-
-    userFile.close();
-    
-    // DEBUG
-    // 
-    // Serial.print("Created new user file with users: ");
-    // Serial.println(filepath);
+    scan_day = epoch / 86400UL;
+    return LogStore::get_instance()->rewind_records(LogStore::segment_of(epoch));
 }
 
 /*!
-* @brief Function to delete user from the rfid map using employee id key(name,id).
-* @param[in] empid String  a key to the employee id which is embedded inside rfid.
+* @brief Function to display one row of the raw scans of the selected day,
+*        read from its log segment.
+* @param[in] row uint16_t row to print, 0 prints the header.
+* @return The next row to print, 0 when the table is complete.
 */
-void 
-Database::delete_user_from_rfid_map(const String &empid) 
+uint16_t 
+Database::display_scans_row(uint16_t row)
 {
-    
-    
-    
-    User* user = get_key(empid);
-    
-    
-
-    if (user == nullptr) 
+    if (row == 0)
     {
-        Serial.println("User not found.");
-        return; // User not found, exit the function
+        Serial.println(F("NAME   EMPID   DATE     TIME"));
+        Serial.println(F("----------------------------------"));
+        return 1;
     }
 
-    // Construct keys
+    // A segment may cover more than the selected day
     //
-    String key1 = user->get_name() + "," + user->get_rfid(); // Name, RFID
-    String key2 = user->get_rfid(); // RFID
-
-    // Delete from rfid_map
-    //
-    auto it1 = rfid_map.find(key1);
-    if (it1 != rfid_map.end()) 
+    LogRecord record;
+    do
     {
-        rfid_map.erase(it1); // Remove using key1
-        
-        //DEBUG
-        //
-        // Serial.print("Deleted from rfid_map using key1: ");
-        // Serial.println(key1);
+        if (!LogStore::get_instance()->next_record(record))
+        {
+            return 0;
+        }
+    } while (record.epoch / 86400UL != scan_day);
 
-    }
-    else 
-    {
-        Serial.print("Key1 not found in rfid_map: ");
-        Serial.println(key1);
-    }
+    UserRecord user;
+    bool is_registered = UserStore::get_instance()->find_empid(record.empid, user);
 
-    auto it2 = rfid_map.find(key2);
-    if (it2 != rfid_map.end()) 
-    {
-        rfid_map.erase(it2); // Remove using key2
-        
-        // DEBUG
-        //
-        // Serial.print("Deleted from rfid_map using key2: ");
-        // Serial.println(key2);
+    Serial.print(is_registered ? user.name : "(deleted)");
+    Serial.print(F("   "));
+    Serial.print(record.empid);
+    Serial.print(F("   "));
+    Serial.print(format_date(record.epoch));
+    Serial.print(F("   "));
+    Serial.println(addLeadingZeros(format_time(record.epoch)));
 
-    } 
-    else 
-    {
-        Serial.print("Key2 not found in rfid_map: ");
-        Serial.println(key2);
-    }
+    return row + 1;
 }
 
 /*!
-* @brief Function to delete user from the employee map using employee id key(name,id).
-* @param[in] empid String  a key to the employee id which is embedded inside rfid.
+* @brief Function to select the user whose days are displayed.
+* @param[in] empid const String& of the employee id.
+* @return The status if the user is registered.
 */
-void 
-Database::delete_user_from_emp_map(const String &empid) 
+bool 
+Database::select_user_log(const String &empid)
 {
-    User* user = get_key(empid);
-    
-    if (user == nullptr) 
+    uint32_t id;
+    if (!UserStore::parse_empid(empid.c_str(), id) || !UserStore::get_instance()->find_empid(id, log_user))
     {
-        Serial.println("User not found.");
-        return; // User not found, exit the function
+        return false;
     }
 
-    // Construct the key using the user's RFID
-    //
-    String key = user->get_rfid(); // Key: RFID
-
-    // Delete from emp_map
-    //
-    auto it = emp_map.find(key);
-    if (it != emp_map.end()) 
-    {
-        emp_map.erase(it); // Remove the entry using the key
-
-        // DEBUG
-        //  
-        // Serial.print("Deleted from emp_map using key (RFID): ");
-        // Serial.println(key);
-    
-    } 
-    else 
-    {
-        Serial.print("Key not found in emp_map: ");
-        Serial.println(key);
-    }
+    log_position = 0;
+    return true;
 }
 
 /*!
-* @brief Function to delete user from the map using employee id key(name,id).
-* @param[in] empid const String  a key to the employee id which is embedded inside rfid.
+* @brief Function to display the day of the selected user in the next
+*        segment, one segment per call. Only the entry of the user is read
+*        from each summary.
+* @param[in] row uint16_t row to print, 0 prints the header.
+* @return The next row to print, 0 when the table is complete.
 */
-void 
-Database::delete_user_from_log_map(const String &empid) 
+uint16_t 
+Database::display_user_log_row(uint16_t row)
 {
-    
-
-    User* user = get_key(empid);
-    
-    
-    
-    if (user == nullptr) 
+    if (row == 0)
     {
-        Serial.println("User not found.");
-        return; // User not found, exit the function
+        Serial.print(log_user.name);
+        Serial.print(F("   "));
+        Serial.println(log_user.empid);
+        Serial.println(F("DATE     START TIME  END TIME   WORKING HOURS   SCANS"));
+        Serial.println(F("--------------------------------------------------------"));
+        return 1;
     }
 
-    // Construct the key using the user's name and RFID
-    //
-    String key = user->get_name() + "," + user->get_rfid(); // Key: name, RFID
-
-    // Delete from rfid_start_time map
-    //
-    for (auto it = rfid_start_time.begin(); it != rfid_start_time.end();) 
+    LogStore *store = LogStore::get_instance();
+    uint32_t segment;
+    if (!store->get_segment(log_position, segment))
     {
-        if (it->first.indexOf(key) != -1) 
-        { 
-            // DEBUG
-            //
-            // Check if key is a substring of the map key
-            // Serial.print("Deleting from rfid_start_time: ");
-            // Serial.println(it->first);
-      
-            it = rfid_start_time.erase(it); // Remove entry and update iterator
-        } 
-        else 
-        {
-            ++it; // Move to the next entry
-        }
+        return 0;
     }
+    log_position++;
 
-    // Delete from rfid_end_time map
+    SummaryEntry entry;
+    // Days before the registration belong to a previous holder of the id
     //
-    for (auto it = rfid_end_time.begin(); it != rfid_end_time.end();) 
+    if (!store->find_summary(segment, log_user.empid, entry) ||
+        entry.last_epoch / 86400UL < UserStore::registered_day(log_user))
     {
-        if (it->first.indexOf(key) != -1) 
-        { 
-            // Check if key is a substring of the map key
-            // Serial.print("Deleting from rfid_end_time: ");
-            // Serial.println(it->first);
-            it = rfid_end_time.erase(it); // Remove entry and update iterator
-        } 
-        else 
-        {
-            ++it; // Move to the next entry
-        }
+        return row + 1;
     }
-}
 
-/*!
-* @brief Function to delete user from the map using employee id key(name,id).
-* @return The pointer to the User based on the employee id key.
-*/
-User* 
-Database::get_key(const String & empid)
-{
-    std::vector<User>::iterator it;
-    User* user=nullptr;
-    for (it = users.begin(); it != users.end(); it++ ) 
-    {
-        if (it->get_rfid() == empid) 
-        {
-            user=&(*it);
-            break;
-        } 
+    double working_hours = (entry.last_epoch - entry.first_epoch) / 3600.0;
 
-    }
-    return user;
+    Serial.print(format_date(entry.first_epoch));
+    Serial.print(F("   "));
+    Serial.print(addLeadingZeros(format_time(entry.first_epoch)));
+    Serial.print(F("   "));
+    Serial.print(addLeadingZeros(format_time(entry.last_epoch)));
+    Serial.print(F("   "));
+    Serial.print(convertToTimeFormat(working_hours));
+    Serial.print(F("   "));
+    Serial.println(entry.count);
+
+    return row + 1;
 }
 
 /*!
@@ -1226,9 +1363,15 @@ Database::get_key(const String & empid)
 */
 void Database::delete_user(const String& empid)
 {
-    delete_user_from_rfid_map(empid);
-    delete_user_from_emp_map(empid);
-    delete_user_from_log_map(empid);
-    delete_user_from_vector(empid);
-    delete_user_database();
+    uint32_t id;
+    UserRecord user;
+    UserStore *store = UserStore::get_instance();
+    if (!UserStore::parse_empid(empid.c_str(), id) || !store->find_empid(id, user) || !store->remove(id))
+    {
+        Serial.println(F("User not found."));
+        return;
+    }
+
+    UserFilter::get_instance()->remove(user.name, user.empid);
+    user_generation++;
 }
@@ -1,4 +1,22 @@
 #include "Door.hpp"
+#include "Trace.hpp"
+
+// Motor driver inputs, in the order of the coil sequence
+//
+static const uint8_t motor_pins[4] = { 6, 8, 7, 9 };
+
+// Full step sequence of a four wire motor, one bit per driver input
+//
+static const uint8_t coil_sequence[4] = { 0b1010, 0b0110, 0b0101, 0b1001 };
+
+// Initialize the state shared with the ISR
+//
+volatile int16_t Door::position = 0;
+volatile int16_t Door::target = 0;
+volatile bool Door::is_moving = false;
+uint32_t Door::step_interval = 0;
+uint32_t Door::min_interval = 0;
+uint16_t Door::ramp_steps = 0;
 
 /*!
 * @brief Function to initialize the stepper motor.
@@ -6,7 +24,11 @@
 void 
 Door::setup() 
 {
-  myStepper.setSpeed(15);  // Set motor speed to 15 RPM
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    pinMode(motor_pins[i], OUTPUT);
+  }
+  write_coils(0);
 }
 
 
@@ -16,9 +38,12 @@ Door::setup()
 void
  Door::open() 
 {
+  TRACE_EVENT(TRACE_DOOR_OPEN);
+
   if (doorstate == CLOSED) 
   {
     doorstate = OPENING;
+    move_to(max_steps_per_revolution);  // Start moving right away
   }
 }
 
@@ -31,9 +56,124 @@ Door::close()
   if (doorstate == IDLE) 
   {
     doorstate = CLOSING;
+    move_to(0);
+  }
+}
+
+/*!
+* @brief Function to set the speed profile of the next moves.
+* @param[in] max_speed uint16_t cruise speed in steps per second.
+* @param[in] acceleration uint16_t acceleration and deceleration in steps per second^2.
+*/
+void 
+Door::set_profile(uint16_t max_speed, uint16_t acceleration)
+{
+  if (max_speed > 0 && acceleration > 0)
+  {
+    this->max_speed = max_speed;
+    this->acceleration = acceleration;
   }
 }
 
+/*!
+* @brief Function to read the motor position owned by the ISR.
+* @return The position in steps, 0 is closed.
+*/
+int16_t 
+Door::get_position()
+{
+  noInterrupts();
+  int16_t steps = position;
+  interrupts();
+  return steps;
+}
+
+/*!
+* @brief Function to start a move, the step timer does the rest.
+* @param[in] new_target int16_t position to move to.
+*/
+void 
+Door::move_to(int16_t new_target)
+{
+  noInterrupts();
+  target = new_target;
+
+  if (!is_moving && position != target)
+  {
+    // First interval from the acceleration, with the usual 0.676 correction
+    // of the discrete ramp, and the cruise interval
+    //
+    uint32_t first_interval = (uint32_t)(0.676 * sqrt(2.0 / acceleration) * 1000000.0 * 256.0);
+    min_interval = (1000000UL << 8) / max_speed;
+    if (first_interval > (step_timer_max_period << 8))
+    {
+      first_interval = step_timer_max_period << 8;
+    }
+    step_interval = (first_interval > min_interval) ? first_interval : min_interval;
+    ramp_steps = 0;
+    is_moving = true;
+
+    step_timer_start(step_interval >> 8, step_isr);
+  }
+  interrupts();
+}
+
+/*!
+* @brief Function to drive the motor coils.
+* @param[in] pattern uint8_t one bit per driver input.
+*/
+void 
+Door::write_coils(uint8_t pattern)
+{
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    digitalWrite(motor_pins[i], (pattern >> (3 - i)) & 1 ? HIGH : LOW);
+  }
+}
+
+/*!
+* @brief Step timer ISR, takes one step and computes the interval to the
+*        next one: accelerating up to cruise speed, then decelerating over
+*        as many steps as the ramp up took.
+*/
+void 
+Door::step_isr()
+{
+  if (position == target)
+  {
+    step_timer_stop();
+    is_moving = false;
+    return;
+  }
+
+  position += (target > position) ? 1 : -1;
+  write_coils(coil_sequence[position & 3]);
+
+  uint16_t remaining = abs(target - position);
+  if (remaining == 0)
+  {
+    step_timer_stop();
+    is_moving = false;
+    return;
+  }
+
+  if (remaining <= ramp_steps)
+  {
+    step_interval += (2 * step_interval) / (4UL * ramp_steps - 1);
+    ramp_steps--;
+  }
+  else if (step_interval > min_interval)
+  {
+    ramp_steps++;
+    step_interval -= (2 * step_interval) / (4UL * ramp_steps + 1);
+    if (step_interval < min_interval)
+    {
+      step_interval = min_interval;
+    }
+  }
+  step_timer_set_period(step_interval >> 8);
+}
+
 /*!
 * @brief Function to run the door state machine.
 */
@@ -43,12 +183,10 @@ Door::run()
   switch (doorstate) 
   {
     case OPENING:
-      myStepper.step(100);  // Open the door
-      current_position += 100;  // Update the current position
-      
-      if (current_position >= max_steps_per_revolution) 
+      // The ISR stops the timer once the door is open
+      //
+      if (!is_moving) 
       {
-        current_position = max_steps_per_revolution; // Set to max
         doorstate = IDLE;  // Move to idle state
         start_time = millis();  // Record start time for idle
       }
@@ -65,11 +203,8 @@ Door::run()
       break;
 
     case CLOSING:
-      myStepper.step(-100);  // Close the door
-      current_position -= 100;  // Update the current position
-      if (current_position <= 0) 
+      if (!is_moving) 
       {
-        current_position = 0;  // Reset position to 0
         doorstate = CLOSED;  // Move to closed state
       }
       break;
@@ -0,0 +1,242 @@
+#include "LogFormat.hpp"
+#include <RTClib.h>
+#include <stddef.h>
+
+/*!
+* @brief Function to compute the CRC-16/CCITT-FALSE of a buffer.
+* @param[in] data const uint8_t * of the bytes.
+* @param[in] size size_t of the number of bytes.
+* @return The CRC.
+*/
+uint16_t 
+log_crc16(const uint8_t *data, size_t size)
+{
+    return log_crc16_update(0xFFFF, data, size);
+}
+
+/*!
+* @brief Function to continue a CRC-16/CCITT-FALSE over the next bytes.
+* @param[in] crc uint16_t of the CRC so far, 0xFFFF to start.
+* @param[in] data const uint8_t * of the bytes.
+* @param[in] size size_t of the number of bytes.
+* @return The CRC.
+*/
+uint16_t 
+log_crc16_update(uint16_t crc, const uint8_t *data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+/*!
+* @brief Function to fill the header of a new log file.
+* @param[out] header LogHeader to fill.
+*/
+void 
+log_make_header(LogHeader &header)
+{
+    memcpy(header.magic, log_magic, sizeof(header.magic));
+    header.version = log_format_version;
+    header.record_size = sizeof(LogRecord);
+    header.crc = log_crc16((const uint8_t *)&header, offsetof(LogHeader, crc));
+}
+
+/*!
+* @brief Function to check the header of a log file.
+* @param[in] header const LogHeader& read from the file.
+* @return The status if the file is a log this firmware can read.
+*/
+bool 
+log_check_header(const LogHeader &header)
+{
+    return memcmp(header.magic, log_magic, sizeof(header.magic)) == 0 &&
+           header.version == log_format_version &&
+           header.record_size == sizeof(LogRecord) &&
+           header.crc == log_crc16((const uint8_t *)&header, offsetof(LogHeader, crc));
+}
+
+/*!
+* @brief Function to fill a record.
+* @param[out] record LogRecord to fill.
+* @param[in] empid uint32_t employee id.
+* @param[in] epoch uint32_t unix time of the event.
+* @param[in] event LogEvent which happened.
+*/
+void 
+log_make_record(LogRecord &record, uint32_t empid, uint32_t epoch, LogEvent event)
+{
+    record.empid = empid;
+    record.epoch = epoch;
+    record.event = event;
+    record.reserved = 0;
+    record.crc = log_crc16((const uint8_t *)&record, offsetof(LogRecord, crc));
+}
+
+/*!
+* @brief Function to check the CRC of a record.
+* @param[in] record const LogRecord& read from the file.
+* @return The status if the record is intact.
+*/
+bool 
+log_check_record(const LogRecord &record)
+{
+    return record.crc == log_crc16((const uint8_t *)&record, offsetof(LogRecord, crc));
+}
+
+/*!
+* @brief Function to fill the header of a segment summary.
+* @param[out] header SummaryHeader to fill.
+* @param[in] entry_count uint16_t number of entries following the header.
+* @param[in] log_offset uint32_t segment bytes covered by the summary.
+* @param[in] entries_crc uint16_t CRC of the entries.
+*/
+void 
+log_make_summary_header(SummaryHeader &header, uint16_t entry_count,
+                        uint32_t log_offset, uint16_t entries_crc)
+{
+    memcpy(header.magic, summary_magic, sizeof(header.magic));
+    header.version = log_format_version;
+    header.entry_size = sizeof(SummaryEntry);
+    header.entry_count = entry_count;
+    header.log_offset = log_offset;
+    header.entries_crc = entries_crc;
+    header.crc = log_crc16((const uint8_t *)&header, offsetof(SummaryHeader, crc));
+}
+
+/*!
+* @brief Function to check the header of a segment summary.
+* @param[in] header const SummaryHeader& read from the file.
+* @return The status if the summary is one this firmware can read.
+*/
+bool 
+log_check_summary_header(const SummaryHeader &header)
+{
+    return memcmp(header.magic, summary_magic, sizeof(header.magic)) == 0 &&
+           header.version == log_format_version &&
+           header.entry_size == sizeof(SummaryEntry) &&
+           header.log_offset >= sizeof(LogHeader) &&
+           (header.log_offset - sizeof(LogHeader)) % sizeof(LogRecord) == 0 &&
+           header.crc == log_crc16((const uint8_t *)&header, offsetof(SummaryHeader, crc));
+}
+
+/*!
+* @brief Function to read an unsigned number and the separator after it.
+* @param[in,out] text const char *& moved past the number and separator.
+* @param[in] separator char expected after the number, '\0' for the end.
+* @param[out] value uint32_t parsed.
+* @return The status if a number followed by the separator was found.
+*/
+static bool 
+parse_number(const char *&text, char separator, uint32_t &value)
+{
+    while (*text == ' ')
+    {
+        text++;
+    }
+
+    const char *start = text;
+    value = 0;
+    while (*text >= '0' && *text <= '9')
+    {
+        value = value * 10 + (*text - '0');
+        text++;
+    }
+    if (text == start)
+    {
+        return false;
+    }
+
+    while (*text == ' ' || *text == '\r' || *text == '\n')
+    {
+        text++;
+    }
+    if (separator == '\0')
+    {
+        return *text == '\0' || *text == ',';
+    }
+    if (*text != separator)
+    {
+        return false;
+    }
+    text++;
+    return true;
+}
+
+/*!
+* @brief Function to convert the date and time strings of the firmware to unix time.
+* @param[in] date const char * in the format d/m/yyyy.
+* @param[in] time const char * in the format h:m:s.
+* @return The unix time, 0 when the strings are not valid.
+*/
+uint32_t 
+log_parse_date_time(const char *date, const char *time)
+{
+    uint32_t day, month, year, hour, minute, second;
+
+    if (!parse_number(date, '/', day) || !parse_number(date, '/', month) ||
+        !parse_number(date, '\0', year) ||
+        !parse_number(time, ':', hour) || !parse_number(time, ':', minute) ||
+        !parse_number(time, '\0', second))
+    {
+        return 0;
+    }
+    if (day < 1 || day > 31 || month < 1 || month > 12 || year < 2000 || year > 2099 ||
+        hour > 23 || minute > 59 || second > 59)
+    {
+        return 0;
+    }
+
+    return DateTime(year, month, day, hour, minute, second).unixtime();
+}
+
+/*!
+* @brief Function to parse a line of the legacy text log.
+* @param[in] line const char * "name,empid,d/m/yyyy,h:m:s".
+* @param[out] empid uint32_t employee id.
+* @param[out] epoch uint32_t unix time of the scan.
+* @return The status if the line could be parsed.
+*/
+bool 
+log_parse_legacy_line(const char *line, uint32_t &empid, uint32_t &epoch)
+{
+    // Skip the name, it is found again from the employee id
+    //
+    const char *field = strchr(line, ',');
+    if (field == nullptr)
+    {
+        return false;
+    }
+    field++;
+
+    if (!parse_number(field, ',', empid))
+    {
+        return false;
+    }
+
+    const char *time = strchr(field, ',');
+    if (time == nullptr)
+    {
+        return false;
+    }
+
+    // The date is parsed in place up to the comma
+    //
+    char date[12];
+    size_t date_length = time - field;
+    if (date_length >= sizeof(date))
+    {
+        return false;
+    }
+    memcpy(date, field, date_length);
+    date[date_length] = '\0';
+
+    epoch = log_parse_date_time(date, time + 1);
+    return epoch != 0;
+}
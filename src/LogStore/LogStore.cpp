@@ -0,0 +1,1249 @@
+#include "LogStore.hpp"
+#include <RTClib.h>
+
+// Initialize the static instance
+//
+LogStore* LogStore::instance = nullptr;
+
+// Directory of the segments and the index listing them
+//
+const char log_segment_dir[]   = "temp/logs";
+const char log_segment_index[] = "temp/logs/segments.idx";
+
+// Records read from a segment at once during a replay
+//
+const uint8_t log_replay_batch = 8;
+
+// Summary entries read at once to check or compute their CRC
+//
+const uint8_t summary_crc_batch = 8;
+
+/*!
+* @brief Constructor.
+*/
+LogStore::LogStore()
+    : is_segment_open(false), open_segment_day(0), open_summary_offset(0), summary_merges(0),
+      merge_state(MERGE_IDLE), merge_segment(0), merge_offset(0), merge_saved(0), merge_total(0),
+      merge_position(0), merge_entry(0), merge_at(0), merge_crc(0), replay_corrupted(0),
+      scans_since_save(0), first_unsaved_scan_ms(0),
+      import_durability(LogWriter::SYNC_INTERVAL), import_interval(log_writer_sync_interval_ms),
+      is_summary_segment(false), is_summary_open(false), summary_segment(0), summary_empid(0),
+      summary_seen_merges(0), summary_left(0)
+{
+    summary.count = 0;
+}
+
+/*!
+* @brief Function to get the Singleton Instance.
+* @return The log store instance.
+*/
+LogStore*
+LogStore::get_instance()
+{
+    if (instance == nullptr)
+    {
+        instance = new LogStore();
+    }
+    return instance;
+}
+
+/*!
+* @brief Function to get the segment holding a unix time.
+* @param[in] epoch uint32_t unix time.
+* @return The first day of the segment, in days since 1970.
+*/
+uint32_t
+LogStore::segment_of(uint32_t epoch)
+{
+    uint32_t day = epoch / 86400UL;
+    return day - day % log_segment_days;
+}
+
+/*!
+* @brief Function to build the path of a segment file, named after its first day.
+* @param[in] segment uint32_t first day of the segment.
+* @param[in] extension const char * "bin" for the records, "sum" for the summary.
+* @param[out] path char * of log_segment_path_size bytes.
+*/
+void
+LogStore::segment_path(uint32_t segment, const char *extension, char *path)
+{
+    DateTime day(segment * 86400UL);
+    snprintf(path, log_segment_path_size, "%s/%04u%02u%02u.%s", log_segment_dir,
+             (unsigned)day.year(), (unsigned)day.month(), (unsigned)day.day(), extension);
+}
+
+/*!
+* @brief Function to open the last segment of the index. The records its
+*        summary misses are counted and saved at once.
+* @return The status if the last segment could be opened, true when there is none yet.
+*/
+bool
+LogStore::begin()
+{
+    LogWriter::get_instance()->close();
+    is_segment_open = false;
+    merge_file.close();
+    merge_state = MERGE_IDLE;
+    summary.count = 0;
+    scans_since_save = 0;
+
+    SD.mkdir(log_segment_dir);
+
+    uint16_t count = get_segment_count();
+    uint32_t segment;
+    if (count == 0 || !get_segment(count - 1, segment))
+    {
+        return true;
+    }
+    if (!open_segment(segment))
+    {
+        return false;
+    }
+
+    // Records the summary missed are replayed, save it for the next boot
+    //
+    save_summary();
+    return true;
+}
+
+/*!
+* @brief Function to remove every segment, its summary and the index.
+*/
+void
+LogStore::clear()
+{
+    LogWriter::get_instance()->close();
+    is_segment_open = false;
+    merge_file.close();
+    merge_state = MERGE_IDLE;
+    summary.count = 0;
+    scans_since_save = 0;
+
+    char path[log_segment_path_size];
+    uint16_t count = get_segment_count();
+    uint32_t segment;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (get_segment(i, segment))
+        {
+            segment_path(segment, "bin", path);
+            SD.remove(path);
+            segment_path(segment, "sum", path);
+            SD.remove(path);
+        }
+    }
+    SD.remove(log_segment_index);
+    SD.mkdir(log_segment_dir);
+}
+
+/*!
+* @brief Function to make a segment the one appended to. The table of the
+*        previous segment is merged into its summary by the log task, then
+*        the records the summary of the new one misses are counted, a
+*        damaged summary being rebuilt from the start.
+* @param[in] segment uint32_t first day of the segment.
+* @return The status if the segment could be opened.
+*/
+bool
+LogStore::open_segment(uint32_t segment)
+{
+    LogWriter *writer = LogWriter::get_instance();
+    if (is_segment_open)
+    {
+        // A merge of an older segment means the records of the previous one
+        // were not counted yet, they are before its segment is left. This
+        // only happens when segments are opened in a row, by an import
+        //
+        if (merge_state != MERGE_IDLE && merge_segment != open_segment_day)
+        {
+            finish_summary();
+        }
+        if (merge_state == MERGE_IDLE && summary.count > 0)
+        {
+            start_merge(open_segment_day, writer->end_offset());
+        }
+        is_segment_open = false;
+    }
+
+    char path[log_segment_path_size];
+    segment_path(segment, "bin", path);
+
+    // Listed before it is created, a segment is never missing from the index
+    //
+    if (!SD.exists(path) && !append_index(segment))
+    {
+        return false;
+    }
+
+    uint32_t offset = check_summary(segment);
+    if (offset == 0)
+    {
+        segment_path(segment, "sum", path);
+        SD.remove(path);
+        segment_path(segment, "bin", path);
+    }
+
+    if (!writer->open(path))
+    {
+        return false;
+    }
+    is_segment_open = true;
+    open_segment_day = segment;
+    open_summary_offset = offset;
+    scans_since_save = 0;
+
+    // A merge of the previous segment counts the new one when it is done
+    //
+    if (merge_state == MERGE_IDLE)
+    {
+        start_replay(segment, offset);
+    }
+    return true;
+}
+
+/*!
+* @brief Function to add a segment at the end of the index.
+* @param[in] segment uint32_t first day of the segment.
+* @return The status if the index was written.
+*/
+bool
+LogStore::append_index(uint32_t segment)
+{
+    File index = SD.open(log_segment_index, FILE_WRITE);
+    if (!index)
+    {
+        return false;
+    }
+
+    // A torn entry from a power cut is padded, the segment it names does not exist
+    //
+    for (uint32_t size = index.size(); size % sizeof(segment) != 0; size++)
+    {
+        index.write((uint8_t)0);
+    }
+    bool okay = index.write((const uint8_t *)&segment, sizeof(segment)) == sizeof(segment);
+    index.close();
+    return okay;
+}
+
+/*!
+* @brief Function to get the number of segments in the index.
+* @return The number of segments.
+*/
+uint16_t
+LogStore::get_segment_count()
+{
+    File index = SD.open(log_segment_index);
+    uint16_t count = index ? index.size() / sizeof(uint32_t) : 0;
+    index.close();
+    return count;
+}
+
+/*!
+* @brief Function to read the segment at a position of the index.
+* @param[in] position uint16_t of the segment, 0 is the oldest.
+* @param[out] segment uint32_t first day of the segment.
+* @return The status if the position exists.
+*/
+bool
+LogStore::get_segment(uint16_t position, uint32_t &segment)
+{
+    File index = SD.open(log_segment_index);
+    if (!index)
+    {
+        return false;
+    }
+
+    bool okay = index.seek((uint32_t)position * sizeof(segment)) &&
+                index.read(&segment, sizeof(segment)) == sizeof(segment);
+    index.close();
+    return okay;
+}
+
+/*!
+* @brief Function to append a scan to the segment of its date. The scan is
+*        counted in the summary table, or by the replay which follows a
+*        merge when the table is being merged or is full.
+* @param[in] empid uint32_t employee id.
+* @param[in] epoch uint32_t unix time of the scan.
+* @return The status if the scan was queued for the log.
+*/
+bool
+LogStore::append(uint32_t empid, uint32_t epoch)
+{
+    uint32_t segment = segment_of(epoch);
+    if ((!is_segment_open || segment != open_segment_day) && !open_segment(segment))
+    {
+        return false;
+    }
+
+    LogWriter *writer = LogWriter::get_instance();
+    uint32_t offset = writer->end_offset();
+    LogRecord record;
+    log_make_record(record, empid, epoch, LOG_EVENT_ACCESS);
+    if (!writer->append(record))
+    {
+        return false;
+    }
+
+    // A new employee beyond the table has the log task merge it into the
+    // summary file, which then covers the records before this one
+    //
+    if (merge_state == MERGE_IDLE && !add_to_summary(summary, empid, epoch))
+    {
+        start_merge(open_segment_day, offset);
+    }
+
+    if (scans_since_save == 0)
+    {
+        first_unsaved_scan_ms = millis();
+    }
+    scans_since_save++;
+    return true;
+}
+
+/*!
+* @brief Function to start a bulk import, records are buffered by whole sectors.
+*/
+void
+LogStore::begin_import()
+{
+    LogWriter *writer = LogWriter::get_instance();
+    import_durability = writer->get_durability();
+    import_interval = writer->get_sync_interval();
+    writer->set_durability(LogWriter::SYNC_FULL_SECTOR);
+}
+
+/*!
+* @brief Function to end a bulk import, the writer durability is restored
+*        and the summary saved.
+*/
+void
+LogStore::end_import()
+{
+    LogWriter::get_instance()->set_durability(import_durability, import_interval);
+    save_summary();
+}
+
+/*!
+* @brief Function to run the next step of a merge, or to start merging the
+*        summary table once enough scans were appended or the oldest
+*        unsaved one is old.
+*/
+void
+LogStore::run()
+{
+    if (merge_state != MERGE_IDLE)
+    {
+        merge_step();
+        return;
+    }
+
+    if (scans_since_save == 0 || !is_segment_open)
+    {
+        return;
+    }
+
+    if (scans_since_save >= summary_save_scans ||
+        millis() - first_unsaved_scan_ms >= summary_save_interval_ms)
+    {
+        start_merge(open_segment_day, LogWriter::get_instance()->end_offset());
+    }
+}
+
+/*!
+* @brief Function to save the summary of the open segment at once: a merge
+*        in progress is finished, then the table is merged into the summary
+*        file with the segment offset it covers.
+* @return The status if the summary was written.
+*/
+bool
+LogStore::save_summary()
+{
+    if (!finish_summary())
+    {
+        return false;
+    }
+
+    if (is_segment_open && summary.count > 0)
+    {
+        start_merge(open_segment_day, LogWriter::get_instance()->end_offset());
+    }
+    return finish_summary();
+}
+
+/*!
+* @brief Function to find the position of an employee in a summary table.
+* @param[in] table const SummaryTable& searched.
+* @param[in] empid uint32_t employee id.
+* @return The first entry whose id is not lower, count when every id is lower.
+*/
+uint8_t
+LogStore::table_position(const SummaryTable &table, uint32_t empid)
+{
+    uint8_t low = 0;
+    uint8_t high = table.count;
+    while (low < high)
+    {
+        uint8_t mid = (low + high) / 2;
+        if (table.entries[mid].empid < empid)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/*!
+* @brief Function to count a scan in a summary table.
+* @param[in,out] table SummaryTable& of the counted employees.
+* @param[in] empid uint32_t employee id.
+* @param[in] epoch uint32_t unix time of the scan.
+* @return The status if the scan was counted, false when the table is full.
+*/
+bool
+LogStore::add_to_summary(SummaryTable &table, uint32_t empid, uint32_t epoch)
+{
+    uint8_t position = table_position(table, empid);
+    if (position < table.count && table.entries[position].empid == empid)
+    {
+        SummaryEntry &entry = table.entries[position];
+        entry.first_epoch = min(entry.first_epoch, epoch);
+        entry.last_epoch = max(entry.last_epoch, epoch);
+        if (entry.count != 0xFFFF)
+        {
+            entry.count++;
+        }
+        return true;
+    }
+
+    if (table.count == summary_table_entries)
+    {
+        return false;
+    }
+
+    memmove(&table.entries[position + 1], &table.entries[position],
+            (table.count - position) * sizeof(SummaryEntry));
+    SummaryEntry &entry = table.entries[position];
+    entry.empid = empid;
+    entry.first_epoch = epoch;
+    entry.last_epoch = epoch;
+    entry.count = 1;
+    entry.reserved = 0;
+    table.count++;
+    return true;
+}
+
+/*!
+* @brief Function to add the scans counted since a summary was saved to the
+*        saved entry of the same employee.
+* @param[in,out] entry SummaryEntry& saved.
+* @param[in] counted const SummaryEntry& counted since.
+*/
+void
+LogStore::combine(SummaryEntry &entry, const SummaryEntry &counted)
+{
+    entry.first_epoch = min(entry.first_epoch, counted.first_epoch);
+    entry.last_epoch = max(entry.last_epoch, counted.last_epoch);
+    entry.count = min((uint32_t)entry.count + counted.count, (uint32_t)0xFFFF);
+}
+
+/*!
+* @brief Function to open a summary file and check its header and size,
+*        positioned on its first entry. A summary covering no record is
+*        being merged, or was torn by a power cut during a merge.
+* @param[in] segment uint32_t first day of the segment.
+* @param[out] file File of the summary.
+* @param[out] header SummaryHeader read from the file.
+* @return The status if the summary is complete.
+*/
+bool
+LogStore::open_summary(uint32_t segment, File &file, SummaryHeader &header)
+{
+    char path[log_segment_path_size];
+    segment_path(segment, "sum", path);
+    file = SD.open(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    if (file.read(&header, sizeof(header)) != sizeof(header) || !log_check_summary_header(header) ||
+        header.log_offset == 0 ||
+        file.size() != sizeof(header) + (uint32_t)header.entry_count * sizeof(SummaryEntry))
+    {
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+/*!
+* @brief Function to position an open summary file on its first entry whose
+*        employee id is not lower than an id, found by halves.
+* @param[in] file File& of the summary, from open_summary().
+* @param[in] header const SummaryHeader& of the summary.
+* @param[in] empid uint32_t employee id.
+* @return The position of the entry, entry_count when every id is lower.
+*/
+uint16_t
+LogStore::seek_summary(File &file, const SummaryHeader &header, uint32_t empid)
+{
+    SummaryEntry entry;
+    uint16_t low = 0;
+    uint16_t high = header.entry_count;
+    while (low < high)
+    {
+        uint16_t mid = low + (high - low) / 2;
+        if (!file.seek(sizeof(header) + (uint32_t)mid * sizeof(SummaryEntry)) ||
+            file.read(&entry, sizeof(entry)) != sizeof(entry))
+        {
+            return header.entry_count;
+        }
+
+        if (entry.empid < empid)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    file.seek(sizeof(header) + (uint32_t)low * sizeof(SummaryEntry));
+    return low;
+}
+
+/*!
+* @brief Function to check the summary of a segment, the CRC of its entries
+*        and that it does not cover more than the segment.
+* @param[in] segment uint32_t first day of the segment.
+* @return The segment offset covered by the summary, 0 when there is no intact summary.
+*/
+uint32_t
+LogStore::check_summary(uint32_t segment)
+{
+    char path[log_segment_path_size];
+    segment_path(segment, "bin", path);
+    File records = SD.open(path);
+    uint32_t segment_size = records ? records.size() : 0;
+    records.close();
+
+    File file;
+    SummaryHeader header;
+    if (!open_summary(segment, file, header))
+    {
+        return 0;
+    }
+
+    SummaryEntry entries[summary_crc_batch];
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i < header.entry_count; i += summary_crc_batch)
+    {
+        uint16_t bytes = min(header.entry_count - i, (int)summary_crc_batch) * sizeof(SummaryEntry);
+        file.read(entries, bytes);
+        crc = log_crc16_update(crc, (const uint8_t *)entries, bytes);
+    }
+    file.close();
+
+    if (crc != header.entries_crc || header.log_offset > segment_size)
+    {
+        return 0;
+    }
+    return header.log_offset;
+}
+
+/*!
+* @brief Function to stop counting scans in the summary table, the log task
+*        then merges it into the summary file of a segment. Nothing is
+*        read or written yet.
+* @param[in] segment uint32_t first day of the segment counted by the table.
+* @param[in] offset uint32_t segment bytes covered by the summary once merged.
+*/
+void
+LogStore::start_merge(uint32_t segment, uint32_t offset)
+{
+    merge_state = MERGE_OPEN;
+    merge_segment = segment;
+    merge_offset = offset;
+    if (is_segment_open && segment == open_segment_day)
+    {
+        scans_since_save = 0;
+    }
+}
+
+/*!
+* @brief Function to count the records of a segment from an offset in the
+*        summary table, the log task reads a few of them per run.
+* @param[in] segment uint32_t first day of the segment.
+* @param[in] offset uint32_t of the first record to count, 0 for the whole segment.
+*/
+void
+LogStore::start_replay(uint32_t segment, uint32_t offset)
+{
+    merge_state = MERGE_REPLAY;
+    merge_segment = segment;
+    merge_offset = offset;
+}
+
+/*!
+* @brief Function to run the next step of a merge or a replay. A step reads
+*        or writes at most summary_merge_step entries or records, whatever
+*        the number of employees in the summary file. A failed step drops
+*        the summary file, which is rebuilt from the records.
+* @return The status if the step succeeded.
+*/
+bool
+LogStore::merge_step()
+{
+    bool okay = true;
+    switch (merge_state)
+    {
+        case MERGE_OPEN:
+            okay = open_merge();
+            break;
+        case MERGE_COUNT:
+            okay = count_step();
+            break;
+        case MERGE_MOVE:
+            okay = move_step();
+            break;
+        case MERGE_CRC:
+            okay = crc_step();
+            break;
+        case MERGE_REPLAY:
+            okay = replay_step();
+            break;
+        default:
+            break;
+    }
+
+    if (!okay)
+    {
+        abort_merge();
+    }
+    return okay;
+}
+
+/*!
+* @brief Function to run the steps of a merge and of the replays following
+*        it until the table counts the scans of the open segment again.
+* @return The status if every step succeeded, false on the first failure.
+*/
+bool
+LogStore::finish_summary()
+{
+    while (merge_state != MERGE_IDLE)
+    {
+        if (!merge_step())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+* @brief Function to drop the summary file and the table after a failed
+*        step. The open segment is counted again from its first record, a
+*        closed one is rebuilt when it is read next.
+*/
+void
+LogStore::abort_merge()
+{
+    merge_file.close();
+
+    char path[log_segment_path_size];
+    segment_path(merge_segment, "sum", path);
+    SD.remove(path);
+    summary.count = 0;
+
+    if (!is_segment_open)
+    {
+        merge_state = MERGE_IDLE;
+    }
+    else if (merge_segment == open_segment_day)
+    {
+        open_summary_offset = 0;
+        start_replay(open_segment_day, 0);
+    }
+    else
+    {
+        start_replay(open_segment_day, open_summary_offset);
+    }
+}
+
+/*!
+* @brief Function to open the summary file a merge writes to, created when
+*        missing. A damaged summary file fails the merge, the segment is
+*        then counted again.
+* @return The status if the summary file is open.
+*/
+bool
+LogStore::open_merge()
+{
+    char path[log_segment_path_size];
+    segment_path(merge_segment, "sum", path);
+
+    SummaryHeader header;
+    merge_saved = 0;
+    if (open_summary(merge_segment, merge_file, header))
+    {
+        merge_saved = header.entry_count;
+        merge_file.close();
+    }
+    else if (SD.exists(path))
+    {
+        return false;
+    }
+
+    // A new file has no entry to seek to
+    //
+    merge_file = SD.open(path, O_RDWR | O_CREAT);
+    if (!merge_file || (merge_saved > 0 && !merge_file.seek(sizeof(header))))
+    {
+        Serial.println(F("Error: Could not open RFID log summary!"));
+        return false;
+    }
+
+    merge_total = merge_saved + summary.count;
+    merge_position = 0;
+    merge_entry = 0;
+    merge_state = MERGE_COUNT;
+    return true;
+}
+
+/*!
+* @brief Function to count the employees of the table already in the
+*        summary file. Once counted the header is marked as covering no
+*        record, the merge being atomic only once the final header is
+*        written: a summary torn by a power cut is rebuilt from the segment.
+*        The file is then padded to the size of the merged summary.
+* @return The status if the entries were read and the header written.
+*/
+bool
+LogStore::count_step()
+{
+    SummaryEntry entry;
+    for (uint8_t n = 0; n < summary_merge_step && merge_position < merge_saved && merge_entry < summary.count; n++)
+    {
+        if (merge_file.read(&entry, sizeof(entry)) != sizeof(entry))
+        {
+            return false;
+        }
+        merge_position++;
+
+        while (merge_entry < summary.count && summary.entries[merge_entry].empid < entry.empid)
+        {
+            merge_entry++;
+        }
+        if (merge_entry < summary.count && summary.entries[merge_entry].empid == entry.empid)
+        {
+            merge_total--;
+            merge_entry++;
+        }
+    }
+
+    if (merge_position < merge_saved && merge_entry < summary.count)
+    {
+        return true;
+    }
+
+    SummaryHeader header;
+    log_make_summary_header(header, merge_saved, 0, 0);
+    if (!merge_file.seek(0) || merge_file.write((const uint8_t *)&header, sizeof(header)) != sizeof(header))
+    {
+        return false;
+    }
+
+    // At most a table of entries is added
+    //
+    static const uint8_t zeros[sizeof(SummaryEntry)] = {};
+    merge_file.seek(merge_file.size());
+    while (merge_file.size() < sizeof(header) + (uint32_t)merge_total * sizeof(SummaryEntry))
+    {
+        if (merge_file.write(zeros, sizeof(zeros)) != sizeof(zeros))
+        {
+            Serial.println(F("Error: Could not write RFID log summary!"));
+            return false;
+        }
+    }
+
+    merge_position = merge_saved;
+    merge_entry = summary.count;
+    merge_at = merge_total;
+    merge_state = MERGE_MOVE;
+    return true;
+}
+
+/*!
+* @brief Function to merge the table into the summary file. Both are sorted
+*        by employee id, so the file is merged in place from its end, every
+*        entry moving towards the end of the file. The entries below the
+*        lowest employee of the table stay where they are.
+* @return The status if the entries were moved.
+*/
+bool
+LogStore::move_step()
+{
+    for (uint8_t n = 0; n < summary_merge_step && merge_entry > 0; n++)
+    {
+        const SummaryEntry &counted = summary.entries[merge_entry - 1];
+        SummaryEntry entry;
+        if (merge_position > 0 &&
+            (!merge_file.seek(sizeof(SummaryHeader) + (uint32_t)(merge_position - 1) * sizeof(SummaryEntry)) ||
+             merge_file.read(&entry, sizeof(entry)) != sizeof(entry)))
+        {
+            return false;
+        }
+
+        SummaryEntry merged;
+        if (merge_position > 0 && entry.empid > counted.empid)
+        {
+            merged = entry;
+            merge_position--;
+        }
+        else if (merge_position > 0 && entry.empid == counted.empid)
+        {
+            merged = entry;
+            combine(merged, counted);
+            merge_position--;
+            merge_entry--;
+        }
+        else
+        {
+            merged = counted;
+            merge_entry--;
+        }
+
+        merge_at--;
+        if (!merge_file.seek(sizeof(SummaryHeader) + (uint32_t)merge_at * sizeof(SummaryEntry)) ||
+            merge_file.write((const uint8_t *)&merged, sizeof(merged)) != sizeof(merged))
+        {
+            return false;
+        }
+    }
+
+    if (merge_entry == 0)
+    {
+        merge_position = 0;
+        merge_crc = 0xFFFF;
+        merge_state = MERGE_CRC;
+        return merge_file.seek(sizeof(SummaryHeader));
+    }
+    return true;
+}
+
+/*!
+* @brief Function to compute the CRC of the merged entries, then to write
+*        the final header with the segment offset the summary covers. The
+*        table is emptied and the records appended since the merge started
+*        are replayed.
+* @return The status if the entries were read and the header written.
+*/
+bool
+LogStore::crc_step()
+{
+    SummaryEntry entries[summary_crc_batch];
+    for (uint8_t n = 0; n < summary_merge_step && merge_position < merge_total; n += summary_crc_batch)
+    {
+        uint16_t bytes = min(merge_total - merge_position, (int)summary_crc_batch) * sizeof(SummaryEntry);
+        if (merge_file.read(entries, bytes) != bytes)
+        {
+            return false;
+        }
+        merge_crc = log_crc16_update(merge_crc, (const uint8_t *)entries, bytes);
+        merge_position += bytes / sizeof(SummaryEntry);
+    }
+
+    if (merge_position < merge_total)
+    {
+        return true;
+    }
+
+    // The summary covers only records on the card
+    //
+    bool is_open = is_segment_open && merge_segment == open_segment_day;
+    if (is_open)
+    {
+        LogWriter::get_instance()->sync();
+    }
+
+    SummaryHeader header;
+    log_make_summary_header(header, merge_total, merge_offset, merge_crc);
+    bool okay = merge_file.seek(0) &&
+                merge_file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+    merge_file.close();
+    if (!okay)
+    {
+        return false;
+    }
+
+    summary.count = 0;
+    summary_merges++;
+    if (is_open)
+    {
+        open_summary_offset = merge_offset;
+    }
+    start_replay(merge_segment, merge_offset);
+    return true;
+}
+
+/*!
+* @brief Function to count the next records of a segment in the table. When
+*        the table is full it is merged first, the summary file then covering
+*        the records before the one being counted. At the end of the open
+*        segment the table counts the scans again; a closed segment gets its
+*        final summary, then the records of the open one are counted.
+* @return The status if the records were read.
+*/
+bool
+LogStore::replay_step()
+{
+    char path[log_segment_path_size];
+    segment_path(merge_segment, "bin", path);
+    File file = SD.open(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    if (merge_offset < sizeof(LogHeader))
+    {
+        LogHeader header;
+        if (file.read(&header, sizeof(header)) != sizeof(header) || !log_check_header(header))
+        {
+            Serial.println(F("Error: Unknown RFID log format!"));
+            file.close();
+            return false;
+        }
+        merge_offset = sizeof(header);
+    }
+    else if (!file.seek(merge_offset))
+    {
+        file.close();
+        return false;
+    }
+
+    // A torn record at the end of the segment is ignored
+    //
+    LogRecord records[log_replay_batch];
+    int bytes = 0;
+    for (uint8_t n = 0; n < summary_merge_step; n += log_replay_batch)
+    {
+        bytes = file.read(records, sizeof(records));
+        if (bytes < (int)sizeof(LogRecord))
+        {
+            break;
+        }
+
+        uint8_t count = bytes / sizeof(LogRecord);
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (!log_check_record(records[i]))
+            {
+                replay_corrupted++;
+            }
+            else if (!add_to_summary(summary, records[i].empid, records[i].epoch))
+            {
+                file.close();
+                start_merge(merge_segment, merge_offset + i * sizeof(LogRecord));
+                return true;
+            }
+        }
+        merge_offset += count * sizeof(LogRecord);
+    }
+
+    uint32_t size = file.size();
+    file.close();
+    if (bytes == (int)sizeof(records))
+    {
+        return true;
+    }
+
+    // Records still buffered are written for the next step to count them
+    //
+    bool is_open = is_segment_open && merge_segment == open_segment_day;
+    LogWriter *writer = LogWriter::get_instance();
+    if (is_open && writer->end_offset() > size)
+    {
+        writer->sync();
+        return true;
+    }
+
+    if (replay_corrupted > 0)
+    {
+        Serial.print(F("Skipped corrupted RFID log records: "));
+        Serial.println(replay_corrupted);
+        replay_corrupted = 0;
+    }
+
+    if (is_open)
+    {
+        merge_state = MERGE_IDLE;
+        return true;
+    }
+
+    // A closed segment is complete once its summary covers all of it
+    //
+    File summary_file;
+    SummaryHeader header;
+    bool is_covered = open_summary(merge_segment, summary_file, header) && header.log_offset == size;
+    summary_file.close();
+    if (summary.count > 0 || !is_covered)
+    {
+        start_merge(merge_segment, size);
+    }
+    else if (is_segment_open)
+    {
+        start_replay(open_segment_day, open_summary_offset);
+    }
+    else
+    {
+        merge_state = MERGE_IDLE;
+    }
+    return true;
+}
+
+/*!
+* @brief Function to rebuild the summary of a closed segment which is
+*        missing, damaged or does not cover the whole segment. The table of
+*        the open segment is saved first and then counts the closed one.
+* @param[in] segment uint32_t first day of the segment.
+* @return The status if the summary was rebuilt.
+*/
+bool
+LogStore::repair_summary(uint32_t segment)
+{
+    if (!save_summary())
+    {
+        return false;
+    }
+
+    uint32_t offset = check_summary(segment);
+    if (offset == 0)
+    {
+        char path[log_segment_path_size];
+        segment_path(segment, "sum", path);
+        SD.remove(path);
+    }
+
+    start_replay(segment, offset);
+    return finish_summary();
+}
+
+/*!
+* @brief Function to find the first summary entry of a segment whose employee
+*        id is not lower than an id. A merge in progress is finished first,
+*        then the entries of the open segment counted since the last save
+*        are added to those of its file.
+* @param[in] segment uint32_t first day of the segment.
+* @param[in] empid uint32_t employee id.
+* @param[out] entry SummaryEntry found.
+* @return The status if an entry was found.
+*/
+bool
+LogStore::next_in_segment(uint32_t segment, uint32_t empid, SummaryEntry &entry)
+{
+    finish_summary();
+
+    bool is_open = is_segment_open && segment == open_segment_day;
+
+    // A closed segment got its final summary when the next one was opened,
+    // only a damaged summary is rebuilt
+    //
+    File file;
+    SummaryHeader header;
+    bool is_saved = false;
+    if (open_summary(segment, file, header) ||
+        (!is_open && repair_summary(segment) && open_summary(segment, file, header)))
+    {
+        is_saved = seek_summary(file, header, empid) < header.entry_count &&
+                   file.read(&entry, sizeof(entry)) == sizeof(entry);
+        file.close();
+    }
+
+    uint8_t position = table_position(summary, empid);
+    if (!is_open || position == summary.count)
+    {
+        return is_saved;
+    }
+
+    const SummaryEntry &counted = summary.entries[position];
+    if (!is_saved || counted.empid < entry.empid)
+    {
+        entry = counted;
+    }
+    else if (counted.empid == entry.empid)
+    {
+        combine(entry, counted);
+    }
+    return true;
+}
+
+/*!
+* @brief Function to restart reading the summaries from the oldest segment.
+*/
+void
+LogStore::rewind_summaries()
+{
+    summary_file.close();
+    index_file.close();
+    index_file = SD.open(log_segment_index);
+    is_summary_segment = false;
+}
+
+/*!
+* @brief Function to read the next summary entry, from the summary files in
+*        order. The table of the open segment is saved when its turn comes;
+*        a merge of the segment being read is finished, and when its file
+*        is rewritten meanwhile the read resumes after the last employee read.
+* @param[out] entry SummaryEntry read.
+* @return The status if an entry was read, false after the last segment.
+*/
+bool
+LogStore::next_summary(SummaryEntry &entry)
+{
+    SummaryHeader header;
+    for (;;)
+    {
+        if (!is_summary_segment)
+        {
+            if (!index_file || index_file.read(&summary_segment, sizeof(summary_segment)) != sizeof(summary_segment))
+            {
+                index_file.close();
+                return false;
+            }
+
+            // A closed segment got its final summary when the next one was
+            // opened, only a damaged summary is rebuilt
+            //
+            is_summary_open = is_segment_open && summary_segment == open_segment_day;
+            if (is_summary_open)
+            {
+                save_summary();
+            }
+            else
+            {
+                finish_summary();
+            }
+
+            summary_left = 0;
+            summary_empid = 0;
+            summary_seen_merges = summary_merges;
+            if (open_summary(summary_segment, summary_file, header) ||
+                (!is_summary_open && repair_summary(summary_segment) &&
+                 open_summary(summary_segment, summary_file, header)))
+            {
+                summary_left = header.entry_count;
+            }
+            is_summary_segment = true;
+        }
+
+        if (merge_state != MERGE_IDLE && merge_segment == summary_segment)
+        {
+            finish_summary();
+        }
+        if (summary_seen_merges != summary_merges)
+        {
+            summary_file.close();
+            summary_left = 0;
+            summary_seen_merges = summary_merges;
+            if (summary_empid != 0 && open_summary(summary_segment, summary_file, header))
+            {
+                summary_left = header.entry_count - seek_summary(summary_file, header, summary_empid);
+            }
+        }
+
+        if (summary_left > 0 && summary_file.read(&entry, sizeof(entry)) == sizeof(entry))
+        {
+            // The highest employee id ends the segment
+            //
+            summary_left = (entry.empid == 0xFFFFFFFFUL) ? 0 : summary_left - 1;
+            summary_empid = entry.empid + 1;
+            return true;
+        }
+
+        summary_file.close();
+        is_summary_segment = false;
+    }
+}
+
+/*!
+* @brief Function to find the summary entry of an employee in a segment. The
+*        summary file is searched by halves, its entries being sorted by
+*        employee id, and the open segment adds the scans counted since.
+* @param[in] segment uint32_t first day of the segment.
+* @param[in] empid uint32_t employee id.
+* @param[out] entry SummaryEntry of the employee.
+* @return The status if the employee scanned during the segment.
+*/
+bool
+LogStore::find_summary(uint32_t segment, uint32_t empid, SummaryEntry &entry)
+{
+    return next_in_segment(segment, empid, entry) && entry.empid == empid;
+}
+
+/*!
+* @brief Function to start reading the raw records of a segment.
+* @param[in] segment uint32_t first day of the segment.
+* @return The status if the segment exists.
+*/
+bool
+LogStore::rewind_records(uint32_t segment)
+{
+    records_file.close();
+
+    // Records still buffered are part of the segment
+    //
+    if (is_segment_open && segment == open_segment_day)
+    {
+        LogWriter::get_instance()->sync();
+    }
+
+    char path[log_segment_path_size];
+    segment_path(segment, "bin", path);
+    records_file = SD.open(path);
+    if (!records_file)
+    {
+        return false;
+    }
+
+    LogHeader header;
+    if (records_file.read(&header, sizeof(header)) != sizeof(header) || !log_check_header(header))
+    {
+        records_file.close();
+        return false;
+    }
+    return true;
+}
+
+/*!
+* @brief Function to read the next intact record of the segment.
+* @param[out] record LogRecord read.
+* @return The status if a record was read, false at the end of the segment.
+*/
+bool
+LogStore::next_record(LogRecord &record)
+{
+    if (!records_file)
+    {
+        return false;
+    }
+
+    while (records_file.read(&record, sizeof(record)) == sizeof(record))
+    {
+        if (log_check_record(record))
+        {
+            return true;
+        }
+    }
+    records_file.close();
+    return false;
+}
@@ -0,0 +1,253 @@
+#include "LogWriter.hpp"
+
+// Initialize the static instance
+//
+LogWriter* LogWriter::instance = nullptr;
+
+/*!
+* @brief Constructor.
+*/
+LogWriter::LogWriter()
+    : durability(SYNC_INTERVAL), interval_ms(log_writer_sync_interval_ms),
+      buffered(0), first_buffered_ms(0)
+{
+    reset_stats();
+}
+
+/*!
+* @brief Function to get the Singleton Instance.
+* @return The log writer instance.
+*/
+LogWriter*
+LogWriter::get_instance()
+{
+    if (instance == nullptr)
+    {
+        instance = new LogWriter();
+    }
+    return instance;
+}
+
+/*!
+* @brief Function to open the log for appending, writing the header when
+*        the file is new. A record torn by a power cut is padded to a whole
+*        record, which fails its CRC, so the next ones are not shifted.
+*        An already open log is synced and closed first.
+* @param[in] path const char * of the log file.
+* @return The status if the log could be opened.
+*/
+bool
+LogWriter::open(const char *path)
+{
+    close();
+
+    file = SD.open(path, FILE_WRITE);
+    if (!file)
+    {
+        return false;
+    }
+
+    if (file.size() == 0)
+    {
+        LogHeader header;
+        log_make_header(header);
+        bytes_written += file.write((const uint8_t *)&header, sizeof(header));
+        file.flush();
+        flushes++;
+    }
+    else if (file.size() > sizeof(LogHeader))
+    {
+        uint32_t torn = (file.size() - sizeof(LogHeader)) % sizeof(LogRecord);
+        if (torn != 0)
+        {
+            static const uint8_t zeros[sizeof(LogRecord)] = {};
+            bytes_written += file.write(zeros, sizeof(LogRecord) - torn);
+            file.flush();
+            flushes++;
+        }
+    }
+    return true;
+}
+
+/*!
+* @brief Function to sync the buffered records and close the log.
+*/
+void
+LogWriter::close()
+{
+    if (!file)
+    {
+        return;
+    }
+
+    sync();
+    file.close();
+}
+
+/*!
+* @brief Function to check if the log is open.
+* @return The status if the log is open.
+*/
+bool
+LogWriter::is_open() const
+{
+    return (bool)file;
+}
+
+/*!
+* @brief Function to get the size of the log on the card.
+* @return The size in bytes, 0 when the log is not open.
+*/
+uint32_t
+LogWriter::size()
+{
+    return file ? file.size() : 0;
+}
+
+/*!
+* @brief Function to get the offset the next record is written at.
+* @return The size of the log once the buffered records are written, 0 when
+*         the log is not open.
+*/
+uint32_t
+LogWriter::end_offset()
+{
+    return file ? file.size() + (uint32_t)buffered * sizeof(LogRecord) : 0;
+}
+
+/*!
+* @brief Function to queue a record for the log.
+* @param[in] record const LogRecord& to append.
+* @return The status if the record was queued, false when the log is not open.
+*/
+bool
+LogWriter::append(const LogRecord &record)
+{
+    if (!file)
+    {
+        return false;
+    }
+
+    if (buffered == 0)
+    {
+        first_buffered_ms = millis();
+    }
+    buffer[buffered++] = record;
+    records++;
+
+    // A full buffer is one sector, it is written in every mode
+    //
+    if (durability == SYNC_EVERY_RECORD || buffered >= log_writer_buffer_records)
+    {
+        sync();
+    }
+    return true;
+}
+
+/*!
+* @brief Function to write the buffered records and flush them to the card.
+*/
+void
+LogWriter::sync()
+{
+    if (!file || buffered == 0)
+    {
+        return;
+    }
+
+    bytes_written += file.write((const uint8_t *)buffer, buffered * sizeof(LogRecord));
+    file.flush();
+    flushes++;
+    buffered = 0;
+}
+
+/*!
+* @brief Function to sync the buffer once its oldest record is older than
+*        the interval, only in the SYNC_INTERVAL mode.
+*/
+void
+LogWriter::run()
+{
+    if (durability != SYNC_INTERVAL || buffered == 0)
+    {
+        return;
+    }
+
+    if (millis() - first_buffered_ms >= interval_ms)
+    {
+        sync();
+    }
+}
+
+/*!
+* @brief Function to select when the buffered records are written. The
+*        records already buffered are synced first.
+* @param[in] mode Durability to apply.
+* @param[in] interval uint16_t maximum age in milliseconds of a buffered record in SYNC_INTERVAL.
+*/
+void
+LogWriter::set_durability(Durability mode, uint16_t interval)
+{
+    sync();
+    durability = mode;
+    interval_ms = interval;
+}
+
+/*!
+* @brief Function to get the durability mode.
+* @return The durability mode.
+*/
+LogWriter::Durability
+LogWriter::get_durability() const
+{
+    return durability;
+}
+
+/*!
+* @brief Function to get the maximum age of a buffered record in SYNC_INTERVAL.
+* @return The interval in milliseconds.
+*/
+uint16_t
+LogWriter::get_sync_interval() const
+{
+    return interval_ms;
+}
+
+/*!
+* @brief Function to clear the write counters.
+*/
+void
+LogWriter::reset_stats()
+{
+    records = 0;
+    flushes = 0;
+    bytes_written = 0;
+}
+
+/*!
+* @brief Function to display the write counters in the terminal.
+*/
+void
+LogWriter::print_stats()
+{
+    Serial.print(F("Log durability: "));
+    switch (durability)
+    {
+        case SYNC_EVERY_RECORD: Serial.println(F("every record")); break;
+        case SYNC_FULL_SECTOR:  Serial.println(F("full sector"));  break;
+        default:
+            Serial.print(F("every "));
+            Serial.print(interval_ms);
+            Serial.println(F(" ms"));
+            break;
+    }
+    Serial.print(F("Log records: "));
+    Serial.print(records);
+    Serial.print(F(" ("));
+    Serial.print(buffered);
+    Serial.println(F(" buffered)"));
+    Serial.print(F("Log flushes: "));
+    Serial.println(flushes);
+    Serial.print(F("Log bytes written: "));
+    Serial.println(bytes_written);
+}
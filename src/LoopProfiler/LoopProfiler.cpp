@@ -0,0 +1,270 @@
+#include "LoopProfiler.hpp"
+#include "MemoryStats.hpp"
+
+// Initialize the static instance
+//
+LoopProfiler* LoopProfiler::instance = nullptr;
+
+/*!
+* @brief Function to print a value left aligned in a column of the terminal table.
+* @param[in] text const String& of the value.
+* @param[in] width uint8_t of the column width.
+*/
+static void
+print_column(const String &text, uint8_t width)
+{
+    Serial.print(text);
+    for (uint8_t j = text.length(); j < width; j++)
+    {
+        Serial.print(F(" "));
+    }
+}
+
+/*!
+* @brief Constructor.
+*/
+LoopProfiler::LoopProfiler() : boot_phase_count(0)
+{
+    reset();
+    boot_mark_us = reset_us;
+    boot_mark_allocs = memory_alloc_count();
+}
+
+/*!
+* @brief Function to get the Singleton Instance.
+* @return The profiler instance.
+*/
+LoopProfiler*
+LoopProfiler::get_instance()
+{
+    if (instance == nullptr)
+    {
+        instance = new LoopProfiler();
+    }
+    return instance;
+}
+
+/*!
+* @brief Function to mark the start of a task.
+* @param[in] task Task which is about to run.
+*/
+void
+LoopProfiler::begin_task(Task task)
+{
+    task_start_allocs[task] = memory_alloc_count();
+    task_start_us[task] = micros();
+}
+
+/*!
+* @brief Function to mark the end of a task and record its execution time.
+* @param[in] task Task which just finished.
+*/
+void
+LoopProfiler::end_task(Task task)
+{
+    uint32_t duration_us = micros() - task_start_us[task];
+    TaskStats &s = stats[task];
+
+    s.allocs += memory_alloc_count() - task_start_allocs[task];
+    s.count++;
+    s.total_us += duration_us;
+    if (duration_us < s.min_us)
+    {
+        s.min_us = duration_us;
+    }
+    if (duration_us > s.max_us)
+    {
+        s.max_us = duration_us;
+    }
+
+    uint8_t bucket = bucket_of(duration_us);
+    if (s.histogram[bucket] != 0xFFFF)
+    {
+        s.histogram[bucket]++;
+    }
+}
+
+/*!
+* @brief Function to clear all the statistics. The start of a task running
+*        meanwhile is kept, its run is measured in full.
+*/
+void
+LoopProfiler::reset()
+{
+    for (uint8_t t = 0; t < TASK_COUNT; t++)
+    {
+        stats[t].count = 0;
+        stats[t].min_us = 0xFFFFFFFFUL;
+        stats[t].max_us = 0;
+        stats[t].total_us = 0;
+        stats[t].allocs = 0;
+        for (uint8_t b = 0; b < profiler_bucket_count; b++)
+        {
+            stats[t].histogram[b] = 0;
+        }
+    }
+    reset_us = micros();
+}
+
+/*!
+* @brief Function to find the histogram bucket of a duration.
+* @param[in] duration_us uint32_t execution time in microseconds.
+* @return The bucket index.
+*/
+uint8_t
+LoopProfiler::bucket_of(uint32_t duration_us)
+{
+    uint8_t log2 = 0;
+    while (duration_us > 1)
+    {
+        duration_us >>= 1;
+        log2++;
+    }
+
+    if (log2 < profiler_first_bucket_log2)
+    {
+        return 0;
+    }
+
+    uint8_t bucket = log2 - profiler_first_bucket_log2 + 1;
+    return (bucket < profiler_bucket_count) ? bucket : profiler_bucket_count - 1;
+}
+
+/*!
+* @brief Function to get the display name of a task.
+* @param[in] task Task to name.
+* @return The name of the task.
+*/
+const char*
+LoopProfiler::task_name(Task task)
+{
+    switch (task)
+    {
+        case TASK_USER_OPERATION:  return "user";
+        case TASK_ADMIN_OPERATION: return "admin";
+        case TASK_BUTTON:          return "button";
+        case TASK_DOOR:            return "door";
+        case TASK_SCREEN:          return "screen";
+        case TASK_LOG:             return "log";
+        case TASK_STORE:           return "store";
+        case TASK_MEMORY:          return "memory";
+        case TASK_LOOP:            return "loop";
+        default:                   return "?";
+    }
+}
+
+/*!
+* @brief Function to display the statistics of every task in the terminal.
+*/
+void
+LoopProfiler::print_stats()
+{
+    uint32_t elapsed_us = micros() - reset_us;
+
+    Serial.println(F("TASK      COUNT      MIN(us)    AVG(us)    MAX(us)    ALLOCS"));
+    Serial.println(F("-------------------------------------------------------------"));
+
+    for (uint8_t t = 0; t < TASK_COUNT; t++)
+    {
+        const TaskStats &s = stats[t];
+        uint32_t avg_us = (s.count > 0) ? (uint32_t)(s.total_us / s.count) : 0;
+        uint32_t min_us = (s.count > 0) ? s.min_us : 0;
+
+        print_column(task_name((Task)t), 10);
+        print_column(String(s.count), 11);
+        print_column(String(min_us), 11);
+        print_column(String(avg_us), 11);
+        print_column(String(s.max_us), 11);
+        Serial.println(s.allocs);
+    }
+
+    // Loop frequency since the last reset
+    //
+    Serial.println();
+    Serial.print(F("Loop frequency: "));
+    if (elapsed_us > 0)
+    {
+        Serial.print((double)stats[TASK_LOOP].count * 1000000.0 / (double)elapsed_us, 2);
+    }
+    else
+    {
+        Serial.print(0);
+    }
+    Serial.print(F(" Hz over "));
+    Serial.print(elapsed_us / 1000UL);
+    Serial.println(F(" ms"));
+}
+
+/*!
+* @brief Function to display the duration histogram of every task in the
+*        terminal, only the buckets which were hit.
+*/
+void
+LoopProfiler::print_histogram()
+{
+    Serial.println(F("Histogram (bucket lower bound in us: count)"));
+    for (uint8_t t = 0; t < TASK_COUNT; t++)
+    {
+        Serial.print(task_name((Task)t));
+        Serial.print(F(":"));
+        for (uint8_t b = 0; b < profiler_bucket_count; b++)
+        {
+            if (stats[t].histogram[b] == 0)
+            {
+                continue;
+            }
+            uint32_t lower_us = (b == 0) ? 0 : (1UL << (b + profiler_first_bucket_log2 - 1));
+            Serial.print(F(" "));
+            Serial.print(lower_us);
+            Serial.print(F(":"));
+            Serial.print(stats[t].histogram[b]);
+        }
+        Serial.println();
+    }
+}
+
+/*!
+* @brief Function to record the duration of a boot phase, measured from the
+*        end of the previous one or from the creation of the profiler.
+* @param[in] name const char * of the phase, must stay valid.
+*/
+void
+LoopProfiler::end_boot_phase(const char *name)
+{
+    uint32_t now = micros();
+    uint32_t allocs = memory_alloc_count();
+    if (boot_phase_count < profiler_boot_phases)
+    {
+        boot_phase_name[boot_phase_count] = name;
+        boot_phase_us[boot_phase_count] = now - boot_mark_us;
+        boot_phase_allocs[boot_phase_count] = allocs - boot_mark_allocs;
+        boot_phase_count++;
+    }
+    boot_mark_us = now;
+    boot_mark_allocs = allocs;
+}
+
+/*!
+* @brief Function to display the duration and heap allocations of every boot
+*        phase in the terminal.
+*/
+void
+LoopProfiler::print_boot_report()
+{
+    uint32_t total_us = 0;
+    uint32_t total_allocs = 0;
+
+    Serial.println(F("BOOT PHASE  TIME(ms)   ALLOCS"));
+    Serial.println(F("-----------------------------"));
+    for (uint8_t i = 0; i < boot_phase_count; i++)
+    {
+        print_column(boot_phase_name[i], 12);
+        print_column(String(boot_phase_us[i] / 1000UL), 11);
+        Serial.println(boot_phase_allocs[i]);
+        total_us += boot_phase_us[i];
+        total_allocs += boot_phase_allocs[i];
+    }
+    print_column("total", 12);
+    print_column(String(total_us / 1000UL), 11);
+    Serial.println(total_allocs);
+}
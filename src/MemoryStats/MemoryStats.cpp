@@ -0,0 +1,367 @@
+#include "MemoryStats.hpp"
+#include "Database.hpp"
+
+#if defined(NATIVE_HAL)
+
+#include <HostHal.h>
+
+/*!
+* @brief Function to get the number of heap allocations since the boot.
+* @return The allocations String would have made on the board.
+*/
+uint32_t
+memory_alloc_count()
+{
+    return host::string_allocs();
+}
+
+#elif defined(MEMORY_ALLOC_COUNT)
+
+// Allocations counted by the wrappers, String reallocates to grow
+//
+static volatile uint32_t alloc_count = 0;
+
+extern "C"
+{
+
+void* __real_malloc(size_t size);
+void* __real_realloc(void *ptr, size_t size);
+
+/*!
+* @brief Wrapper of malloc, linked with -Wl,--wrap=malloc.
+*/
+void*
+__wrap_malloc(size_t size)
+{
+    alloc_count++;
+    return __real_malloc(size);
+}
+
+/*!
+* @brief Wrapper of realloc, linked with -Wl,--wrap=realloc.
+*/
+void*
+__wrap_realloc(void *ptr, size_t size)
+{
+    alloc_count++;
+    return __real_realloc(ptr, size);
+}
+
+}
+
+/*!
+* @brief Function to get the number of heap allocations since the boot.
+* @return The calls to malloc and realloc.
+*/
+uint32_t
+memory_alloc_count()
+{
+    noInterrupts();
+    uint32_t count = alloc_count;
+    interrupts();
+    return count;
+}
+
+#else
+
+/*!
+* @brief Function to get the number of heap allocations since the boot.
+* @return 0, the allocations are not counted.
+*/
+uint32_t
+memory_alloc_count()
+{
+    return 0;
+}
+
+#endif
+
+// Initialize the static instance
+//
+MemoryStats* MemoryStats::instance = nullptr;
+
+#if defined(__AVR__)
+
+// Layout of the RAM kept by avr-libc: the heap starts after the static data
+// and grows up to __brkval, the blocks freed below it are in the __flp list
+//
+extern char __heap_start;
+extern char *__brkval;
+extern size_t __malloc_margin;
+
+struct __freelist
+{
+    size_t sz;
+    struct __freelist *nx;
+};
+extern struct __freelist *__flp;
+
+// Value painted over the free RAM at boot
+//
+const uint8_t memory_paint = 0xC5;
+
+// Paint the RAM above the static data, from the .init3 section: the stack
+// pointer is set and nothing was pushed yet, the constructors run later
+//
+extern "C" void memory_paint_ram() __attribute__((naked, used, section(".init3")));
+
+void
+memory_paint_ram()
+{
+    for (uint8_t *p = (uint8_t *)&__heap_start; p <= (uint8_t *)RAMEND; p++)
+    {
+        *p = memory_paint;
+    }
+}
+
+/*!
+* @brief Function to get the top of the heap.
+* @return The first byte above the heap.
+*/
+static uint8_t*
+heap_top()
+{
+    return (uint8_t *)(__brkval != nullptr ? __brkval : &__heap_start);
+}
+
+/*!
+* @brief Function to tell if the RAM is measured on this build.
+* @return True on the board.
+*/
+bool
+MemoryStats::is_measured()
+{
+    return true;
+}
+
+/*!
+* @brief Function to get the free RAM, the gap between the heap and the
+*        stack and the blocks of the heap free list.
+* @return The free bytes.
+*/
+uint16_t
+MemoryStats::free_ram()
+{
+    uint8_t top;
+    uint16_t free = &top - heap_top();
+    for (struct __freelist *block = __flp; block != nullptr; block = block->nx)
+    {
+        free += block->sz;
+    }
+    return free;
+}
+
+/*!
+* @brief Function to get the largest block malloc would hand out, from the
+*        free list or from the gap, which keeps __malloc_margin bytes free
+*        for the stack.
+* @return The size of the block.
+*/
+uint16_t
+MemoryStats::largest_block()
+{
+    uint8_t top;
+    uint16_t gap = &top - heap_top();
+    uint16_t largest = (gap > __malloc_margin + sizeof(size_t)) ? gap - __malloc_margin - sizeof(size_t) : 0;
+    for (struct __freelist *block = __flp; block != nullptr; block = block->nx)
+    {
+        if (block->sz > largest)
+        {
+            largest = block->sz;
+        }
+    }
+    return largest;
+}
+
+/*!
+* @brief Function to get the stack headroom, the longest run of paint left
+*        between the heap and the stack. Blocks freed at the top of the heap
+*        leave short runs behind them, the longest one is the RAM neither
+*        the heap nor the stack ever reached.
+* @return The bytes never used.
+*/
+uint16_t
+MemoryStats::stack_headroom()
+{
+    uint8_t top;
+    uint16_t longest = 0;
+    uint16_t run = 0;
+    for (uint8_t *p = heap_top(); p < &top; p++)
+    {
+        if (*p != memory_paint)
+        {
+            run = 0;
+        }
+        else if (++run > longest)
+        {
+            longest = run;
+        }
+    }
+    return longest;
+}
+
+#else
+
+/*!
+* @brief Function to tell if the RAM is measured on this build.
+* @return False, the host RAM says nothing about the board.
+*/
+bool
+MemoryStats::is_measured()
+{
+    return false;
+}
+
+/*!
+* @brief Function to get the free RAM.
+* @return 0, not measured.
+*/
+uint16_t
+MemoryStats::free_ram()
+{
+    return 0;
+}
+
+/*!
+* @brief Function to get the largest block malloc would hand out.
+* @return 0, not measured.
+*/
+uint16_t
+MemoryStats::largest_block()
+{
+    return 0;
+}
+
+/*!
+* @brief Function to get the stack headroom.
+* @return 0, not measured.
+*/
+uint16_t
+MemoryStats::stack_headroom()
+{
+    return 0;
+}
+
+#endif
+
+/*!
+* @brief Constructor.
+*/
+MemoryStats::MemoryStats()
+    : last_free_ram(0), last_largest_block(0), min_headroom(0xFFFF), alarms(0), is_alarmed(false)
+{
+    reset_stats();
+}
+
+/*!
+* @brief Function to get the Singleton Instance.
+* @return The memory stats instance.
+*/
+MemoryStats*
+MemoryStats::get_instance()
+{
+    if (instance == nullptr)
+    {
+        instance = new MemoryStats();
+    }
+    return instance;
+}
+
+/*!
+* @brief Function to sample the free RAM, keep the lowest values and log an
+*        alarm when the RAM runs low.
+*/
+void
+MemoryStats::sample()
+{
+    if (!is_measured())
+    {
+        return;
+    }
+
+    last_free_ram = free_ram();
+    last_largest_block = largest_block();
+    uint16_t headroom = stack_headroom();
+
+    min_free_ram = min(min_free_ram, last_free_ram);
+    min_largest_block = min(min_largest_block, last_largest_block);
+    min_headroom = min(min_headroom, headroom);
+    samples++;
+
+    check_alarm();
+}
+
+/*!
+* @brief Function to log an alarm to the SD card once the free RAM or the
+*        stack headroom falls below memory_alarm_bytes. Another one is only
+*        logged after the free RAM recovered, the headroom never does.
+*/
+void
+MemoryStats::check_alarm()
+{
+    bool is_low = last_free_ram < memory_alarm_bytes || min_headroom < memory_alarm_bytes;
+
+    if (is_alarmed)
+    {
+        if (!is_low && last_free_ram >= memory_alarm_bytes + memory_alarm_hysteresis)
+        {
+            is_alarmed = false;
+        }
+        return;
+    }
+
+    if (is_low)
+    {
+        char text[80];
+        snprintf(text, sizeof(text), "Low memory: free %u, largest block %u, stack headroom %u",
+                 last_free_ram, last_largest_block, min_headroom);
+        Database::get_instance()->log_memory_alarm(text);
+        alarms++;
+        is_alarmed = true;
+    }
+}
+
+/*!
+* @brief Function to clear the lowest free RAM and largest block.
+*/
+void
+MemoryStats::reset_stats()
+{
+    samples = 0;
+    min_free_ram = 0xFFFF;
+    min_largest_block = 0xFFFF;
+}
+
+/*!
+* @brief Function to display the current and lowest free RAM, largest block
+*        and stack headroom in the terminal.
+*/
+void
+MemoryStats::print_stats()
+{
+    Serial.print(F("Heap allocations: "));
+    Serial.println(memory_alloc_count());
+
+    if (!is_measured())
+    {
+        Serial.println(F("Memory: not measured on this build"));
+        return;
+    }
+
+    sample();
+
+    Serial.print(F("Memory: free "));
+    Serial.print(last_free_ram);
+    Serial.print(F(" (min "));
+    Serial.print(min_free_ram);
+    Serial.print(F("), largest block "));
+    Serial.print(last_largest_block);
+    Serial.print(F(" (min "));
+    Serial.print(min_largest_block);
+    Serial.print(F("), stack headroom "));
+    Serial.print(min_headroom);
+    Serial.print(F(", samples "));
+    Serial.print(samples);
+    Serial.print(F(", alarms "));
+    Serial.println(alarms);
+}
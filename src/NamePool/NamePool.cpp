@@ -0,0 +1,294 @@
+#include "NamePool.hpp"
+
+// Initialize the static instance
+//
+NamePool* NamePool::instance = nullptr;
+
+/*!
+* @brief Constructor.
+*/
+NamePool::NamePool() : used(0), freed(0)
+{
+    for (uint8_t i = 0; i < name_pool_slots; i++)
+    {
+        offsets[i] = name_pool_none;
+    }
+    reset_stats();
+}
+
+/*!
+* @brief Function to get the Singleton Instance.
+* @return The name pool instance.
+*/
+NamePool*
+NamePool::get_instance()
+{
+    if (instance == nullptr)
+    {
+        instance = new NamePool();
+    }
+    return instance;
+}
+
+/*!
+* @brief Function to store a text once. An equal text already held gains a
+*        reference, otherwise the text is appended to the arena, after a
+*        compaction when it only fits without the freed texts.
+* @param[in] text const char * of the text.
+* @return The handle of the text, name_pool_none when the pool is full.
+*/
+uint16_t
+NamePool::intern(const char *text)
+{
+    uint8_t free_slot = name_pool_slots;
+    for (uint8_t i = 0; i < name_pool_slots; i++)
+    {
+        if (offsets[i] == name_pool_none)
+        {
+            if (free_slot == name_pool_slots)
+            {
+                free_slot = i;
+            }
+        }
+        else if (strcmp(&arena[offsets[i] + 2], text) == 0)
+        {
+            retain(i);
+            shared++;
+            return i;
+        }
+    }
+
+    size_t length = strlen(text);
+    size_t size = length + 3;
+    if (free_slot == name_pool_slots || length > 255)
+    {
+        failures++;
+        return name_pool_none;
+    }
+
+    if (used + size > name_pool_size && freed > 0)
+    {
+        compact();
+    }
+    if (used + size > name_pool_size)
+    {
+        failures++;
+        return name_pool_none;
+    }
+
+    arena[used] = 1;
+    arena[used + 1] = free_slot;
+    memcpy(&arena[used + 2], text, length + 1);
+    offsets[free_slot] = used;
+    used += size;
+    return free_slot;
+}
+
+/*!
+* @brief Function to add a reference to a text, the count stops at 255 and
+*        the text is then kept.
+* @param[in] handle uint16_t of the text.
+*/
+void
+NamePool::retain(uint16_t handle)
+{
+    if (handle >= name_pool_slots || offsets[handle] == name_pool_none)
+    {
+        return;
+    }
+
+    uint8_t &references = (uint8_t &)arena[offsets[handle]];
+    if (references < 255)
+    {
+        references++;
+    }
+}
+
+/*!
+* @brief Function to drop a reference to a text, freeing it with the last
+*        one. Its bytes are recovered by the next compaction.
+* @param[in] handle uint16_t of the text.
+*/
+void
+NamePool::release(uint16_t handle)
+{
+    if (handle >= name_pool_slots || offsets[handle] == name_pool_none)
+    {
+        return;
+    }
+
+    uint16_t offset = offsets[handle];
+    uint8_t &references = (uint8_t &)arena[offset];
+    if (references == 255 || --references > 0)
+    {
+        return;
+    }
+
+    freed += strlen(&arena[offset + 2]) + 3;
+    offsets[handle] = name_pool_none;
+}
+
+/*!
+* @brief Function to get the text of a handle.
+* @param[in] handle uint16_t of the text.
+* @return The text, empty for name_pool_none.
+*/
+const char*
+NamePool::get(uint16_t handle) const
+{
+    if (handle >= name_pool_slots || offsets[handle] == name_pool_none)
+    {
+        return "";
+    }
+    return &arena[offsets[handle] + 2];
+}
+
+/*!
+* @brief Function to move the held texts to the start of the arena, in their
+*        order, and point their slots to their new offsets.
+*/
+void
+NamePool::compact()
+{
+    if (freed == 0)
+    {
+        return;
+    }
+
+    uint16_t to = 0;
+    uint16_t from = 0;
+    while (from < used)
+    {
+        uint16_t size = strlen(&arena[from + 2]) + 3;
+        if (arena[from] != 0)
+        {
+            memmove(&arena[to], &arena[from], size);
+            offsets[(uint8_t)arena[to + 1]] = to;
+            to += size;
+        }
+        from += size;
+    }
+
+    used = to;
+    freed = 0;
+    compactions++;
+}
+
+/*!
+* @brief Function to clear the pool counters.
+*/
+void
+NamePool::reset_stats()
+{
+    shared = 0;
+    compactions = 0;
+    failures = 0;
+}
+
+/*!
+* @brief Function to display the use of the pool in the terminal, and the RAM
+*        it takes against one String per reference.
+*/
+void
+NamePool::print_stats()
+{
+    uint8_t names = 0;
+    uint32_t references = 0;
+    uint32_t as_strings = 0;
+    for (uint8_t i = 0; i < name_pool_slots; i++)
+    {
+        if (offsets[i] != name_pool_none)
+        {
+            uint8_t count = (uint8_t)arena[offsets[i]];
+            names++;
+            references += count;
+            as_strings += (uint32_t)count * (strlen(&arena[offsets[i] + 2]) + 1 + name_string_overhead);
+        }
+    }
+
+    Serial.print(F("Name pool: "));
+    Serial.print(names);
+    Serial.print(F(" names, "));
+    Serial.print(references);
+    Serial.print(F(" references, "));
+    Serial.print(used - freed);
+    Serial.print(F(" of "));
+    Serial.print(name_pool_size);
+    Serial.print(F(" bytes, "));
+    Serial.print(freed);
+    Serial.print(F(" freed, shared "));
+    Serial.print(shared);
+    Serial.print(F(", compactions "));
+    Serial.print(compactions);
+    Serial.print(F(", full "));
+    Serial.println(failures);
+
+    // Texts held and the handles referring to them, besides the fixed arena
+    // and slot table
+    //
+    uint32_t in_pool = (used - freed) + references * sizeof(uint16_t);
+    Serial.print(F("Name pool memory: "));
+    Serial.print(in_pool);
+    Serial.print(F(" bytes of names and handles, "));
+    Serial.print(as_strings);
+    Serial.println(F(" bytes as Strings"));
+}
+
+/*!
+* @brief Copy constructor, the text gains a reference.
+* @param[in] other const PooledName& copied.
+*/
+PooledName::PooledName(const PooledName &other) : handle(other.handle)
+{
+    NamePool::get_instance()->retain(handle);
+}
+
+/*!
+* @brief Assignment, the text of other gains a reference before the one
+*        held loses its own.
+* @param[in] other const PooledName& copied.
+* @return This name.
+*/
+PooledName&
+PooledName::operator=(const PooledName &other)
+{
+    NamePool *pool = NamePool::get_instance();
+    pool->retain(other.handle);
+    pool->release(handle);
+    handle = other.handle;
+    return *this;
+}
+
+/*!
+* @brief Destructor, the text loses its reference.
+*/
+PooledName::~PooledName()
+{
+    NamePool::get_instance()->release(handle);
+}
+
+/*!
+* @brief Function to set the text, the previous one losing its reference.
+*        An empty text takes no room in the pool.
+* @param[in] text const char * of the text.
+* @return The status if the text is held, false when the pool is full.
+*/
+bool
+PooledName::set(const char *text)
+{
+    NamePool *pool = NamePool::get_instance();
+    uint16_t previous = handle;
+    handle = (text[0] == '\0') ? name_pool_none : pool->intern(text);
+    pool->release(previous);
+    return handle != name_pool_none || text[0] == '\0';
+}
+
+/*!
+* @brief Function to get the text.
+* @return The text, empty when not set.
+*/
+const char*
+PooledName::c_str() const
+{
+    return NamePool::get_instance()->get(handle);
+}
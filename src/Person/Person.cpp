@@ -4,12 +4,12 @@
 /*!
 * @brief Function to set the name of the person.
 * @param[in] person_name const String& of person name.
-* @return The status if admin authenticated or not.
+* @return The status if the name is held, false when the name pool is full.
 */
-void 
+bool 
 Person::set_name(const String& person_name) 
 {
-    name = person_name;
+    return name.set(person_name.c_str());
 }
 
 
@@ -20,5 +20,5 @@ Person::set_name(const String& person_name)
 String 
 Person::get_name() const 
 {
-    return name;
+    return String(name.c_str());
 }
@@ -1,4 +1,5 @@
 #include "RFIDreader.hpp"
+#include "AuthenticationService.hpp"
 
 // Initialize the static instance pointer
 //
@@ -8,6 +9,41 @@ RFIDreader *RFIDreader::instance = nullptr;
 //
 bool RFIDreader::is_scan_card = false;
 
+// Initialize the pending card flag set by the IRQ
+//
+volatile bool RFIDreader::is_card_pending = false;
+
+// Receive interrupt enable with the IRQ pin active low (IRqInv | RxIEn)
+//
+static const byte rfid_irq_enable = 0xA0;
+
+// Clear all interrupt request bits, releasing the IRQ line
+//
+static const byte rfid_irq_clear = 0x7F;
+
+// Flush the FIFO, bytes left by an unanswered REQA are not sent again
+//
+static const byte rfid_fifo_flush = 0x80;
+
+// Start the transmission of the FIFO, 7 bits for the short REQA frame
+//
+static const byte rfid_start_send_short_frame = 0x87;
+
+/*!
+* @brief Function to print a text padded with spaces to a column width.
+* @param[in] text const String& to print.
+* @param[in] width uint8_t of the column width.
+*/
+static void
+print_column(const String &text, uint8_t width)
+{
+    Serial.print(text);
+    for (uint8_t j = text.length(); j < width; j++)
+    {
+        Serial.print(F(" "));
+    }
+}
+
 // Set up RFID reader (define SS_PIN and RST_PIN elsewhere)
 //
 MFRC522 RFIDreader::mfrc522(SS_PIN, RST_PIN);
@@ -20,13 +56,17 @@ MFRC522::MIFARE_Key RFIDreader::key;
 /*!
 * @brief Private constructor.
 */
-RFIDreader::RFIDreader() : rfid_tag("") 
+RFIDreader::RFIDreader() : detect_mode(DETECT_POLLING), uid_cache(nullptr), request_at_ms(0),
+                           encode_status(ENCODE_IDLE), encode_empid(0), encode_uid_size(0),
+                           queue_size(0), queue_next(0)
 {
+    memset(&current_card, 0, sizeof(current_card));
     SPI.begin();         // Initialize SPI
     mfrc522.PCD_Init();  // Initialize RFID module
     for (byte i = 0; i < 6; i++) {
         key.keyByte[i] = 0xFF; // Default key
     }
+    reset_stats();
 }
 
 
@@ -67,12 +107,13 @@ RFIDreader::release_instance()
 }
 
 /*!
-* @brief Function to Set the RFID tag.
+* @brief Function to Set the RFID tag, the key of the scanned card.
 */
 void 
 RFIDreader::set_tag(const char *tag) 
 {
-    rfid_tag = String(tag);
+    strncpy(current_card.key, tag, card_key_size - 1);
+    current_card.key[card_key_size - 1] = '\0';
 }
 
 /*!
@@ -82,7 +123,7 @@ RFIDreader::set_tag(const char *tag)
 const char *
 RFIDreader::get_tag() 
 {
-    return rfid_tag.c_str();
+    return current_card.key;
 }
 
 /*!
@@ -91,7 +132,7 @@ RFIDreader::get_tag()
 void 
 RFIDreader::remove_tag()
 {
-    rfid_tag="";
+    current_card.key[0] = '\0';
 }
 
 /*!
@@ -129,7 +170,7 @@ RFIDreader::scan_card()
 
     rfid_uid.toUpperCase();  // Convert UID to uppercase (optional)
     rfid_uid.trim();
-    rfid_tag = rfid_uid;  // Assigining rfid value
+    set_tag(rfid_uid.c_str());  // Assigining rfid value
 
     // Halt the PICC so that it can be read again later
     //
@@ -139,189 +180,669 @@ RFIDreader::scan_card()
 }
 
 /*!
-* @brief Function to set the current date.
-* @param[in] curr_date String& of current date.
+* @brief Function to set the time of the decision of the scanned card.
+* @param[in] epoch uint32_t unix time.
 */
 void 
-RFIDreader::set_current_date(String& curr_date)
+RFIDreader::set_scan_time(uint32_t epoch)
 {
-    current_date = curr_date;
+    current_card.epoch = epoch;
 }
 
 /*!
-* @brief Function to set the current time.
-* @param[in] curr_time String& of current time.
+* @brief Function to get the scanned card.
+* @return The scan record of the card being decided.
+*/
+const ScanRecord& 
+RFIDreader::get_scan()
+{
+    return current_card;
+}
+
+/*!
+* @brief Function to read one block of the authenticated sector.
+* @param[in] blockAddr byte of the block.
+* @param[out] buffer byte[18] receiving the 16 data bytes and their CRC_A.
+* @return The status if the block was read.
+*/
+bool 
+RFIDreader::read_block(byte blockAddr, byte *buffer) 
+{
+    byte size = 18;
+    
+    MFRC522::StatusCode status;
+    status = (MFRC522::StatusCode)mfrc522.MIFARE_Read(blockAddr, buffer, &size);
+    if (status != MFRC522::STATUS_OK) 
+    {
+        Serial.print(F("MIFARE_Read() failed: "));
+        Serial.println(mfrc522.GetStatusCodeName(status));
+        return false;
+    } 
+    return true;
+}
+
+/*!
+* @brief Function to get the text of a version 1 block, the name or the employee ID.
+* @param[in] buffer const byte * of the 16 bytes of the block.
+* @param[out] text char[17] receiving the text, without padding.
 */
 void 
-RFIDreader::set_current_time(String& curr_time)
+RFIDreader::block_text(const byte *buffer, char *text) 
 {
-    current_time = curr_time;
+    byte length = 0;
+    for (byte i = 0; i < 16; i++) 
+    {
+        if (buffer[i] != 0) 
+        {
+            text[length++] = (char)buffer[i];
+        }
+    }
+
+    // Trimmed like String::trim()
+    //
+    while (length > 0 && isspace(text[length - 1]))
+    {
+        length--;
+    }
+    text[length] = '\0';
+
+    byte start = 0;
+    while (isspace(text[start]))
+    {
+        start++;
+    }
+    memmove(text, text + start, length - start + 1);
+}
+
+/*!
+* @brief Function to select how cards are detected.
+* @param[in] mode DetectMode to use.
+* @return The status if the mode is in use, IRQ mode needs an external interrupt on IRQ_PIN.
+*/
+bool 
+RFIDreader::set_detect_mode(DetectMode mode)
+{
+    int irq_num = digitalPinToInterrupt(IRQ_PIN);
+
+    if (mode == DETECT_IRQ && irq_num != NOT_AN_INTERRUPT)
+    {
+        pinMode(IRQ_PIN, INPUT_PULLUP);
+        attachInterrupt(irq_num, card_irq_isr, FALLING);
+        mfrc522.PCD_WriteRegister(MFRC522::ComIEnReg, rfid_irq_enable);
+        detect_mode = DETECT_IRQ;
+        arm_card_irq();
+        return true;
+    }
+
+    // Polling fallback
+    //
+    if (irq_num != NOT_AN_INTERRUPT)
+    {
+        detachInterrupt(irq_num);
+    }
+    mfrc522.PCD_WriteRegister(MFRC522::ComIEnReg, 0x00);
+    detect_mode = DETECT_POLLING;
+    return mode == DETECT_POLLING;
 }
 
 /*!
-* @brief Function to Get the current date.
-* @return The string representing the current date.
+* @brief Function to get the card detection mode.
+* @return The detection mode in use.
 */
-String& 
-RFIDreader::get_current_date()
+RFIDreader::DetectMode 
+RFIDreader::get_detect_mode()
 {
-    return current_date;
+    return detect_mode;
 }
 
 /*!
-* @brief Function to Get the current time.
-* @return The string representing the current time.
+* @brief Function to set the UID cache consulted before reading a card.
+* @param[in] cache AuthenticationService * holding the cache, nullptr to always read.
 */
-String& 
-RFIDreader::get_current_time()
+void 
+RFIDreader::set_uid_cache(AuthenticationService *cache)
 {
-    return current_time;
+    uid_cache = cache;
 }
 
 /*!
-* @brief Function to read name from a specified block.
-* @return The string representing the name.
+* @brief Function to get the UID of the last card read.
+* @return The UID bytes.
 */
-String 
-RFIDreader::readName(byte blockAddr) 
+const byte* 
+RFIDreader::get_uid()
 {
-    byte buffer[18];
-    byte size = sizeof(buffer);
-    String name = "";
-    
-    MFRC522::StatusCode status;
-    status = (MFRC522::StatusCode)mfrc522.MIFARE_Read(blockAddr, buffer, &size);
-    if (status != MFRC522::STATUS_OK) 
+    return current_card.uid;
+}
+
+/*!
+* @brief Function to get the size of the UID of the last card read.
+* @return The size of the UID.
+*/
+byte 
+RFIDreader::get_uid_size()
+{
+    return current_card.uid_size;
+}
+
+/*!
+* @brief Function to add the duration of one scan stage to its statistics.
+* @param[in] stage ScanStage measured.
+* @param[in] elapsed_us uint32_t duration of the stage.
+*/
+void 
+RFIDreader::record_stage(ScanStage stage, uint32_t elapsed_us)
+{
+    StageStats &s = stage_stats[stage];
+    s.count++;
+    s.total_us += elapsed_us;
+    if (elapsed_us > s.max_us)
     {
-        Serial.print(F("MIFARE_Read() failed: "));
-        Serial.println(mfrc522.GetStatusCodeName(status));
-        return "";
-    } 
-    else 
+        s.max_us = elapsed_us;
+    }
+}
+
+/*!
+* @brief Function to count the heap allocations made by one scan, which
+*        carries its text in fixed arrays and should make none.
+* @param[in] allocs uint32_t allocations counted around the scan.
+*/
+void 
+RFIDreader::record_allocs(uint32_t allocs)
+{
+    scan_allocs += allocs;
+}
+
+/*!
+* @brief Function to clear the scan stage statistics.
+*/
+void 
+RFIDreader::reset_stats()
+{
+    memset(stage_stats, 0, sizeof(stage_stats));
+    cached_scans = 0;
+    read_scans = 0;
+    v2_scans = 0;
+    queued_scans = 0;
+    scan_allocs = 0;
+}
+
+/*!
+* @brief Function to get the name of a scan stage.
+* @param[in] stage ScanStage to name.
+* @return The stage name.
+*/
+const char* 
+RFIDreader::stage_name(ScanStage stage)
+{
+    switch (stage)
     {
-        for (byte i = 0; i < 16; i++) 
-        {
-            if (buffer[i] != 0) 
-            {
-                name += (char)buffer[i];
-            }
-        }
+        case STAGE_SELECT:  return "select";
+        case STAGE_RESOLVE: return "resolve";
+        case STAGE_AUTH:    return "auth";
+        case STAGE_READ:    return "read";
+        case STAGE_DECIDE:  return "decide";
+        default:            return "?";
     }
-    
-    String trimmedName = name;   // Create a new String for the trimmed value
-    trimmedName.trim();          // Trim the name
-    return trimmedName;          // Return trimmed name
 }
 
 /*!
-* @brief Function to read employee ID from a specified block.
-* @return The string representing the employee ID.
+* @brief Function to display the time spent in every scan stage, and the
+*        time the UID cache saved, in the terminal.
 */
-String 
-RFIDreader::readEmpID(byte blockAddr) 
+void 
+RFIDreader::print_stats()
 {
-    byte buffer[18];
-    byte size = sizeof(buffer);
-    String empid = "";
-    
-    MFRC522::StatusCode status;
-    status = (MFRC522::StatusCode)mfrc522.MIFARE_Read(blockAddr, buffer, &size);
-    if (status != MFRC522::STATUS_OK) 
+    Serial.println(F("SCAN STAGE  COUNT      AVG(us)    MAX(us)"));
+    Serial.println(F("-----------------------------------------"));
+
+    for (uint8_t i = 0; i < STAGE_COUNT; i++)
     {
-        Serial.print(F("MIFARE_Read() failed: "));
-        Serial.println(mfrc522.GetStatusCodeName(status));
-        return "";
-    } 
-    else 
+        const StageStats &s = stage_stats[i];
+        uint32_t avg_us = (s.count > 0) ? s.total_us / s.count : 0;
+
+        print_column(stage_name((ScanStage)i), 12);
+        print_column(String(s.count), 11);
+        print_column(String(avg_us), 11);
+        Serial.println(s.max_us);
+    }
+
+    // A cached scan skips the authentication and the reads of a read one
+    //
+    const StageStats &auth = stage_stats[STAGE_AUTH];
+    const StageStats &read = stage_stats[STAGE_READ];
+    uint32_t skipped_us = ((auth.count > 0) ? auth.total_us / auth.count : 0) +
+                          ((read.count > 0) ? read.total_us / read.count : 0);
+
+    Serial.print(F("Scans: "));
+    Serial.print(cached_scans);
+    Serial.print(F(" from the UID, "));
+    Serial.print(read_scans);
+    Serial.print(F(" read ("));
+    Serial.print(v2_scans);
+    Serial.print(F(" version 2), "));
+    Serial.print(skipped_us);
+    Serial.println(F(" us saved per scan from the UID"));
+
+    Serial.print(F("Cards read with another one in the field: "));
+    Serial.println(queued_scans);
+    Serial.print(F("Heap allocations on the scan path: "));
+    Serial.println(scan_allocs);
+}
+
+/*!
+* @brief ISR of the reader IRQ line, a card answered the armed REQA.
+*/
+void 
+RFIDreader::card_irq_isr()
+{
+    is_card_pending = true;
+}
+
+/*!
+* @brief Function to release the IRQ line and send a REQA, a card which
+*        answers raises the receive interrupt. Four register writes,
+*        without waiting for the answer over SPI.
+*/
+void 
+RFIDreader::arm_card_irq()
+{
+    mfrc522.PCD_WriteRegister(MFRC522::ComIrqReg, rfid_irq_clear);
+    mfrc522.PCD_WriteRegister(MFRC522::FIFOLevelReg, rfid_fifo_flush);
+    mfrc522.PCD_WriteRegister(MFRC522::FIFODataReg, MFRC522::PICC_CMD_REQA);
+    mfrc522.PCD_WriteRegister(MFRC522::CommandReg, MFRC522::PCD_Transceive);
+    mfrc522.PCD_WriteRegister(MFRC522::BitFramingReg, rfid_start_send_short_frame);
+}
+
+/*!
+* @brief  Function to handle card reading, the key embedded inside the card
+*         becomes the tag.
+* @return The status if a card was scanned.
+*/
+bool 
+RFIDreader::handleCardRead() 
+{
+    if (detect_mode == DETECT_IRQ)
     {
-        for (byte i = 0; i < 16; i++) 
+        // Nobody answered yet, send the next REQA when it is due and wait
+        // for the IRQ, checking the flag costs no SPI traffic
+        //
+        if (!is_card_pending)
         {
-            if (buffer[i] != 0) 
+            if (millis() - request_at_ms >= rfid_detect_period_ms)
             {
-                empid += (char)buffer[i];
+                request_at_ms = millis();
+                arm_card_irq();
             }
+            return false;
+        }
+        is_card_pending = false;
+    }
+    else
+    {
+        if (millis() - request_at_ms < rfid_detect_period_ms)
+        {
+            return false;
+        }
+        request_at_ms = millis();
+
+        // Reset the loop if no new card present on the sensor/reader.
+        //
+        if (!mfrc522.PICC_IsNewCardPresent()) return false;
+    }
+
+    // Read every card in the field, each one is halted once read so the
+    // next REQA only wakes those left. Several badges presented together
+    // are queued and handed out one by one
+    //
+    for (uint8_t i = 0; i < rfid_card_queue_size; i++)
+    {
+        if (i > 0 && !mfrc522.PICC_IsNewCardPresent())
+        {
+            break;
+        }
+        if (!read_card())
+        {
+            break;
         }
     }
 
-    String trimmedEmpID = empid;   // Create a new String for the trimmed value
-    trimmedEmpID.trim();           // Trim the empid
-    return trimmedEmpID;           // Return trimmed empid
+    // The answers during these transactions raised the IRQ as well
+    //
+    is_card_pending = false;
+    if (queue_size > 1)
+    {
+        queued_scans += queue_size - 1;
+    }
+
+    return next_queued_card();
 }
 
 /*!
-* @brief  Function to handle card reading.
-* @return The string representing scanned key embedded inside the card.
+* @brief Function to select one of the cards in the field and queue its key,
+*        from the UID cache or read from the card.
+* @return The status if a card was selected, a card being encoded stops the
+*         reading of the field.
 */
-String 
-RFIDreader::handleCardRead() 
+bool 
+RFIDreader::read_card()
 {
-    // Reset the loop if no new card present on the sensor/reader.
-    //
-    if (!mfrc522.PICC_IsNewCardPresent()) return "";
-
     // Select one of the cards
     //
-    if (!mfrc522.PICC_ReadCardSerial()) return "";
+    uint32_t stage_us = micros();
+    if (!mfrc522.PICC_ReadCardSerial()) return false;
 
     MFRC522::PICC_Type piccType = mfrc522.PICC_GetType(mfrc522.uid.sak);
+    record_stage(STAGE_SELECT, micros() - stage_us);
     
     if (piccType != MFRC522::PICC_TYPE_MIFARE_1K &&
         piccType != MFRC522::PICC_TYPE_MIFARE_4K) 
     {
         Serial.println(F("This sample only works with MIFARE Classic cards."));
-        return "";
+        return true;
+    }
+
+    // A card waiting to be encoded is written, not read
+    //
+    if (encode_status == ENCODE_PENDING)
+    {
+        write_card();
+        return false;
+    }
+
+    // A card seen recently is answered from the UID cache, without the
+    // authentication and the reads of blocks 8 and 9
+    //
+    if (uid_cache != nullptr)
+    {
+        char cached[card_key_size];
+        stage_us = micros();
+        bool is_cached = uid_cache->find_card(mfrc522.uid.uidByte, mfrc522.uid.size, cached);
+        record_stage(STAGE_RESOLVE, micros() - stage_us);
+
+        if (is_cached)
+        {
+            cached_scans++;
+            queue_card(cached);
+            mfrc522.PICC_HaltA();
+            return true;
+        }
     }
 
     // Authenticate using key A for sector 2
     //
-    byte trailerBlock = 11;        // Trailer block of sector 2
+    byte trailerBlock = card_trailer_block;
     MFRC522::StatusCode status;
+    stage_us = micros();
     status = (MFRC522::StatusCode)mfrc522.PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, trailerBlock, &key, &(mfrc522.uid));
+    record_stage(STAGE_AUTH, micros() - stage_us);
     if (status != MFRC522::STATUS_OK) 
     {
         Serial.print(F("PCD_Authenticate() failed: "));
         Serial.println(mfrc522.GetStatusCodeName(status));
-        return "";
+        return true;
     }
 
     
-    // Read name from block 8 and employee ID from block 9
+    // Block 8 holds the whole key on a version 2 card. A version 1 card
+    // holds the name there and the employee ID in block 9
     //
-    String name = readName(8);
-    String empid = readEmpID(9);
+    stage_us = micros();
+    byte buffer[18];
+    char result[card_key_size] = "";
+    if (read_block(card_data_block, buffer))
+    {
+        CardBlock block;
+        memcpy(&block, buffer, sizeof(block));
+        if (card_check_block(block))
+        {
+            card_block_key(block, result);
+            v2_scans++;
+        }
+        else
+        {
+            char name[17];
+            char empid[17] = "";
+            block_text(buffer, name);
+            if (read_block(card_empid_block, buffer))
+            {
+                block_text(buffer, empid);
+            }
+            if (name[0] != '\0' && empid[0] != '\0') 
+            {
+                snprintf(result, sizeof(result), "%s,%s", name, empid); // Concatenate name and empid
+            }
+        }
+    }
+    record_stage(STAGE_READ, micros() - stage_us);
+    read_scans++;
 
-    is_scan_card=true;
-    // Check if name and empid are not empty
+    // A card missing the name or the employee ID is queued empty, it is denied
     //
-    if (name != "" && empid != "") 
+    queue_card(result);
+
+    // Halt PICC and stop encryption on PCD
+    //
+    mfrc522.PICC_HaltA();
+    mfrc522.PCD_StopCrypto1();
+    return true;
+}
+
+/*!
+* @brief Function to add the selected card to the queue of the cards read.
+* @param[in] card_key const char * of the key read, empty when unreadable.
+*/
+void 
+RFIDreader::queue_card(const char *card_key)
+{
+    if (queue_size >= rfid_card_queue_size)
     {
-        String result = name + "," + empid; // Concatenate name and empid
-        // Halt PICC
-        //
-        result.trim();
-        
-        set_tag(result.c_str());
-        
-        mfrc522.PICC_HaltA();
-        
-        // Stop encryption on PCD
-        //
-        mfrc522.PCD_StopCrypto1();
-        return result; // Return the result
-    } 
-    else 
+        return;
+    }
+
+    ScanRecord &card = card_queue[queue_size++];
+    card.uid_size = mfrc522.uid.size;
+    memcpy(card.uid, mfrc522.uid.uidByte, sizeof(card.uid));
+    strncpy(card.key, card_key, card_key_size - 1);
+    card.key[card_key_size - 1] = '\0';
+    card.epoch = 0;
+}
+
+/*!
+* @brief Function to hand out the next card of the queue, it becomes the
+*        scanned card: its key is the tag and its UID the one of get_uid().
+* @return The status if a card was waiting in the queue.
+*/
+bool 
+RFIDreader::next_queued_card()
+{
+    if (queue_next >= queue_size)
+    {
+        queue_next = 0;
+        queue_size = 0;
+        return false;
+    }
+
+    current_card = card_queue[queue_next++];
+    is_scan_card = true;
+    return true;
+}
+
+/*!
+* @brief Function to check the selected and authenticated card may be
+*        written for the user waiting to be encoded: its block 8 is blank,
+*        or the card already holds the same employee id, in either format.
+* @return The status if the card may be written, false when it cannot be read.
+*/
+bool 
+RFIDreader::is_card_writable()
+{
+    byte buffer[18];
+    if (!read_block(card_data_block, buffer))
+    {
+        return false;
+    }
+
+    bool is_blank = true;
+    for (byte i = 0; i < 16; i++)
+    {
+        if (buffer[i] != 0)
+        {
+            is_blank = false;
+        }
+    }
+    if (is_blank)
+    {
+        return true;
+    }
+
+    CardBlock block;
+    memcpy(&block, buffer, sizeof(block));
+    if (card_check_block(block))
+    {
+        return block.empid == encode_empid;
+    }
+
+    // Version 1, the employee id is the text of block 9
+    //
+    char empid[17];
+    if (!read_block(card_empid_block, buffer))
+    {
+        return false;
+    }
+    block_text(buffer, empid);
+
+    char *end;
+    unsigned long id = strtoul(empid, &end, 10);
+    return empid[0] != '\0' && *end == '\0' && id == encode_empid;
+}
+
+/*!
+* @brief Function to write the user waiting to be encoded on the selected
+*        card, in the version 2 format when the name fits in it, and to
+*        verify the blocks by reading them back.
+*/
+void 
+RFIDreader::write_card()
+{
+    byte data[16];
+    byte empid_data[16];
+    memset(data, 0, sizeof(data));
+    memset(empid_data, 0, sizeof(empid_data));
+
+    // Version 2 leaves block 9 empty, version 1 holds the text of both
+    //
+    CardBlock block;
+    bool is_v2 = card_make_block(block, encode_name.c_str(), encode_empid);
+    if (is_v2)
+    {
+        memcpy(data, &block, sizeof(block));
+    }
+    else
+    {
+        String empid(encode_empid);
+        memcpy(data, encode_name.c_str(), min((unsigned int)encode_name.length(), (unsigned int)sizeof(data)));
+        memcpy(empid_data, empid.c_str(), empid.length());
+    }
+
+    encode_uid_size = min(mfrc522.uid.size, (byte)sizeof(encode_uid));
+    memcpy(encode_uid, mfrc522.uid.uidByte, encode_uid_size);
+
+    MFRC522::StatusCode status;
+    status = (MFRC522::StatusCode)mfrc522.PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, card_trailer_block, &key, &(mfrc522.uid));
+    bool is_written = status == MFRC522::STATUS_OK;
+
+    // The badge of anybody else who walks by is left untouched
+    //
+    if (is_written && !is_card_writable())
     {
-        // Halt PICC if data is missing
-        //
         mfrc522.PICC_HaltA();
-        
-        // Stop encryption on PCD
-        //
-        
         mfrc522.PCD_StopCrypto1();
-        
-        return ""; // Return empty if either is missing
+        is_card_pending = false;
+        encode_status = ENCODE_NOT_BLANK;
+        return;
+    }
+
+    byte buffer[18];
+    is_written = is_written &&
+                 mfrc522.MIFARE_Write(card_data_block, data, sizeof(data)) == MFRC522::STATUS_OK &&
+                 mfrc522.MIFARE_Write(card_empid_block, empid_data, sizeof(empid_data)) == MFRC522::STATUS_OK;
+
+    // Read back, a card moved away during the writes fails here
+    //
+    is_written = is_written &&
+                 read_block(card_data_block, buffer) && memcmp(buffer, data, sizeof(data)) == 0 &&
+                 read_block(card_empid_block, buffer) && memcmp(buffer, empid_data, sizeof(empid_data)) == 0;
+
+    mfrc522.PICC_HaltA();
+    mfrc522.PCD_StopCrypto1();
+    is_card_pending = false;
+
+    // The decision cached for the card belonged to its previous content
+    //
+    if (is_written && uid_cache != nullptr)
+    {
+        uid_cache->forget_card(mfrc522.uid.uidByte, mfrc522.uid.size);
     }
+
+    encode_status = !is_written ? ENCODE_FAILED : (is_v2 ? ENCODE_V2 : ENCODE_V1);
+}
+
+/*!
+* @brief Function to write a user on the next card in the field, which is
+*        not read nor authenticated for access meanwhile. Only a blank card
+*        or a card of the same employee is written, any other is refused.
+*        The card is read back to verify it.
+* @param[in] name const String& of the user name.
+* @param[in] empid uint32_t employee id.
+*/
+void 
+RFIDreader::encode_next_card(const String &name, uint32_t empid)
+{
+    encode_name = name;
+    encode_empid = empid;
+    encode_uid_size = 0;
+    encode_status = ENCODE_PENDING;
+}
+
+/*!
+* @brief Function to stop waiting for a card to encode and forget the last result.
+*/
+void 
+RFIDreader::cancel_encoding()
+{
+    encode_status = ENCODE_IDLE;
+}
+
+/*!
+* @brief Function to get the state of the card encoder.
+* @return ENCODE_PENDING until a card was written, then the result.
+*/
+RFIDreader::EncodeStatus 
+RFIDreader::get_encode_status()
+{
+    return encode_status;
+}
+
+/*!
+* @brief Function to get the UID of the card the encoder wrote or refused.
+* @return The bytes of the UID, see get_encode_uid_size().
+*/
+const byte* 
+RFIDreader::get_encode_uid()
+{
+    return encode_uid;
+}
+
+/*!
+* @brief Function to get the size of the UID of the card the encoder wrote
+*        or refused.
+* @return The number of bytes of the UID, 0 before a card was seen.
+*/
+byte 
+RFIDreader::get_encode_uid_size()
+{
+    return encode_uid_size;
 }
 
 /*!
@@ -0,0 +1,159 @@
+#include "Scheduler.hpp"
+
+// Initialize the static instance
+//
+Scheduler* Scheduler::instance = nullptr;
+
+/*!
+* @brief Constructor.
+*/
+Scheduler::Scheduler() : task_count(0) {}
+
+/*!
+* @brief Function to get the Singleton Instance.
+* @return The scheduler instance.
+*/
+Scheduler*
+Scheduler::get_instance()
+{
+    if (instance == nullptr)
+    {
+        instance = new Scheduler();
+    }
+    return instance;
+}
+
+/*!
+* @brief Function to register a periodic task, released immediately.
+* @param[in] function task_function to execute.
+* @param[in] period_ms uint16_t period of the task, also its relative deadline.
+* @param[in] priority uint8_t tie break between equal deadlines, 0 is the most important.
+* @param[in] profile LoopProfiler::Task slot to record the execution time in.
+* @return The status if the task was registered.
+*/
+bool
+Scheduler::add_task(task_function function, uint16_t period_ms, uint8_t priority, LoopProfiler::Task profile)
+{
+    if (task_count >= scheduler_max_tasks || function == nullptr)
+    {
+        return false;
+    }
+
+    TaskEntry &task = tasks[task_count++];
+    task.function = function;
+    task.period_us = (uint32_t)period_ms * 1000UL;
+    task.release_us = micros();
+    task.priority = priority;
+    task.profile = profile;
+    task.runs = 0;
+    task.overruns = 0;
+    return true;
+}
+
+/*!
+* @brief Function to run the released task with the earliest deadline.
+*/
+void
+Scheduler::run()
+{
+    uint32_t now = micros();
+    int8_t next = -1;
+
+    for (uint8_t i = 0; i < task_count; i++)
+    {
+        // Signed differences keep working when micros() wraps
+        //
+        if ((int32_t)(now - tasks[i].release_us) < 0)
+        {
+            continue;
+        }
+
+        if (next < 0)
+        {
+            next = i;
+            continue;
+        }
+
+        int32_t diff = (int32_t)((tasks[i].release_us + tasks[i].period_us) -
+                                 (tasks[next].release_us + tasks[next].period_us));
+        if (diff < 0 || (diff == 0 && tasks[i].priority < tasks[next].priority))
+        {
+            next = i;
+        }
+    }
+
+    if (next < 0)
+    {
+        return;
+    }
+
+    TaskEntry &task = tasks[next];
+    LoopProfiler *profiler = LoopProfiler::get_instance();
+
+    profiler->begin_task(task.profile);
+    task.function();
+    profiler->end_task(task.profile);
+
+    uint32_t finish = micros();
+    uint32_t deadline = task.release_us + task.period_us;
+
+    task.runs++;
+    if ((int32_t)(finish - deadline) > 0 && task.overruns != 0xFFFF)
+    {
+        task.overruns++;
+    }
+
+    // Keep the cadence of the task, but skip the periods it missed
+    // entirely instead of running it back to back to catch up
+    //
+    task.release_us = deadline;
+    if ((int32_t)(finish - task.release_us) > (int32_t)task.period_us)
+    {
+        task.release_us = finish;
+    }
+}
+
+/*!
+* @brief Function to clear the run and overrun counters.
+*/
+void
+Scheduler::reset_stats()
+{
+    for (uint8_t i = 0; i < task_count; i++)
+    {
+        tasks[i].runs = 0;
+        tasks[i].overruns = 0;
+    }
+}
+
+/*!
+* @brief Function to display the run and overrun counters in the terminal.
+*/
+void
+Scheduler::print_stats()
+{
+    Serial.println(F("TASK       PERIOD(ms) PRIORITY   RUNS       OVERRUNS"));
+    Serial.println(F("----------------------------------------------------"));
+
+    for (uint8_t i = 0; i < task_count; i++)
+    {
+        const TaskEntry &task = tasks[i];
+        String columns[] =
+        {
+            LoopProfiler::task_name(task.profile),
+            String(task.period_us / 1000UL),
+            String(task.priority),
+            String(task.runs),
+        };
+
+        for (const String &column : columns)
+        {
+            Serial.print(column);
+            for (uint8_t j = column.length(); j < 11; j++)
+            {
+                Serial.print(F(" "));
+            }
+        }
+        Serial.println(task.overruns);
+    }
+}
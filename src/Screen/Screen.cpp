@@ -1,17 +1,41 @@
 #include "Screen.hpp"
+#include <RTClib.h>
 
 // Initialize the static instance pointer to nullptr
 //
 Screen *Screen::instance = nullptr;
 
+// The PCF8574 backpack drives the HD44780 in 4 bit mode: every lcd byte is
+// two nibbles, each sent as three I2C transmissions (data, enable high,
+// enable low) of an address and a data byte
+//
+const uint8_t screen_i2c_bytes_per_lcd_byte = 12;
+
+// Unchanged cells up to this length between two changed runs are rewritten
+// instead of moving the cursor, a cursor move costs one lcd byte as well
+//
+const uint8_t screen_max_merge_gap = 1;
+
 
 /*!
 * @brief Constructor of the Screen class, setting the lcd display.
 */
-Screen::Screen() : lcd(0x27, 16, 2) 
+Screen::Screen() 
+    : lcd(0x27, screen_cols, screen_rows),
+      frame_head(0),
+      frame_count(0),
+      draw_step(DRAW_DONE),
+      shown_at_ms(0),
+      is_idle(false),
+      lcd_bytes(0)
 {
     lcd.init();         
     lcd.backlight();    
+    current.hold_ms = 0;
+
+    // init() clears the display, the shadow starts blank as well
+    //
+    memset(shadow, ' ', sizeof(shadow));
 }
 
 /*!
@@ -68,28 +92,14 @@ Screen::print_line(uint8_t col, uint8_t row, const char *content)
 void 
 Screen::print_access_granted(const String& date, const String& time) 
 {
-    String display_content;
-
-    // Only update the screen when content changes
-    //
-    display_content = "Access Granted";
-    lcd.setCursor(0,0);
-    lcd.print( display_content.c_str());
+    String date_content = "Date: " + date;
+    String time_content = "Time: " + time;
 
-    // Use millis() to create non-blocking delays
+    // A new message replaces whatever is still shown or waiting
     //
-    unsigned long startMillis = millis();
-    while (millis() - startMillis < 1000);  // Wait for 1 second (non-blocking)
-
-    display_content = "Date: " + date;
-    lcd.setCursor(0,0);
-    lcd.print( display_content.c_str());
-    display_content = "Time: " + time;
-    lcd.setCursor(0,1);
-    lcd.print(display_content.c_str());
-    
-    startMillis = millis();
-    while (millis() - startMillis < 1000);  // Wait for 1 second (non-blocking)
+    flush_frames();
+    push_frame("Access Granted", 0, "", 0, 1000);
+    push_frame(date_content.c_str(), 0, time_content.c_str(), 0, 1000);
 }
 
 /*!
@@ -98,25 +108,25 @@ Screen::print_access_granted(const String& date, const String& time)
 void 
 Screen::print_access_denied() 
 {
-    clear_screen();
-    lcd.setCursor(0,0);
-    lcd.print("Access Denied !!!");
-    lcd.setCursor(5,1);
-    lcd.print("Cloudly");
-    delay(250);
+    flush_frames();
+    push_frame("Access Denied !!!", 0, "Cloudly", 5, 250);
 }
 
 /*!
-* @brief Function to print ideal message to the lcd display.
+* @brief Function to print ideal message to the lcd display, once the
+*        queued messages have been shown.
 */
 void 
 Screen::print_idle_state() 
 {
-    clear_screen();
-    lcd.setCursor(0,0);
-    lcd.print("Scan Your Card>>");
-    lcd.setCursor(5,1);
-    lcd.print("Cloudly");
+    // Queue the idle page only once, it stays until the next message
+    //
+    if (is_idle)
+    {
+        return;
+    }
+    push_frame("Scan Your Card>>", 0, "Cloudly", 5, 0);
+    is_idle = true;
 }
 
 /*!
@@ -141,7 +151,7 @@ Screen::display_menu_page(uint8_t page)
     static uint8_t lastPage = 0;
     if (lastPage != page) 
     {
-        lcd.clear();
+        clear_screen();
         lastPage = page;
     }
 
@@ -187,44 +197,206 @@ void
 Screen::clear_screen()
 {
     lcd.clear();
+    lcd_bytes++;
+    memset(shadow, ' ', sizeof(shadow));
 }
 
 /*!
-* @brief Function to print granted message to the lcd display (overloaded).
-* @param[in] name const String& which name to show in the lcd display.
-* @param[in] date const String& which date to show in the lcd display.
-* @param[in] time const String& which time to show in the lcd display.
+* @brief Function to print granted message to the lcd display (overloaded),
+*        the name of the card key with the time and date of the decision.
+* @param[in] scan const ScanRecord& of the card granted.
 */
 void 
-Screen::print_access_granted(const String &name,const String& date, const String& time)
+Screen::print_access_granted(const ScanRecord &scan)
 {
-    String display_content;
+    char modified_name[card_key_size];
+    const char *comma = strchr(scan.key, ',');
+    size_t name_length = (comma != nullptr) ? (size_t)(comma - scan.key) : strlen(scan.key);
+    memcpy(modified_name, scan.key, name_length);
+    modified_name[name_length] = '\0';
 
-    // Only update the screen when content changes
+    // The time "h:m:s" and the date "d/m/yyyy" are cut to 5 and 4 characters
     //
-    display_content = "Access Granted";
-    lcd.setCursor(0,0);
-    lcd.print( display_content.c_str());
-    display_content = "Cloudly";
-    lcd.setCursor(5,1);
-    lcd.print(display_content);
-
-    // Use millis() to create non-blocking delays
+    DateTime at(scan.epoch);
+    char modified_time[12];
+    char modified_date[16];
+    snprintf(modified_time, sizeof(modified_time), "%u:%u:%u", at.hour(), at.minute(), at.second());
+    snprintf(modified_date, sizeof(modified_date), "%u/%u/%u", at.day(), at.month(), at.year());
+
+    char display_content[screen_cols + 1];
+    snprintf(display_content, sizeof(display_content), "T/D: %.5s %.4s", modified_time, modified_date);
+
+    // A new message replaces whatever is still shown or waiting
     //
-    unsigned long startMillis = millis();
-    while (millis() - startMillis < 1000);  // Wait for 1 second (non-blocking)
-
-    clear_screen();
-    String modified_name = name.substring(0,name.indexOf(','));
-    display_content = modified_name;
-    lcd.setCursor(0,0);
-    lcd.print( display_content.c_str());
-    String modified_time = time.substring(0,5);
-    String modified_date = date.substring(0,4);
-    display_content = "T/D: " + modified_time +" " + modified_date;
-    lcd.setCursor(0,1);
-    lcd.print(display_content.c_str());
-    
-    startMillis = millis();
-    while (millis() - startMillis < 1000);  // Wait for 1 second (non-blocking)
+    flush_frames();
+    push_frame("Access Granted", 0, "Cloudly", 5, 1000);
+    push_frame(modified_name, 0, display_content, 0, 1000);
+}
+
+/*!
+* @brief Function to queue a frame behind the pending ones, the oldest
+*        pending frame is dropped when the queue is full.
+* @param[in] row_0 const char * content of the first row.
+* @param[in] col_0 uint8_t column the first row starts at.
+* @param[in] row_1 const char * content of the second row.
+* @param[in] col_1 uint8_t column the second row starts at.
+* @param[in] hold_ms uint16_t time to keep the frame, 0 until the next frame.
+*/
+void 
+Screen::push_frame(const char *row_0, uint8_t col_0, const char *row_1, uint8_t col_1, uint16_t hold_ms)
+{
+    if (frame_count == screen_queue_size)
+    {
+        frame_head = (frame_head + 1) % screen_queue_size;
+        frame_count--;
+    }
+
+    Frame &frame = frames[(frame_head + frame_count) % screen_queue_size];
+    const char *rows[screen_rows] = { row_0, row_1 };
+    uint8_t cols[screen_rows] = { col_0, col_1 };
+
+    // A frame covers every cell, so drawing it never needs a clear
+    //
+    memset(frame.cells, ' ', sizeof(frame.cells));
+    for (uint8_t r = 0; r < screen_rows; r++)
+    {
+        // Text beyond the last column would never be visible
+        //
+        for (uint8_t c = cols[r]; c < screen_cols && rows[r][c - cols[r]] != '\0'; c++)
+        {
+            frame.cells[r][c] = rows[r][c - cols[r]];
+        }
+    }
+    frame.hold_ms = hold_ms;
+    frame_count++;
+}
+
+/*!
+* @brief Function to drop the pending frames and end the current one.
+*/
+void 
+Screen::flush_frames()
+{
+    frame_count = 0;
+    current.hold_ms = 0;
+    draw_step = DRAW_DONE;
+    is_idle = false;
+}
+
+/*!
+* @brief Function to check if a frame is being drawn, shown or waiting.
+* @return The status if the display is busy with a message.
+*/
+bool 
+Screen::is_busy() const
+{
+    if (frame_count > 0 || draw_step != DRAW_DONE)
+    {
+        return true;
+    }
+    return current.hold_ms != 0 && (millis() - shown_at_ms) < current.hold_ms;
+}
+
+/*!
+* @brief Function to send the cells of a row which differ from the shadow
+*        framebuffer, as runs starting with a single cursor move.
+* @param[in] row uint8_t row of the current frame to draw.
+*/
+void 
+Screen::draw_row(uint8_t row)
+{
+    const char *target = current.cells[row];
+    char *visible = shadow[row];
+    uint8_t col = 0;
+
+    while (col < screen_cols)
+    {
+        if (target[col] == visible[col])
+        {
+            col++;
+            continue;
+        }
+
+        // Extend the run over short gaps of unchanged cells
+        //
+        uint8_t end = col + 1;
+        uint8_t last_changed = col;
+        while (end < screen_cols && end - last_changed <= screen_max_merge_gap + 1)
+        {
+            if (target[end] != visible[end])
+            {
+                last_changed = end;
+            }
+            end++;
+        }
+
+        lcd.setCursor(col, row);
+        lcd_bytes++;
+        for (uint8_t c = col; c <= last_changed; c++)
+        {
+            lcd.write((uint8_t)target[c]);
+            visible[c] = target[c];
+            lcd_bytes++;
+        }
+        col = last_changed + 1;
+    }
+}
+
+/*!
+* @brief Function to get the number of bytes sent to the lcd over I2C.
+* @return The I2C bytes since the last reset.
+*/
+uint32_t 
+Screen::get_i2c_bytes() const
+{
+    return lcd_bytes * screen_i2c_bytes_per_lcd_byte;
+}
+
+/*!
+* @brief Function to reset the I2C byte counter.
+*/
+void 
+Screen::reset_i2c_bytes()
+{
+    lcd_bytes = 0;
+}
+
+/*!
+* @brief Function to advance the frame queue, draws one row of a frame per
+*        call and takes the next frame once the current one expired.
+*/
+void 
+Screen::run()
+{
+    if (draw_step == DRAW_DONE)
+    {
+        // Keep the current frame until its time is over, a frame without
+        // time is replaced as soon as another one is waiting
+        //
+        if (frame_count == 0)
+        {
+            return;
+        }
+        if (current.hold_ms != 0 && (millis() - shown_at_ms) < current.hold_ms)
+        {
+            return;
+        }
+
+        current = frames[frame_head];
+        frame_head = (frame_head + 1) % screen_queue_size;
+        frame_count--;
+        draw_step = DRAW_ROW_0;
+    }
+
+    // One row per call
+    //
+    draw_row(draw_step - DRAW_ROW_0);
+    draw_step = (DrawStep)(draw_step + 1);
+
+    // The hold time starts once the frame is completely visible
+    //
+    if (draw_step == DRAW_DONE)
+    {
+        shown_at_ms = millis();
+    }
 }
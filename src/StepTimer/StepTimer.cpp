@@ -0,0 +1,105 @@
+#include "StepTimer.hpp"
+
+#ifdef NATIVE_HAL
+#include <HostHal.h>
+#else
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#endif
+
+/*!
+* @brief Function to clamp a period to the range of the timer.
+* @param[in] period_us uint32_t of the requested period.
+* @return The compare value, the period is one tick longer.
+*/
+static uint16_t
+period_to_ticks(uint32_t period_us)
+{
+    uint32_t ticks = period_us / step_timer_tick_us;
+    if (ticks == 0)
+    {
+        return 0;
+    }
+    return (ticks > 65536UL) ? 0xFFFF : (uint16_t)(ticks - 1);
+}
+
+#ifdef NATIVE_HAL
+
+void
+step_timer_start(uint32_t period_us, step_timer_isr isr)
+{
+    host::timer_start(((uint32_t)period_to_ticks(period_us) + 1) * step_timer_tick_us, isr);
+}
+
+void
+step_timer_set_period(uint32_t period_us)
+{
+    host::timer_set_period(((uint32_t)period_to_ticks(period_us) + 1) * step_timer_tick_us);
+}
+
+void
+step_timer_stop()
+{
+    host::timer_stop();
+}
+
+#else
+
+static volatile step_timer_isr timer_isr = nullptr;
+
+/*!
+* @brief Function to start Timer1 in CTC mode with prescaler 64.
+* @param[in] period_us uint32_t of the time between two ISR runs.
+* @param[in] isr step_timer_isr to run on every compare match.
+*/
+void
+step_timer_start(uint32_t period_us, step_timer_isr isr)
+{
+    uint8_t sreg = SREG;
+    cli();
+
+    timer_isr = isr;
+    TCCR1A = 0;
+    TCCR1B = 0;
+    TCNT1  = 0;
+    OCR1A  = period_to_ticks(period_us);
+    TIFR1  = _BV(OCF1A);
+    TIMSK1 = _BV(OCIE1A);
+    TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10);
+
+    SREG = sreg;
+}
+
+/*!
+* @brief Function to change the compare value, the counter was cleared on the
+*        match so from the ISR the new value times the next step.
+* @param[in] period_us uint32_t of the time between two ISR runs.
+*/
+void
+step_timer_set_period(uint32_t period_us)
+{
+    uint8_t sreg = SREG;
+    cli();
+    OCR1A = period_to_ticks(period_us);
+    SREG = sreg;
+}
+
+/*!
+* @brief Function to stop Timer1 and its interrupt.
+*/
+void
+step_timer_stop()
+{
+    TIMSK1 &= ~_BV(OCIE1A);
+    TCCR1B = 0;
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+    if (timer_isr != nullptr)
+    {
+        timer_isr();
+    }
+}
+
+#endif
@@ -2,11 +2,13 @@
 
 /*!
 * @brief Function to Set the RFID tag.
+* @param[in] rfid const String& of the RFID tag.
+* @return The status if the tag is held, false when the name pool is full.
 */
-void 
+bool 
 User::set_rfid(const String& rfid) 
 {
-    rfid_tag = rfid;
+    return rfid_tag.set(rfid.c_str());
 }
 
 
@@ -17,7 +19,7 @@ User::set_rfid(const String& rfid)
 String 
 User::get_rfid() const 
 {
-    return rfid_tag;
+    return String(rfid_tag.c_str());
 }
 
 // TODO : implement user specific check during authentication.
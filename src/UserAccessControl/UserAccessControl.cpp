@@ -37,60 +37,45 @@ UserAccessControl::access_denied(Screen *screen)
 void 
 UserAccessControl::set_up_date_time(Database *db, RFIDreader *rfid_reader)
 {
-    // Retrieve current date and time from the database
+    // Stamp the scanned card with the current time of the RTC
     //    
-    String date = db->get_current_date();
-    String time = db->get_current_time();
-
-    // Set date and time in the RFID reader
-    //
-    rfid_reader->set_current_date(date);
-    rfid_reader->set_current_time(time);
+    rfid_reader->set_scan_time(db->get_current_epoch());
 }
 
 /*!
 * @brief Function to controle the user access to the system.
-* @param[in] db Database * of the databsae class.
 * @param[in] rfid_reader RFIDreader * of the RFIDreader class.
 * @param[in] screen Screen * of the Screen class.
 */
 void 
 UserAccessControl::user_access_granted(Database *db, RFIDreader *rfid_reader, Screen *screen)
 {
-    // Get RFID reader instance and tag details
+    // Scanned card, stamped by set_up_date_time()
     //
-    String tag = rfid_reader->get_tag();
-    String date_rfid = db->get_current_date();
-    String time_rfid = db->get_current_time();
+    const ScanRecord &scan = rfid_reader->get_scan();
 
-    
-    db->log_rfid_scan(tag, date_rfid, time_rfid);
+    db->log_scan(scan);
 
-    
-    screen->print_access_granted(tag, date_rfid, time_rfid);
+    screen->print_access_granted(scan);
 }
 
 /*!
 * @brief Function to controle the user access to the system.
-* @param[in] db Database * of the databsae class.
 * @param[in] rfid_reader RFIDreader * of the RFIDreader class.
 * @param[in] auth  AuthenticationService & of the AuthenticationService class.
 * @return The status if user is present in the system or not.
 */
 bool 
-UserAccessControl::user_auth_function(Database *db, RFIDreader *rfid_reader, Screen *screen, AuthenticationService & auth)
+UserAccessControl::user_auth_function(RFIDreader *rfid_reader, AuthenticationService & auth)
 {
-    // Retrieve the RFID tag
-    //
-    String rfid = rfid_reader->get_tag();
-    
-    // Reset the tag in the RFID reader after reading
+    // Authenticate the user based on the RFID tag, cached under the card UID
     //
-    rfid_reader->set_tag("");
+    const ScanRecord &scan = rfid_reader->get_scan();
+    uint32_t decide_us = micros();
+    bool is_allowed = auth.authenticate_card(scan.uid, scan.uid_size, scan.key);
+    rfid_reader->record_stage(RFIDreader::STAGE_DECIDE, micros() - decide_us);
 
-    // Authenticate the user based on the RFID tag
-    //
-    if (auth.authenticate_user(rfid))
+    if (is_allowed)
     {
         // DEBUG
         //
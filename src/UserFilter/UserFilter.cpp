@@ -0,0 +1,401 @@
+#include "UserFilter.hpp"
+
+// Initialize the static instance
+//
+UserFilter* UserFilter::instance = nullptr;
+
+/*!
+* @brief Constructor.
+*/
+UserFilter::UserFilter()
+    : bits(nullptr), allocated(0), size(0), hashes(0), is_built(false), build_empid(0), capacity(0), users(0), stale(0), builds(0)
+{
+    memset(stale_bits, 0, sizeof(stale_bits));
+    reset_stats();
+}
+
+/*!
+* @brief Function to get the Singleton Instance.
+* @return The user filter instance.
+*/
+UserFilter*
+UserFilter::get_instance()
+{
+    if (instance == nullptr)
+    {
+        instance = new UserFilter();
+    }
+    return instance;
+}
+
+/*!
+* @brief Function to build the filter at once, used at boot before the tasks
+*        run.
+*/
+void
+UserFilter::build()
+{
+    start_build();
+    while (!is_built)
+    {
+        run();
+    }
+}
+
+/*!
+* @brief Function to start a rebuild. The filter is sized from the number of
+*        users in the store, with room for a quarter more, and cleared; the
+*        users are then set by run(), every card passing until the last one.
+*        A larger block is allocated when the users outgrow the current one,
+*        without a block every card passes.
+*/
+void
+UserFilter::start_build()
+{
+    uint32_t count = UserStore::get_instance()->size();
+
+    capacity = count + count / 4 + 16;
+    uint32_t bytes = (capacity * user_filter_bits_per_user + 7) / 8;
+    size = constrain(bytes, (uint32_t)user_filter_min_bytes, (uint32_t)user_filter_max_bytes);
+    if (size > allocated)
+    {
+        free(bits);
+        bits = (uint8_t *)malloc(size);
+        allocated = bits ? size : 0;
+    }
+    if (bits == nullptr)
+    {
+        Serial.println(F("Error: No memory for the user filter!"));
+        size = 0;
+        return;
+    }
+    memset(bits, 0, size);
+    memset(stale_bits, 0, sizeof(stale_bits));
+
+    // k = bits per user * ln 2, rounded
+    //
+    uint32_t k = ((uint32_t)size * 8 * 69 / 100 + capacity / 2) / capacity;
+    hashes = constrain(k, (uint32_t)1, (uint32_t)user_filter_max_hashes);
+
+    is_built = false;
+    build_empid = 0;
+    users = count;
+    stale = 0;
+    builds++;
+}
+
+/*!
+* @brief Function to set the bits of the next users of the store while the
+*        filter is rebuilt, called by the store task. Users added meanwhile
+*        are set by add(), those removed are counted stale.
+*/
+void
+UserFilter::run()
+{
+    if (is_built || size == 0)
+    {
+        return;
+    }
+
+    UserStore *store = UserStore::get_instance();
+    UserRecord records[user_store_read_batch];
+    for (uint8_t i = 0; i < user_filter_build_step; )
+    {
+        uint8_t found = store->find_next(build_empid, records, min(user_filter_build_step - i, (int)user_store_read_batch));
+        if (found == 0)
+        {
+            is_built = true;
+            return;
+        }
+
+        for (uint8_t j = 0; j < found; j++)
+        {
+            set_bits(bits, size, hashes, records[j].name, strlen(records[j].name), records[j].empid);
+        }
+        if (records[found - 1].empid == 0xFFFFFFFFUL)
+        {
+            is_built = true;
+            return;
+        }
+        build_empid = records[found - 1].empid + 1;
+        i += found;
+    }
+}
+
+/*!
+* @brief Function to tell if the filter is being rebuilt.
+* @return The status if run() has users left to set.
+*/
+bool
+UserFilter::is_building() const
+{
+    return size != 0 && !is_built;
+}
+
+/*!
+* @brief Function to add a registered user, a rebuild to a larger size
+*        starts once the filter holds more users than it was sized for.
+* @param[in] name const char * of the user name.
+* @param[in] empid uint32_t employee id.
+*/
+void
+UserFilter::add(const char *name, uint32_t empid)
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    set_bits(bits, size, hashes, name, strlen(name), empid);
+    users++;
+
+    if (users > capacity && size < user_filter_max_bytes && is_built)
+    {
+        start_build();
+    }
+}
+
+/*!
+* @brief Function to account for a removed user. Its bits may be shared with
+*        other users so they stay set, a rebuild starts once the stale users
+*        reach a quarter of the capacity.
+* @param[in] name const char * of the user name.
+* @param[in] empid uint32_t employee id.
+*/
+void
+UserFilter::remove(const char *name, uint32_t empid)
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    stale++;
+    set_bits(stale_bits, sizeof(stale_bits), user_filter_stale_hashes, name, strlen(name), empid);
+
+    if (stale * 4 > capacity && is_built)
+    {
+        start_build();
+    }
+}
+
+/*!
+* @brief Function to check a card key against the filter.
+* @param[in] key const char * of the key "name,empid" read from the card.
+* @return False when the card is certainly not registered.
+*/
+bool
+UserFilter::might_contain(const char *key)
+{
+    if (!is_built)
+    {
+        return true;
+    }
+
+    uint8_t name_length;
+    uint32_t empid;
+    if (!UserStore::parse_card(key, name_length, empid) || !test_bits(bits, size, hashes, key, name_length, empid))
+    {
+        rejected++;
+        return false;
+    }
+
+    passed++;
+    return true;
+}
+
+/*!
+* @brief Function to count a card passed by the filter but not registered.
+*        A card matching the filter of the removed users is most likely one
+*        of theirs, its bits are still set, and is counted apart.
+* @param[in] key const char * of the key "name,empid" read from the card.
+*/
+void
+UserFilter::count_false_positive(const char *key)
+{
+    if (!is_built)
+    {
+        return;
+    }
+
+    uint8_t name_length;
+    uint32_t empid;
+    if (UserStore::parse_card(key, name_length, empid) &&
+        test_bits(stale_bits, sizeof(stale_bits), user_filter_stale_hashes, key, name_length, empid))
+    {
+        stale_hits++;
+        return;
+    }
+    false_positives++;
+}
+
+/*!
+* @brief Function to hash a user, FNV-1a over the name and the employee id.
+* @param[in] name const char * of the name, not terminated.
+* @param[in] name_length uint8_t of the name.
+* @param[in] empid uint32_t employee id.
+* @return The 32 bit hash.
+*/
+uint32_t
+UserFilter::hash(const char *name, uint8_t name_length, uint32_t empid)
+{
+    uint32_t h = 0x811C9DC5UL;
+    for (uint8_t i = 0; i < name_length; i++)
+    {
+        h = (h ^ (uint8_t)name[i]) * 0x01000193UL;
+    }
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        h = (h ^ (uint8_t)(empid >> (8 * i))) * 0x01000193UL;
+    }
+    return h;
+}
+
+/*!
+* @brief Function to derive the step between the bit positions of a user,
+*        which are h1 + i * h2.
+* @param[in] h1 uint32_t hash of the user.
+* @return The odd step h2.
+*/
+static uint32_t
+second_hash(uint32_t h1)
+{
+    return ((h1 >> 16) | (h1 << 16)) * 0x85EBCA6BUL | 1;
+}
+
+/*!
+* @brief Function to set the bits of a user.
+* @param[in] array uint8_t * of the bits.
+* @param[in] bytes uint16_t of the array.
+* @param[in] count uint8_t of the bits set per user.
+* @param[in] name const char * of the name, not terminated.
+* @param[in] name_length uint8_t of the name.
+* @param[in] empid uint32_t employee id.
+*/
+void
+UserFilter::set_bits(uint8_t *array, uint16_t bytes, uint8_t count,
+                     const char *name, uint8_t name_length, uint32_t empid)
+{
+    uint32_t total = (uint32_t)bytes * 8;
+    uint32_t h1 = hash(name, name_length, empid);
+    uint32_t h2 = second_hash(h1);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint32_t bit = (h1 + i * h2) % total;
+        array[bit / 8] |= (uint8_t)(1 << (bit % 8));
+    }
+}
+
+/*!
+* @brief Function to test the bits of a user.
+* @param[in] array const uint8_t * of the bits.
+* @param[in] bytes uint16_t of the array.
+* @param[in] count uint8_t of the bits set per user.
+* @param[in] name const char * of the name, not terminated.
+* @param[in] name_length uint8_t of the name.
+* @param[in] empid uint32_t employee id.
+* @return The status if all the bits of the user are set.
+*/
+bool
+UserFilter::test_bits(const uint8_t *array, uint16_t bytes, uint8_t count,
+                      const char *name, uint8_t name_length, uint32_t empid)
+{
+    uint32_t total = (uint32_t)bytes * 8;
+    uint32_t h1 = hash(name, name_length, empid);
+    uint32_t h2 = second_hash(h1);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint32_t bit = (h1 + i * h2) % total;
+        if ((array[bit / 8] & (1 << (bit % 8))) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+* @brief Function to estimate the false positive rate from the bits set, the
+*        chance that all the bits of an unknown card are set.
+* @return The rate between 0 and 1.
+*/
+float
+UserFilter::estimated_fp_rate() const
+{
+    uint32_t set = 0;
+    for (uint16_t i = 0; i < size; i++)
+    {
+        for (uint8_t byte = bits[i]; byte != 0; byte &= byte - 1)
+        {
+            set++;
+        }
+    }
+
+    float fill = (float)set / ((uint32_t)size * 8);
+    float rate = 1;
+    for (uint8_t i = 0; i < hashes; i++)
+    {
+        rate *= fill;
+    }
+    return rate;
+}
+
+/*!
+* @brief Function to clear the filter counters.
+*/
+void
+UserFilter::reset_stats()
+{
+    rejected = 0;
+    passed = 0;
+    false_positives = 0;
+    stale_hits = 0;
+}
+
+/*!
+* @brief Function to display the filter size, its estimated and measured
+*        false positive rates in the terminal. The cards of removed users
+*        are left out of the measured rate.
+*/
+void
+UserFilter::print_stats()
+{
+    if (size == 0)
+    {
+        Serial.println(F("User filter: not built"));
+        return;
+    }
+
+    Serial.print(F("User filter: "));
+    Serial.print(size);
+    Serial.print(F(" of "));
+    Serial.print(user_filter_max_bytes);
+    Serial.print(F(" bytes, "));
+    Serial.print(hashes);
+    Serial.print(F(" hashes, "));
+    Serial.print(users - stale);
+    Serial.print(F(" users, "));
+    Serial.print(stale);
+    Serial.print(F(" stale, est. FP "));
+    Serial.print(estimated_fp_rate() * 100, 2);
+    Serial.print(F("%, "));
+    Serial.print(builds);
+    Serial.print(is_built ? " builds" : " builds, rebuilding");
+    Serial.println();
+
+    // Measured on the unknown cards, those rejected and the false positives
+    //
+    uint32_t unknown = rejected + false_positives;
+    Serial.print(F("User filter checks: rejected "));
+    Serial.print(rejected);
+    Serial.print(F(", passed "));
+    Serial.print(passed);
+    Serial.print(F(", false positives "));
+    Serial.print(false_positives);
+    Serial.print(F(" ("));
+    Serial.print(unknown > 0 ? (float)false_positives * 100 / unknown : 0.0f, 2);
+    Serial.print(F("%), removed users "));
+    Serial.println(stale_hits);
+}
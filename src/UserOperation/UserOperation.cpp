@@ -1,11 +1,11 @@
 #include "UserOperation.hpp"
+#include "MemoryStats.hpp"
 #include <Arduino.h>
 
 // Static member definitions
 //
 Door* UserOperation::p_door = nullptr;
 AuthenticationService* UserOperation::p_auth = nullptr;
-String UserOperation::uid = "";
 
 /*!
 * @brief Constructor to initialize most components except Door and AuthenticationService.
@@ -36,36 +36,34 @@ UserOperation::setAuthenticationService(AuthenticationService* auth_service)
 }
 
 /*!
-* @brief Function to run the user operation.
+* @brief Function to run the user operation. The scanned card is carried in
+*        a ScanRecord, the heap allocations made on the way are counted and
+*        expected to be none.
 */
 void 
 UserOperation::run() 
 {
+    uint32_t allocs = memory_alloc_count();
+
     p_screen->print_idle_state();
-    delay(50);
     
     // Check if a card scan is pending or already done
     //
     if (!p_rfid->get_is_scan_card()) 
     {
-        uid = p_rfid->handleCardRead(); // Scan for a new card
+        p_rfid->handleCardRead(); // Scan for a new card
     }
     else 
     {
-        uid = p_rfid->get_tag();  // Retrieve the UID of the already scanned card
-
         //DEBUG
         //
-        // Log the scanned UID
-        // Serial.print("The UID scanned: ");
-        // Serial.println(uid);    
-
-        uid.trim();  // Remove any extra whitespace from the UID string
+        // Log the scanned key
+        // Serial.print(F("The key scanned: "));
+        // Serial.println(p_rfid->get_tag());    
 
-        
-        // Check if the UID is valid
+        // Check if the key read from the card is valid
         //
-        if (uid != "") 
+        if (p_rfid->get_tag()[0] != '\0') 
         {
             // DEBUG
             //
@@ -74,16 +72,13 @@ UserOperation::run()
 
             // Check if the user is present in the database
             //
-            bool is_present = p_usr_acs_ctrl->user_auth_function(p_db, p_rfid, p_screen, (*p_auth));
+            bool is_present = p_usr_acs_ctrl->user_auth_function(p_rfid, (*p_auth));
             if (is_present) 
             {
                 // Grant access if the user is authenticated
                 //
                 p_usr_acs_ctrl->set_up_date_time(p_db, p_rfid);
-                p_rfid->set_tag(uid.c_str());
-                
                 p_usr_acs_ctrl->user_access_granted(p_db, p_rfid, p_screen);
-                p_rfid->remove_tag();
                 if (p_door) 
                 {
                     p_door->open();  // Open the door if it's set
@@ -109,7 +104,12 @@ UserOperation::run()
 
         // Reset for the next scan
         //
-        uid = "";  // Clear the UID
         p_rfid->set_is_scan_card(false);  // Mark the scan as complete and reset
+
+        // Cards read together with this one are decided in order, one per run
+        //
+        p_rfid->next_queued_card();
     }
+
+    p_rfid->record_allocs(memory_alloc_count() - allocs);
 }
@@ -0,0 +1,1246 @@
+#include "UserStore.hpp"
+#include "LogFormat.hpp"
+#include <stddef.h>
+
+// Initialize the static instance
+//
+UserStore* UserStore::instance = nullptr;
+
+/*!
+* @brief Constructor.
+*/
+UserStore::UserStore()
+    : active_path(nullptr), spare_path(nullptr), committed_pages(0), is_batch(false), cache_clock(0), next_empid(0),
+      is_cursor_done(true), compact_stage(COMPACT_IDLE), is_compact_failed(false), compactions(0)
+{
+    memset(&meta, 0, sizeof(meta));
+    memset(cache_page, 0, sizeof(cache_page));
+    memset(cache_dirty, 0, sizeof(cache_dirty));
+    reset_stats();
+}
+
+/*!
+* @brief Function to get the Singleton Instance.
+* @return The user store instance.
+*/
+UserStore*
+UserStore::get_instance()
+{
+    if (instance == nullptr)
+    {
+        instance = new UserStore();
+    }
+    return instance;
+}
+
+/*!
+* @brief Function to check the metadata of a tree file.
+* @param[in] tree File& of the tree.
+* @param[out] tree_meta UserStoreMeta read from page 0.
+* @return The status if the file holds a tree.
+*/
+bool
+UserStore::read_meta(File &tree, UserStoreMeta &tree_meta)
+{
+    // The SD library opens a file for writing at its end
+    //
+    return tree.seek(0) &&
+           tree.read(&tree_meta, sizeof(tree_meta)) == sizeof(tree_meta) &&
+           memcmp(tree_meta.magic, user_store_magic, sizeof(tree_meta.magic)) == 0 &&
+           tree_meta.version == user_store_version &&
+           tree_meta.crc == log_crc16((const uint8_t *)&tree_meta, offsetof(UserStoreMeta, crc)) &&
+           tree_meta.height >= 1 && tree_meta.height <= user_store_max_height &&
+           tree_meta.root < tree_meta.page_count &&
+           tree.size() >= tree_meta.page_count * (uint32_t)user_page_size;
+}
+
+/*!
+* @brief Function to open the tree. When both files are valid a compaction
+*        ended before the old file was removed, the newer generation is the
+*        tree and the other file is removed. When neither is valid the tree
+*        file is replaced by an empty tree.
+* @param[in] path const char * of the tree file.
+* @param[in] spare_path const char * of the file compactions write to.
+* @return The status if the tree could be opened.
+*/
+bool
+UserStore::begin(const char *path, const char *spare_path)
+{
+    close();
+
+    active_path = path;
+    this->spare_path = spare_path;
+    is_compact_failed = false;
+
+    file = SD.open(active_path, O_RDWR | O_CREAT);
+    if (!file)
+    {
+        return false;
+    }
+
+    bool is_valid = read_meta(file, meta);
+    if (SD.exists(this->spare_path))
+    {
+        File candidate = SD.open(this->spare_path, O_RDWR);
+        UserStoreMeta candidate_meta;
+        if (candidate && read_meta(candidate, candidate_meta) &&
+            (!is_valid || (int16_t)(candidate_meta.generation - meta.generation) > 0))
+        {
+            file.close();
+            SD.remove(active_path);
+            active_path = this->spare_path;
+            this->spare_path = path;
+            file = candidate;
+            meta = candidate_meta;
+            is_valid = true;
+        }
+        else
+        {
+            candidate.close();
+            SD.remove(this->spare_path);
+        }
+    }
+
+    if (!is_valid)
+    {
+        // Pages of the invalid file are overwritten from the start
+        //
+        if (file.size() > 0)
+        {
+            Serial.println(F("Error: Invalid user store, starting empty!"));
+        }
+        reset_tree();
+    }
+    committed_pages = meta.page_count;
+    return (bool)file;
+}
+
+/*!
+* @brief Function to write the pending changes and close the tree.
+*/
+void
+UserStore::close()
+{
+    if (!file)
+    {
+        return;
+    }
+
+    is_batch = false;
+    abort_compaction();
+    commit();
+    file.close();
+    memset(cache_page, 0, sizeof(cache_page));
+}
+
+/*!
+* @brief Function to add a user to the tree. A full leaf is split in two and
+*        its parent gets a branch to the new half, up to the root. The
+*        halves and the pages above them move to new pages, a power cut
+*        before the metadata is written leaves the previous tree whole.
+* @param[in] name const String& of the user name.
+* @param[in] empid uint32_t employee id of the user.
+* @param[in] since_day uint32_t day of the registration since 1970, 0 when unknown.
+* @return The status if the user was added.
+*/
+bool
+UserStore::add(const String &name, uint32_t empid, uint32_t since_day)
+{
+    UserRecord record;
+    if (!file || name.length() == 0 || name.length() >= user_name_size || find_empid(empid, record))
+    {
+        return false;
+    }
+    abort_compaction();
+
+    memset(&record, 0, sizeof(record));
+    record.empid = empid;
+    memcpy(record.name, name.c_str(), name.length());
+    record.since_day[0] = since_day & 0xFF;
+    record.since_day[1] = (since_day >> 8) & 0xFF;
+    record.since_day[2] = (since_day >> 16) & 0xFF;
+
+    // Walk down to the leaf, remembering the path for the splits
+    //
+    uint32_t page = meta.root;
+    for (uint8_t level = 0; level + 1 < meta.height; level++)
+    {
+        path[level] = page;
+        UserPage *inner = load_page(page);
+        if (inner == nullptr)
+        {
+            return false;
+        }
+        page = inner->branches[branch_position(inner, empid)].page;
+    }
+    path[meta.height - 1] = page;
+
+    UserPage *leaf = load_page(page);
+    if (leaf == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t position = leaf_position(leaf, empid);
+    if (leaf->count < user_leaf_records)
+    {
+        memmove(&leaf->records[position + 1], &leaf->records[position],
+                (leaf->count - position) * sizeof(UserRecord));
+        leaf->records[position] = record;
+        leaf->count++;
+
+        // Within a batch the tree on the card is only changed by end_batch(),
+        // a leaf moves the first time it changes and may be evicted
+        //
+        if (!is_batch)
+        {
+            mark_dirty(leaf);
+        }
+        else if (!insert_branch(meta.height - 1, move_page(leaf), 0, 0))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // Both halves end with the same number of records
+        //
+        uint32_t left_page = move_page(leaf);
+        uint32_t right_page;
+        UserPage *right = new_page(USER_PAGE_LEAF, right_page);
+        if (right == nullptr)
+        {
+            return false;
+        }
+
+        uint8_t half = (user_leaf_records + 1) / 2;
+        uint8_t moved_from = (position < half) ? half - 1 : half;
+        right->count = leaf->count - moved_from;
+        memcpy(right->records, &leaf->records[moved_from], right->count * sizeof(UserRecord));
+        leaf->count = moved_from;
+
+        UserPage *target = (position < half) ? leaf : right;
+        uint8_t at = (position < half) ? position : position - half;
+        memmove(&target->records[at + 1], &target->records[at], (target->count - at) * sizeof(UserRecord));
+        target->records[at] = record;
+        target->count++;
+
+        mark_dirty(leaf);
+        mark_dirty(right);
+
+        if (!insert_branch(meta.height - 1, left_page, right->records[0].empid, right_page))
+        {
+            return false;
+        }
+    }
+
+    meta.user_count++;
+    return is_batch || commit();
+}
+
+/*!
+* @brief Function to remove a user. Leaves are never merged, an empty leaf
+*        keeps its branch and is filled again by later additions or dropped
+*        by the next compaction.
+* @param[in] empid uint32_t employee id of the user.
+* @return The status if the user was found and removed.
+*/
+bool
+UserStore::remove(uint32_t empid)
+{
+    UserPage *leaf = find_leaf(empid);
+    if (leaf == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t position = leaf_position(leaf, empid);
+    if (position >= leaf->count || leaf->records[position].empid != empid)
+    {
+        return false;
+    }
+    abort_compaction();
+
+    memmove(&leaf->records[position], &leaf->records[position + 1],
+            (leaf->count - position - 1) * sizeof(UserRecord));
+    leaf->count--;
+    mark_dirty(leaf);
+
+    meta.user_count--;
+    if (meta.removed < 0xFFFF)
+    {
+        meta.removed++;
+    }
+    is_compact_failed = false;
+    return is_batch || commit();
+}
+
+/*!
+* @brief Function to find the user of a card key.
+* @param[in] key const char * of the key "name,empid" read from the card.
+* @param[out] record UserRecord of the user.
+* @return The status if the card is registered.
+*/
+bool
+UserStore::find_card(const char *key, UserRecord &record)
+{
+    uint8_t name_length;
+    uint32_t empid;
+    if (!parse_card(key, name_length, empid))
+    {
+        return false;
+    }
+
+    return find_empid(empid, record) &&
+           memcmp(record.name, key, name_length) == 0 && record.name[name_length] == '\0';
+}
+
+/*!
+* @brief Function to find a user by employee id.
+* @param[in] empid uint32_t employee id.
+* @param[out] record UserRecord of the user.
+* @return The status if the employee is registered.
+*/
+bool
+UserStore::find_empid(uint32_t empid, UserRecord &record)
+{
+    UserPage *leaf = find_leaf(empid);
+    if (leaf == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t position = leaf_position(leaf, empid);
+    if (position >= leaf->count || leaf->records[position].empid != empid)
+    {
+        return false;
+    }
+
+    record = leaf->records[position];
+    return true;
+}
+
+/*!
+* @brief Function to restart the listing of the users.
+*/
+void
+UserStore::rewind()
+{
+    next_empid = 0;
+    is_cursor_done = false;
+}
+
+/*!
+* @brief Function to get the next user by employee id.
+* @param[out] record UserRecord of the user.
+* @return The status if a user was read, false after the last one.
+*/
+bool
+UserStore::next(UserRecord &record)
+{
+    if (is_cursor_done || !find_next(next_empid, record))
+    {
+        is_cursor_done = true;
+        return false;
+    }
+
+    is_cursor_done = (record.empid == 0xFFFFFFFFUL);
+    next_empid = record.empid + 1;
+    return true;
+}
+
+/*!
+* @brief Function to find the first user whose employee id is not lower than
+*        an id.
+* @param[in] empid uint32_t searched.
+* @param[out] record UserRecord of the user.
+* @return The status if a user was found.
+*/
+bool
+UserStore::find_next(uint32_t empid, UserRecord &record)
+{
+    return find_next(empid, &record, 1) == 1;
+}
+
+/*!
+* @brief Function to copy the first users whose employee id is not lower than
+*        an id, in employee id order. They are taken from the leaf holding
+*        the first one, so fewer may be copied even before the last user.
+* @param[in] empid uint32_t searched.
+* @param[out] records UserRecord * of count records.
+* @param[in] count uint8_t of users wanted.
+* @return The number of users copied, 0 after the last user.
+*/
+uint8_t
+UserStore::find_next(uint32_t empid, UserRecord *records, uint8_t count)
+{
+    uint8_t position;
+    UserPage *leaf = file ? find_from(meta.root, 0, empid, position) : nullptr;
+    if (leaf == nullptr)
+    {
+        return 0;
+    }
+
+    count = min(count, (uint8_t)(leaf->count - position));
+    memcpy(records, &leaf->records[position], count * sizeof(UserRecord));
+    return count;
+}
+
+/*!
+* @brief Function to get the number of users.
+* @return The number of users.
+*/
+uint32_t
+UserStore::size() const
+{
+    return meta.user_count;
+}
+
+/*!
+* @brief Function to start bulk changes, the metadata is written by end_batch().
+*        The changed pages move to new pages, the tree on the card stays as
+*        it was until then.
+*/
+void
+UserStore::begin_batch()
+{
+    is_batch = true;
+}
+
+/*!
+* @brief Function to write the pages and metadata of the bulk changes.
+*/
+void
+UserStore::end_batch()
+{
+    is_batch = false;
+    commit();
+}
+
+/*!
+* @brief Function to run one step of the background compaction, which starts
+*        once enough users were removed. Each step writes at most one page
+*        of the spare file, so the door and the reader are not held up.
+*/
+void
+UserStore::run()
+{
+    if (!file || is_batch)
+    {
+        return;
+    }
+
+    bool is_done = true;
+    switch (compact_stage)
+    {
+        case COMPACT_IDLE:
+            if (!is_compact_failed && is_compaction_due())
+            {
+                start_compaction();
+            }
+            break;
+
+        case COMPACT_LEAVES:
+            is_done = compact_leaf();
+            break;
+
+        case COMPACT_BRANCHES:
+            is_done = compact_branches();
+            break;
+    }
+
+    if (!is_done)
+    {
+        Serial.println(F("Error: User store compaction failed!"));
+        abort_compaction();
+        is_compact_failed = true;
+    }
+}
+
+/*!
+* @brief Function to tell if the tree should be compacted: enough users were
+*        removed, or the splits left enough pages behind. Leaves and inner
+*        pages are at least half full without removals, which bounds the
+*        pages the users can fill.
+* @return The status if a compaction should start.
+*/
+bool
+UserStore::is_compaction_due() const
+{
+    if (meta.removed >= user_store_compact_removed && (uint32_t)meta.removed * 4 >= meta.user_count)
+    {
+        return true;
+    }
+
+    uint32_t leaves = meta.user_count / (user_leaf_records / 2) + 1;
+    uint32_t filled = 1 + leaves + leaves / (user_inner_branches / 2) + meta.height;
+    return meta.page_count > filled + user_store_compact_garbage;
+}
+
+/*!
+* @brief Function to tell if a compaction is in progress.
+* @return The status if the spare file is being written.
+*/
+bool
+UserStore::is_compacting() const
+{
+    return compact_stage != COMPACT_IDLE;
+}
+
+/*!
+* @brief Function to append zeros to a file.
+* @param[in] tree File& written at its end.
+* @param[in] size uint16_t of the zeros.
+*/
+static void
+append_zeros(File &tree, uint16_t size)
+{
+    static const uint8_t zeros[32] = {};
+    while (size > 0)
+    {
+        uint16_t chunk = min(size, (uint16_t)sizeof(zeros));
+        tree.write(zeros, chunk);
+        size -= chunk;
+    }
+}
+
+/*!
+* @brief Function to start a compaction. Page 0 of the spare file stays
+*        zero, so the file is not a tree, until the last step.
+*/
+void
+UserStore::start_compaction()
+{
+    SD.remove(spare_path);
+    spare = SD.open(spare_path, O_RDWR | O_CREAT);
+    if (!spare)
+    {
+        is_compact_failed = true;
+        return;
+    }
+    append_zeros(spare, user_page_size);
+
+    compact_stage = COMPACT_LEAVES;
+    compact_height = 1;
+    compact_pages = 1;
+    compact_empid = 0;
+    compact_left = meta.user_count;
+    level_start = 1;
+}
+
+/*!
+* @brief Function to copy the next users, in employee id order, into a new
+*        leaf of the spare file. An empty tree gets a single empty leaf.
+* @return The status if the leaf was written.
+*/
+bool
+UserStore::compact_leaf()
+{
+    uint8_t count = min(compact_left, (uint32_t)user_compact_leaf_fill);
+    uint8_t header[offsetof(UserPage, records)] = { USER_PAGE_LEAF, count };
+    spare.write(header, sizeof(header));
+
+    // The users are written straight from the cached leaf, the path from
+    // the root is walked once per leaf they come from
+    //
+    for (uint8_t i = 0; i < count; )
+    {
+        uint8_t position;
+        UserPage *leaf = find_from(meta.root, 0, compact_empid, position);
+        if (leaf == nullptr)
+        {
+            return false;
+        }
+
+        uint8_t found = min(count - i, leaf->count - position);
+        if (spare.write((const uint8_t *)&leaf->records[position], found * sizeof(UserRecord)) != found * sizeof(UserRecord))
+        {
+            return false;
+        }
+        compact_empid = leaf->records[position + found - 1].empid + 1;
+        i += found;
+    }
+    append_zeros(spare, user_page_size - sizeof(header) - count * sizeof(UserRecord));
+
+    compact_pages++;
+    compact_left -= count;
+    return compact_left > 0 || close_level();
+}
+
+/*!
+* @brief Function to write the next branches of the inner page being built,
+*        to the pages of the level below in order. The first employee id of
+*        a child is read back from the spare file, a leaf and an inner page
+*        both holding it right after their header.
+* @return The status if the branches were written.
+*/
+bool
+UserStore::compact_branches()
+{
+    if (page_branches == 0)
+    {
+        page_fill = min(level_start - next_child, (uint32_t)user_compact_inner_fill);
+        uint8_t header[offsetof(UserPage, branches)] = { USER_PAGE_INNER, page_fill };
+        spare.write(header, sizeof(header));
+    }
+
+    UserBranch branches[user_compact_branch_step];
+    uint8_t count = min(page_fill - page_branches, (int)user_compact_branch_step);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        branches[i].page = next_child + i;
+        if (!spare.seek(branches[i].page * (uint32_t)user_page_size + offsetof(UserPage, records)) ||
+            spare.read(&branches[i].empid, sizeof(branches[i].empid)) != sizeof(branches[i].empid))
+        {
+            return false;
+        }
+    }
+
+    if (!spare.seek(spare.size()) ||
+        spare.write((const uint8_t *)branches, count * sizeof(UserBranch)) != count * sizeof(UserBranch))
+    {
+        return false;
+    }
+    next_child += count;
+    page_branches += count;
+
+    if (page_branches < page_fill)
+    {
+        return true;
+    }
+
+    append_zeros(spare, user_page_size - offsetof(UserPage, branches) - page_fill * sizeof(UserBranch));
+    compact_pages++;
+    page_branches = 0;
+    return next_child < level_start || close_level();
+}
+
+/*!
+* @brief Function to end a level of the spare tree. A level of one page is
+*        the root, otherwise the inner level above it is started.
+* @return The status if the compaction may go on.
+*/
+bool
+UserStore::close_level()
+{
+    if (compact_pages - level_start == 1)
+    {
+        return finish_compaction(level_start);
+    }
+
+    if (compact_height >= user_store_max_height)
+    {
+        return false;
+    }
+
+    compact_stage = COMPACT_BRANCHES;
+    compact_height++;
+    next_child = level_start;
+    level_start = compact_pages;
+    page_branches = 0;
+    return true;
+}
+
+/*!
+* @brief Function to write the metadata of the spare tree, with the next
+*        generation, and make it the tree. From then on it is the tree even
+*        if the power is lost before the old file is removed.
+* @param[in] root uint32_t page of the root.
+* @return The status if the spare file became the tree.
+*/
+bool
+UserStore::finish_compaction(uint32_t root)
+{
+    UserStoreMeta built = meta;
+    built.height = compact_height;
+    built.root = root;
+    built.page_count = compact_pages;
+    built.removed = 0;
+    built.generation = meta.generation + 1;
+    built.crc = log_crc16((const uint8_t *)&built, offsetof(UserStoreMeta, crc));
+
+    if (!spare.seek(0) || spare.write((const uint8_t *)&built, sizeof(built)) != sizeof(built))
+    {
+        return false;
+    }
+    spare.flush();
+
+    file.close();
+    SD.remove(active_path);
+    file = spare;
+    spare = File();
+
+    const char *old_path = active_path;
+    active_path = spare_path;
+    spare_path = old_path;
+
+    meta = built;
+    committed_pages = meta.page_count;
+    memset(cache_page, 0, sizeof(cache_page));
+    memset(cache_dirty, 0, sizeof(cache_dirty));
+
+    compact_stage = COMPACT_IDLE;
+    compactions++;
+    return true;
+}
+
+/*!
+* @brief Function to drop a compaction in progress and its spare file.
+*/
+void
+UserStore::abort_compaction()
+{
+    if (compact_stage == COMPACT_IDLE)
+    {
+        return;
+    }
+
+    spare.close();
+    SD.remove(spare_path);
+    compact_stage = COMPACT_IDLE;
+}
+
+/*!
+* @brief Function to clear the page cache counters.
+*/
+void
+UserStore::reset_stats()
+{
+    hits = 0;
+    misses = 0;
+    writes = 0;
+}
+
+/*!
+* @brief Function to display the tree size and the page cache counters in the terminal.
+*/
+void
+UserStore::print_stats()
+{
+    Serial.print(F("Users: "));
+    Serial.print(meta.user_count);
+    Serial.print(F(" ("));
+    Serial.print(meta.page_count);
+    Serial.print(F(" pages, height "));
+    Serial.print(meta.height);
+    Serial.println(F(")"));
+    Serial.print(F("User cache: "));
+    Serial.print(sizeof(cache));
+    Serial.print(F(" bytes, hits "));
+    Serial.print(hits);
+    Serial.print(F(", misses "));
+    Serial.print(misses);
+    Serial.print(F(", writes "));
+    Serial.println(writes);
+    Serial.print(F("User compaction: "));
+    Serial.print(meta.removed);
+    Serial.print(F(" removed since the last one, "));
+    Serial.print(compactions);
+    Serial.print(F(" done"));
+    if (compact_stage != COMPACT_IDLE)
+    {
+        Serial.print(F(", in progress at page "));
+        Serial.print(compact_pages);
+    }
+    Serial.println();
+}
+
+/*!
+* @brief Function to split a card key "name,empid" at its first comma.
+* @param[in] key const char * of the key read from the card.
+* @param[out] name_length uint8_t of the name, which starts the key.
+* @param[out] empid uint32_t parsed after the comma.
+* @return The status if the key can belong to a user.
+*/
+bool
+UserStore::parse_card(const char *key, uint8_t &name_length, uint32_t &empid)
+{
+    const char *comma = strchr(key, ',');
+    if (comma == nullptr || comma - key >= user_name_size || !parse_empid(comma + 1, empid))
+    {
+        return false;
+    }
+
+    name_length = comma - key;
+    return true;
+}
+
+/*!
+* @brief Function to get the day a user was registered, its log days before
+*        belong to a previous holder of the employee id.
+* @param[in] record const UserRecord& of the user.
+* @return The day since 1970, 0 for a user registered before it was kept.
+*/
+uint32_t
+UserStore::registered_day(const UserRecord &record)
+{
+    return record.since_day[0] | ((uint32_t)record.since_day[1] << 8) | ((uint32_t)record.since_day[2] << 16);
+}
+
+/*!
+* @brief Function to parse an employee id, only decimal digits which fit in
+*        32 bits are accepted.
+* @param[in] text const char * of the employee id.
+* @param[out] empid uint32_t parsed.
+* @return The status if the text is a valid employee id.
+*/
+bool
+UserStore::parse_empid(const char *text, uint32_t &empid)
+{
+    if (*text == '\0')
+    {
+        return false;
+    }
+
+    empid = 0;
+    for (; *text != '\0'; text++)
+    {
+        if (*text < '0' || *text > '9')
+        {
+            return false;
+        }
+
+        uint8_t digit = *text - '0';
+        if (empid > (0xFFFFFFFFUL - digit) / 10)
+        {
+            return false;
+        }
+        empid = empid * 10 + digit;
+    }
+    return true;
+}
+
+/*!
+* @brief Function to get a page through the cache. On a miss the least
+*        recently used page is replaced, after being written if it changed.
+* @param[in] page uint32_t number of the page.
+* @return The cached page, nullptr when it could not be read.
+*/
+UserPage*
+UserStore::load_page(uint32_t page)
+{
+    uint8_t victim = 0;
+    for (uint8_t i = 0; i < user_store_cache_pages; i++)
+    {
+        if (cache_page[i] == page)
+        {
+            hits++;
+            cache_used[i] = ++cache_clock;
+            return &cache[i];
+        }
+        if (cache_page[i] == 0 || (cache_page[victim] != 0 && cache_used[i] < cache_used[victim]))
+        {
+            victim = i;
+        }
+    }
+
+    if (page == 0 || page >= meta.page_count || (cache_dirty[victim] && !write_slot(victim)))
+    {
+        return nullptr;
+    }
+
+    misses++;
+    cache_page[victim] = 0;
+    if (!file.seek(page * (uint32_t)user_page_size) ||
+        file.read(&cache[victim], user_page_size) != user_page_size ||
+        (cache[victim].type != USER_PAGE_LEAF && cache[victim].type != USER_PAGE_INNER))
+    {
+        return nullptr;
+    }
+
+    cache_page[victim] = page;
+    cache_used[victim] = ++cache_clock;
+    return &cache[victim];
+}
+
+/*!
+* @brief Function to allocate a page at the end of the file. It is only
+*        cached, it reaches the card with the other changed pages.
+* @param[in] type uint8_t UserPageType of the page.
+* @param[out] page uint32_t number of the page.
+* @return The cached page, nullptr when no cache slot could be freed.
+*/
+UserPage*
+UserStore::new_page(uint8_t type, uint32_t &page)
+{
+    uint8_t victim = 0;
+    for (uint8_t i = 1; i < user_store_cache_pages; i++)
+    {
+        if (cache_page[i] == 0 || (cache_page[victim] != 0 && cache_used[i] < cache_used[victim]))
+        {
+            victim = i;
+        }
+    }
+
+    if (cache_dirty[victim] && !write_slot(victim))
+    {
+        return nullptr;
+    }
+
+    page = meta.page_count++;
+    memset(&cache[victim], 0, sizeof(UserPage));
+    cache[victim].type = type;
+    cache_page[victim] = page;
+    cache_used[victim] = ++cache_clock;
+    cache_dirty[victim] = true;
+    return &cache[victim];
+}
+
+/*!
+* @brief Function to mark a cached page as changed.
+* @param[in] cached const UserPage * returned by load_page() or new_page().
+*/
+void
+UserStore::mark_dirty(const UserPage *cached)
+{
+    cache_dirty[cached - cache] = true;
+}
+
+/*!
+* @brief Function to give a cached page of the tree on the card a new page
+*        number before it is changed, the tree on the card keeps the old one.
+*        A page allocated since the last commit is not referenced by the
+*        tree on the card and keeps its number.
+* @param[in] cached const UserPage * returned by load_page().
+* @return The page number of the cached page.
+*/
+uint32_t
+UserStore::move_page(const UserPage *cached)
+{
+    uint8_t slot = cached - cache;
+    if (cache_page[slot] >= committed_pages)
+    {
+        cache_dirty[slot] = true;
+        return cache_page[slot];
+    }
+
+    cache_page[slot] = meta.page_count++;
+    cache_dirty[slot] = true;
+    return cache_page[slot];
+}
+
+/*!
+* @brief Function to write a cached page to its place in the file. A page
+*        allocated after the end of the file is preceded by empty pages,
+*        which are overwritten once their own cached copy is written.
+* @param[in] slot uint8_t of the cache.
+* @return The status if the page was written.
+*/
+bool
+UserStore::write_slot(uint8_t slot)
+{
+    uint32_t offset = cache_page[slot] * (uint32_t)user_page_size;
+
+    static const uint8_t zeros[32] = {};
+    while (file.size() < offset)
+    {
+        file.seek(file.size());
+        for (uint16_t i = 0; i < user_page_size; i += sizeof(zeros))
+        {
+            file.write(zeros, sizeof(zeros));
+        }
+    }
+
+    if (!file.seek(offset) || file.write((const uint8_t *)&cache[slot], user_page_size) != user_page_size)
+    {
+        return false;
+    }
+
+    cache_dirty[slot] = false;
+    writes++;
+    return true;
+}
+
+/*!
+* @brief Function to write the changed pages, then the metadata which makes
+*        them part of the tree. The pages of a split are all new, so the
+*        order they are written in does not matter.
+* @return The status if everything was written.
+*/
+bool
+UserStore::commit()
+{
+    bool is_written = true;
+    for (uint8_t i = 0; i < user_store_cache_pages; i++)
+    {
+        if (cache_page[i] != 0 && cache_dirty[i])
+        {
+            is_written = write_slot(i) && is_written;
+        }
+    }
+    return write_meta() && is_written;
+}
+
+/*!
+* @brief Function to write the metadata to page 0 and flush the file.
+* @return The status if the metadata was written.
+*/
+bool
+UserStore::write_meta()
+{
+    meta.crc = log_crc16((const uint8_t *)&meta, offsetof(UserStoreMeta, crc));
+    if (!file.seek(0) || file.write((const uint8_t *)&meta, sizeof(meta)) != sizeof(meta))
+    {
+        return false;
+    }
+    file.flush();
+    committed_pages = meta.page_count;
+    return true;
+}
+
+/*!
+* @brief Function to start an empty tree, a single empty leaf as root.
+*/
+void
+UserStore::reset_tree()
+{
+    memset(cache_page, 0, sizeof(cache_page));
+    memset(cache_dirty, 0, sizeof(cache_dirty));
+
+    memset(&meta, 0, sizeof(meta));
+    memcpy(meta.magic, user_store_magic, sizeof(meta.magic));
+    meta.version = user_store_version;
+    meta.height = 1;
+    meta.page_count = 1;
+
+    // The metadata page is written before the root so the root lands on page 1
+    //
+    static const uint8_t zeros[32] = {};
+    file.seek(0);
+    for (uint16_t i = 0; i < user_page_size; i += sizeof(zeros))
+    {
+        file.write(zeros, sizeof(zeros));
+    }
+
+    new_page(USER_PAGE_LEAF, meta.root);
+    commit();
+}
+
+/*!
+* @brief Function to find the position of an employee id in a leaf.
+* @param[in] leaf const UserPage * to search.
+* @param[in] empid uint32_t searched.
+* @return The first record whose id is not lower, count when every id is lower.
+*/
+uint8_t
+UserStore::leaf_position(const UserPage *leaf, uint32_t empid)
+{
+    uint8_t low = 0;
+    uint8_t high = leaf->count;
+    while (low < high)
+    {
+        uint8_t mid = (low + high) / 2;
+        if (leaf->records[mid].empid < empid)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/*!
+* @brief Function to find the child of an inner page holding an employee id.
+* @param[in] inner const UserPage * to search.
+* @param[in] empid uint32_t searched.
+* @return The last branch whose first id is not greater, the first branch
+*         covers every lower id.
+*/
+uint8_t
+UserStore::branch_position(const UserPage *inner, uint32_t empid)
+{
+    uint8_t low = 1;
+    uint8_t high = inner->count;
+    while (low < high)
+    {
+        uint8_t mid = (low + high) / 2;
+        if (inner->branches[mid].empid <= empid)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low - 1;
+}
+
+/*!
+* @brief Function to walk down to the only leaf which may hold an employee id.
+* @param[in] empid uint32_t searched.
+* @return The cached leaf, nullptr when a page could not be read.
+*/
+UserPage*
+UserStore::find_leaf(uint32_t empid)
+{
+    if (!file)
+    {
+        return nullptr;
+    }
+
+    uint32_t page = meta.root;
+    for (uint8_t level = 0; level + 1 < meta.height; level++)
+    {
+        UserPage *inner = load_page(page);
+        if (inner == nullptr)
+        {
+            return nullptr;
+        }
+        page = inner->branches[branch_position(inner, empid)].page;
+    }
+    return load_page(page);
+}
+
+/*!
+* @brief Function to find the first user whose employee id is not lower than
+*        an id in a subtree. The following subtrees are searched when the
+*        branch of the id only holds lower ids or empty leaves.
+* @param[in] page uint32_t root of the subtree.
+* @param[in] level uint8_t of the subtree root, 0 for the tree root.
+* @param[in] empid uint32_t searched.
+* @param[out] position uint8_t of the user in the leaf.
+* @return The cached leaf holding the user, nullptr when none was found.
+*/
+UserPage*
+UserStore::find_from(uint32_t page, uint8_t level, uint32_t empid, uint8_t &position)
+{
+    UserPage *node = load_page(page);
+    if (node == nullptr)
+    {
+        return nullptr;
+    }
+
+    if (level + 1 >= meta.height)
+    {
+        position = leaf_position(node, empid);
+        return (position < node->count) ? node : nullptr;
+    }
+
+    // The page is loaded again after each child, which may have evicted it
+    //
+    uint8_t branches = node->count;
+    for (uint8_t i = branch_position(node, empid); i < branches; i++)
+    {
+        node = load_page(page);
+        if (node == nullptr)
+        {
+            return nullptr;
+        }
+        UserPage *leaf = find_from(node->branches[i].page, level + 1, empid, position);
+        if (leaf != nullptr)
+        {
+            return leaf;
+        }
+    }
+    return nullptr;
+}
+
+/*!
+* @brief Function to update the parent of a page of the last insertion path
+*        once the page moved, and split when child is set. The parent gets
+*        the new page number and the branch to the new half, and moves as
+*        well, up to the root. A full parent is split the same way, a split
+*        root gets a new root above it.
+* @param[in] level uint8_t of the moved page, 0 for the root.
+* @param[in] moved uint32_t new page number of the moved page.
+* @param[in] empid uint32_t first employee id of the new half.
+* @param[in] child uint32_t page of the new half, 0 when the page only moved.
+* @return The status if the parent was updated.
+*/
+bool
+UserStore::insert_branch(uint8_t level, uint32_t moved, uint32_t empid, uint32_t child)
+{
+    if (child == 0 && moved == path[level])
+    {
+        return true;
+    }
+
+    if (level == 0)
+    {
+        if (child == 0)
+        {
+            meta.root = moved;
+            return true;
+        }
+        if (meta.height >= user_store_max_height)
+        {
+            return false;
+        }
+
+        uint32_t root_page;
+        UserPage *root = new_page(USER_PAGE_INNER, root_page);
+        if (root == nullptr)
+        {
+            return false;
+        }
+
+        root->branches[0].empid = 0;
+        root->branches[0].page = moved;
+        root->branches[1].empid = empid;
+        root->branches[1].page = child;
+        root->count = 2;
+
+        meta.root = root_page;
+        meta.height++;
+        return true;
+    }
+
+    UserPage *parent = load_page(path[level - 1]);
+    if (parent == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t position = 0;
+    while (position < parent->count && parent->branches[position].page != path[level])
+    {
+        position++;
+    }
+    if (position == parent->count)
+    {
+        return false;
+    }
+    parent->branches[position].page = moved;
+    uint32_t parent_moved = move_page(parent);
+
+    if (child == 0)
+    {
+        return insert_branch(level - 1, parent_moved, 0, 0);
+    }
+
+    UserBranch branch = { empid, child };
+    position++;
+    if (parent->count < user_inner_branches)
+    {
+        memmove(&parent->branches[position + 1], &parent->branches[position],
+                (parent->count - position) * sizeof(UserBranch));
+        parent->branches[position] = branch;
+        parent->count++;
+        return insert_branch(level - 1, parent_moved, 0, 0);
+    }
+
+    uint32_t right_page;
+    UserPage *right = new_page(USER_PAGE_INNER, right_page);
+    if (right == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t half = (user_inner_branches + 1) / 2;
+    uint8_t moved_from = (position < half) ? half - 1 : half;
+    right->count = parent->count - moved_from;
+    memcpy(right->branches, &parent->branches[moved_from], right->count * sizeof(UserBranch));
+    parent->count = moved_from;
+
+    UserPage *target = (position < half) ? parent : right;
+    uint8_t at = (position < half) ? position : position - half;
+    memmove(&target->branches[at + 1], &target->branches[at], (target->count - at) * sizeof(UserBranch));
+    target->branches[at] = branch;
+    target->count++;
+
+    return insert_branch(level - 1, parent_moved, right->branches[0].empid, right_page);
+}
@@ -7,6 +7,13 @@
 #include "AdminOperation.hpp"
 #include "Door.hpp"
 #include "UserOperation.hpp"
+#include "LoopProfiler.hpp"
+#include "Scheduler.hpp"
+#include "LogWriter.hpp"
+#include "LogStore.hpp"
+#include "UserStore.hpp"
+#include "UserFilter.hpp"
+#include "MemoryStats.hpp"
 
 
 
@@ -18,6 +25,8 @@ AuthenticationService auth ;
 UserAccessControl* p_usr_acs_ctrl;
 AdminOperation* p_admin_op;
 UserOperation* p_user_operation;
+LoopProfiler* p_profiler;
+Scheduler* p_scheduler;
 Door door;
 
 
@@ -25,6 +34,17 @@ const uint8_t buttonPin = 2;
 
 bool button_pressed=false;
 
+// Task periods in milliseconds, the period is also the deadline of the task
+//
+const uint16_t door_task_period   = 10;
+const uint16_t user_task_period   = 20;
+const uint16_t button_task_period = 20;
+const uint16_t admin_task_period  = 20;
+const uint16_t screen_task_period = 20;
+const uint16_t log_task_period    = 100;
+const uint16_t store_task_period  = 100;
+const uint16_t memory_task_period = memory_sample_period_ms;
+
 // ISR to open the door when button is pressed
 //
 static void openDoorISR() {
@@ -39,8 +59,83 @@ static void openDoorISR() {
 }
 
 
+// Task running the user operation (card polling and access)
+//
+static void user_task()
+{
+  p_user_operation->run();
+}
+
+// Task running the admin terminal state machine
+//
+static void admin_task()
+{
+  p_admin_op->run();
+}
+
+// Task checking the button states
+//
+static void button_task()
+{
+  if(button_pressed)
+  {
+    
+    // If button is pressed , open the Door
+    //
+    door.open();
+
+    // Change back the Button state, initial state
+    //
+    button_pressed=false;
+  }
+}
+
+// Task drawing the queued frames on the lcd display
+//
+static void screen_task()
+{
+  p_screen->run();
+}
+
+// Task writing the buffered access log records to the SD card and merging
+// the summary of the log segment, a few entries per run
+//
+static void log_task()
+{
+  LogWriter::get_instance()->run();
+  LogStore::get_instance()->run();
+}
+
+// Task compacting the user store once enough users were removed, one page
+// of the new tree per run, and rebuilding the user filter a few users per run
+//
+static void store_task()
+{
+  UserStore::get_instance()->run();
+  UserFilter::get_instance()->run();
+}
+
+// Task sampling the free RAM and the stack headroom
+//
+static void memory_task()
+{
+  MemoryStats::get_instance()->sample();
+}
+
+// Task performing the door operations according to the situation
+//
+static void door_task()
+{
+  door.run();
+}
+
+
 void setup()
 {
+    // The profiler times the boot phases from here
+    //
+    p_profiler = LoopProfiler::get_instance();
+
     Serial.begin(9600);
     
     // NOTE    : Delay is performed to setup the serial monitor
@@ -51,6 +146,7 @@ void setup()
     // REFER   : https://support.arduino.cc/hc/en-us/articles/4839084114460-If-your-board-runs-the-sketch-twice
     
     delay(2000);
+    p_profiler->end_boot_phase("serial");
     
     // Setup the buttion pin for ISR
     //
@@ -62,16 +158,24 @@ void setup()
     p_db = Database::get_instance();
     p_db->initSD(10);                     // CS pin for SD card
     p_db->initRTC();                      // Initialize RTC
+    p_profiler->end_boot_phase("sd+rtc");
 
     // Load admins and users from SD card
     //
     p_db->load_admins();
     p_db->load_users();
+    p_profiler->end_boot_phase("users");
     p_db->load_rfid_user_log_data();
+    p_profiler->end_boot_phase("log");
+
+    // Access records reach the card at most one second after the scan
+    //
+    LogWriter::get_instance()->set_durability(LogWriter::SYNC_INTERVAL, log_writer_sync_interval_ms);
 
     // Setup the RFID reader
     //
     p_rfid = RFIDreader::get_instance();
+    p_rfid->set_detect_mode(RFIDreader::DETECT_IRQ);   // Polling if the IRQ pin is unusable
 
     // Setup the Display
     //
@@ -104,8 +208,28 @@ void setup()
     // Assign the Services
     //
     p_user_operation->setAuthenticationService(&auth);
+    p_rfid->set_uid_cache(&auth);
     p_user_operation->setDoor(&door);
 
+    p_profiler->end_boot_phase("devices");
+    p_profiler->print_boot_report();
+
+    // Loop measurements start from here
+    //
+    p_profiler->reset();
+
+    // Register the tasks, door stepping and card polling first
+    //
+    p_scheduler = Scheduler::get_instance();
+    p_scheduler->add_task(door_task,   door_task_period,   0, LoopProfiler::TASK_DOOR);
+    p_scheduler->add_task(user_task,   user_task_period,   1, LoopProfiler::TASK_USER_OPERATION);
+    p_scheduler->add_task(button_task, button_task_period, 2, LoopProfiler::TASK_BUTTON);
+    p_scheduler->add_task(screen_task, screen_task_period, 3, LoopProfiler::TASK_SCREEN);
+    p_scheduler->add_task(admin_task,  admin_task_period,  4, LoopProfiler::TASK_ADMIN_OPERATION);
+    p_scheduler->add_task(log_task,    log_task_period,    5, LoopProfiler::TASK_LOG);
+    p_scheduler->add_task(store_task,  store_task_period,  6, LoopProfiler::TASK_STORE);
+    p_scheduler->add_task(memory_task, memory_task_period, 7, LoopProfiler::TASK_MEMORY);
+
     // First Print to the terminal 
     //
     Serial.println("Enter CLI");
@@ -114,31 +238,11 @@ void setup()
 
 void loop() 
 {
-  
-  // Start the User operation  
-  //
-  p_user_operation->run();
-
-  // Start the Admin operation  
-  //
-  p_admin_op->run();
+  p_profiler->begin_task(LoopProfiler::TASK_LOOP);
 
-  // Check the button states
+  // Run the task with the earliest deadline
   //
-  if(button_pressed)
-  {
-    
-    // If button is pressed , open the Door
-    //
-    door.open();
-
-    // Change back the Button state, initial state
-    //
-    button_pressed=false;
-  }
-  
-  // According to the situaiton check perform door operations
-  //
-  door.run();
+  p_scheduler->run();
 
+  p_profiler->end_task(LoopProfiler::TASK_LOOP);
 }
@@ -0,0 +1,163 @@
+/** @file test_log_store.cpp
+*
+* @brief Native tests of the LogStore day segments: a day with more
+*        employees than the summary table holds is merged into its summary
+*        by the log task, and the replay at boot skips torn records.
+*
+*        Run: pio test -e native -f test_log_store
+*
+*
+*/
+
+#include <Arduino.h>
+#include <SD.h>
+#include <HostHal.h>
+#include <unity.h>
+#include "LogStore.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+// 2025-01-06 08:00 UTC, and the segment of that day
+//
+static const uint32_t day_start = 1736150400UL;
+static const char segment_file[] = "temp/logs/20250106.bin";
+
+static std::string sd_dir;
+
+// One run of the log task, as the scheduler calls it
+//
+static void
+run_log_task()
+{
+    LogWriter::get_instance()->run();
+    LogStore::get_instance()->run();
+    host::clock_advance_us(100000);
+}
+
+// The summary of the day holds an employee with its first and last scan
+//
+static void
+check_summary(uint32_t empid, uint32_t first_epoch, uint32_t last_epoch, uint16_t count)
+{
+    SummaryEntry entry;
+    TEST_ASSERT_TRUE(LogStore::get_instance()->find_summary(LogStore::segment_of(day_start), empid, entry));
+    TEST_ASSERT_EQUAL_UINT32(first_epoch, entry.first_epoch);
+    TEST_ASSERT_EQUAL_UINT32(last_epoch, entry.last_epoch);
+    TEST_ASSERT_EQUAL_UINT32(count, entry.count);
+}
+
+void
+setUp()
+{
+    char dir[] = "/tmp/log_store_test_XXXXXX";
+    TEST_ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    sd_dir = dir;
+
+    host::clock_use_virtual(true);
+    host::sd_set_root(sd_dir.c_str());
+    TEST_ASSERT_TRUE(SD.begin());
+    SD.mkdir("temp");
+    TEST_ASSERT_TRUE(LogStore::get_instance()->begin());
+}
+
+void
+tearDown()
+{
+    LogWriter::get_instance()->close();
+    std::filesystem::remove_all(sd_dir);
+}
+
+// Three times the employees of the table, each scanned in the morning and
+// the evening. The table stops counting when full and the log task merges
+// it, the scans appended meanwhile are counted from the segment
+//
+void
+test_summary_merge_past_table()
+{
+    LogStore *store = LogStore::get_instance();
+    const uint32_t employees = summary_table_entries * 3;
+
+    for (uint8_t pass = 0; pass < 2; pass++)
+    {
+        for (uint32_t i = 0; i < employees; i++)
+        {
+            TEST_ASSERT_TRUE(store->append(5000 + i, day_start + pass * 36000UL + i));
+            run_log_task();
+        }
+    }
+    for (uint16_t n = 0; n < 200; n++)
+    {
+        run_log_task();
+    }
+
+    for (uint8_t boot = 0; boot < 2; boot++)
+    {
+        for (uint32_t i = 0; i < employees; i++)
+        {
+            check_summary(5000 + i, day_start + i, day_start + 36000UL + i, 2);
+        }
+
+        SummaryEntry entry;
+        uint32_t count = 0;
+        store->rewind_summaries();
+        while (store->next_summary(entry))
+        {
+            TEST_ASSERT_EQUAL_UINT32(5000 + count, entry.empid);
+            count++;
+        }
+        TEST_ASSERT_EQUAL_UINT32(employees, count);
+
+        TEST_ASSERT_TRUE(store->begin());
+    }
+}
+
+// Power lost while records were written: one record in the middle is
+// corrupted and the last one torn. The replay at boot counts the others,
+// and the scans appended after the boot are counted too
+//
+void
+test_replay_skips_torn_record()
+{
+    LogStore *store = LogStore::get_instance();
+    for (uint32_t i = 0; i < 10; i++)
+    {
+        TEST_ASSERT_TRUE(store->append(7000, day_start + i * 60));
+    }
+    LogWriter::get_instance()->sync();
+
+    std::string path = sd_dir + "/" + segment_file;
+    uintmax_t size = std::filesystem::file_size(path);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(LogHeader) + 10 * sizeof(LogRecord), size);
+
+    // Without a summary, the whole segment is replayed
+    //
+    LogWriter::get_instance()->close();
+    std::filesystem::remove(sd_dir + "/temp/logs/20250106.sum");
+
+    FILE *file = fopen(path.c_str(), "r+b");
+    TEST_ASSERT_TRUE(file != nullptr);
+    fseek(file, sizeof(LogHeader) + 4 * sizeof(LogRecord) + offsetof(LogRecord, epoch), SEEK_SET);
+    fputc(0xA5, file);
+    fclose(file);
+    std::filesystem::resize_file(path, size - sizeof(LogRecord) / 2);
+
+    TEST_ASSERT_TRUE(store->begin());
+    check_summary(7000, day_start, day_start + 8 * 60, 8);
+
+    TEST_ASSERT_TRUE(store->append(7000, day_start + 3600));
+    LogWriter::get_instance()->sync();
+    TEST_ASSERT_TRUE(store->begin());
+    check_summary(7000, day_start, day_start + 3600, 9);
+}
+
+int
+main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_summary_merge_past_table);
+    RUN_TEST(test_replay_skips_torn_record);
+    return UNITY_END();
+}
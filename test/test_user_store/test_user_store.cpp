@@ -0,0 +1,218 @@
+/** @file test_user_store.cpp
+*
+* @brief Native tests of the UserStore B+tree: a power cut between the page
+*        writes and the metadata leaves the previous tree, and a compaction
+*        makes the newer generation the tree.
+*
+*        Run: pio test -e native -f test_user_store
+*
+*
+*/
+
+#include <Arduino.h>
+#include <SD.h>
+#include <HostHal.h>
+#include <unity.h>
+#include "UserStore.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static const char tree_path[]  = "temp/users.db";
+static const char spare_path[] = "temp/users2.db";
+
+static std::string sd_dir;
+
+// Host file behind a path of the card
+//
+static std::string
+host_path(const char *path)
+{
+    return sd_dir + "/" + path;
+}
+
+static std::vector<char>
+read_host_file(const char *path)
+{
+    std::ifstream in(host_path(path), std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void
+write_host_bytes(const char *path, const std::vector<char> &bytes, size_t size)
+{
+    std::fstream out(host_path(path), std::ios::binary | std::ios::in | std::ios::out);
+    out.write(bytes.data(), size);
+}
+
+static void
+write_host_file(const char *path, const std::vector<char> &bytes)
+{
+    std::ofstream out(host_path(path), std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size());
+}
+
+// Users first, first + step, ... added as one batch
+//
+static void
+add_users(UserStore *store, uint32_t first, uint32_t count, uint32_t step)
+{
+    store->begin_batch();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t empid = first + i * step;
+        TEST_ASSERT_TRUE(store->add(String("user") + String(empid), empid));
+    }
+    store->end_batch();
+}
+
+// The listing holds exactly the expected employee ids, in order
+//
+static void
+check_listing(UserStore *store, const std::vector<uint32_t> &expected)
+{
+    UserRecord record;
+    size_t n = 0;
+    store->rewind();
+    while (store->next(record))
+    {
+        TEST_ASSERT_TRUE(n < expected.size());
+        TEST_ASSERT_EQUAL_UINT32(expected[n], record.empid);
+        n++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(expected.size(), n);
+    TEST_ASSERT_EQUAL_UINT32(expected.size(), store->size());
+}
+
+void
+setUp()
+{
+    char dir[] = "/tmp/user_store_test_XXXXXX";
+    TEST_ASSERT_TRUE(mkdtemp(dir) != nullptr);
+    sd_dir = dir;
+
+    host::clock_use_virtual(true);
+    host::sd_set_root(sd_dir.c_str());
+    TEST_ASSERT_TRUE(SD.begin());
+    SD.mkdir("temp");
+    TEST_ASSERT_TRUE(UserStore::get_instance()->begin(tree_path, spare_path));
+}
+
+void
+tearDown()
+{
+    UserStore::get_instance()->close();
+    std::filesystem::remove_all(sd_dir);
+}
+
+// Splits write their pages to new places, the metadata left from before
+// still describes the whole previous tree
+//
+void
+test_crash_before_metadata_keeps_previous_tree()
+{
+    UserStore *store = UserStore::get_instance();
+    add_users(store, 1000, 100, 2);
+    store->close();
+    std::vector<char> committed = read_host_file(tree_path);
+
+    TEST_ASSERT_TRUE(store->begin(tree_path, spare_path));
+    add_users(store, 1001, 200, 2);
+    store->close();
+    TEST_ASSERT_TRUE(read_host_file(tree_path).size() > committed.size());
+
+    // Power lost once the pages were written, page 0 was not
+    //
+    write_host_bytes(tree_path, committed, sizeof(UserStoreMeta));
+
+    TEST_ASSERT_TRUE(store->begin(tree_path, spare_path));
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        expected.push_back(1000 + i * 2);
+    }
+    check_listing(store, expected);
+
+    UserRecord record;
+    TEST_ASSERT_TRUE(store->find_empid(1198, record));
+    TEST_ASSERT_FALSE(store->find_empid(1001, record));
+
+    // The pages left behind are overwritten by the next changes
+    //
+    TEST_ASSERT_TRUE(store->add("late", 1001));
+    store->close();
+    TEST_ASSERT_TRUE(store->begin(tree_path, spare_path));
+    TEST_ASSERT_TRUE(store->find_empid(1001, record));
+    TEST_ASSERT_EQUAL_UINT32(101, store->size());
+}
+
+// Enough removals compact the tree into the spare file, which becomes the
+// tree; a stale older generation left next to it is dropped at boot
+//
+void
+test_compaction_switches_generation()
+{
+    UserStore *store = UserStore::get_instance();
+    add_users(store, 1000, 300, 1);
+    for (uint32_t empid = 1000; empid < 1100; empid++)
+    {
+        TEST_ASSERT_TRUE(store->remove(empid));
+    }
+
+    for (uint16_t n = 0; n < 1000 && (n == 0 || store->is_compacting()); n++)
+    {
+        store->run();
+    }
+    TEST_ASSERT_FALSE(store->is_compacting());
+    TEST_ASSERT_TRUE(SD.exists(spare_path));
+    TEST_ASSERT_FALSE(SD.exists(tree_path));
+
+    std::vector<uint32_t> expected;
+    for (uint32_t empid = 1100; empid < 1300; empid++)
+    {
+        expected.push_back(empid);
+    }
+    check_listing(store, expected);
+
+    store->close();
+    TEST_ASSERT_TRUE(store->begin(tree_path, spare_path));
+    check_listing(store, expected);
+    std::vector<char> first_generation = read_host_file(spare_path);
+
+    // The next compaction moves the tree back to the first file
+    //
+    for (uint32_t empid = 1100; empid < 1200; empid++)
+    {
+        TEST_ASSERT_TRUE(store->remove(empid));
+    }
+    for (uint16_t n = 0; n < 1000 && (n == 0 || store->is_compacting()); n++)
+    {
+        store->run();
+    }
+    TEST_ASSERT_FALSE(store->is_compacting());
+    TEST_ASSERT_TRUE(SD.exists(tree_path));
+    TEST_ASSERT_FALSE(SD.exists(spare_path));
+    store->close();
+
+    // Power lost before the old file was removed
+    //
+    write_host_file(spare_path, first_generation);
+    TEST_ASSERT_TRUE(store->begin(tree_path, spare_path));
+    TEST_ASSERT_FALSE(SD.exists(spare_path));
+
+    expected.erase(expected.begin(), expected.begin() + 100);
+    check_listing(store, expected);
+}
+
+int
+main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_crash_before_metadata_keeps_previous_tree);
+    RUN_TEST(test_compaction_switches_generation);
+    return UNITY_END();
+}
@@ -0,0 +1,146 @@
+/** @file LogConvert.cpp
+*
+* @brief Host tool for the RFID access log. Converts a legacy text log
+*        (temp/rfid_log.txt, "name,empid,d/m/yyyy,h:m:s" per line) into the
+*        binary format of LogFormat.hpp, and dumps a binary log as text.
+*        The firmware converts a legacy log on its own at boot; the tool
+*        does it ahead of time on a PC, which is much faster for large logs.
+*
+*        Build and run: pio run -e native_logconvert
+*                       .pio/build/native_logconvert/program rfid_log.txt rfid_log.bin
+*                       .pio/build/native_logconvert/program --dump rfid_log.bin
+*
+*
+*/
+
+#include <Arduino.h>
+#include <RTClib.h>
+#include "LogFormat.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+/*!
+* @brief Function to convert a legacy text log.
+* @param[in] in_path const char * of the text log.
+* @param[in] out_path const char * of the binary log to create.
+* @return The exit status.
+*/
+static int
+convert(const char *in_path, const char *out_path)
+{
+    FILE *in = fopen(in_path, "r");
+    if (in == nullptr)
+    {
+        perror(in_path);
+        return 1;
+    }
+    FILE *out = fopen(out_path, "wb");
+    if (out == nullptr)
+    {
+        perror(out_path);
+        fclose(in);
+        return 1;
+    }
+
+    LogHeader header;
+    log_make_header(header);
+    fwrite(&header, sizeof(header), 1, out);
+
+    char line[256];
+    unsigned long line_number = 0;
+    unsigned long converted = 0;
+    unsigned long skipped = 0;
+
+    while (fgets(line, sizeof(line), in) != nullptr)
+    {
+        line_number++;
+        uint32_t empid, epoch;
+        if (!log_parse_legacy_line(line, empid, epoch))
+        {
+            if (line[0] != '\n' && line[0] != '\r' && line[0] != '\0')
+            {
+                fprintf(stderr, "%s:%lu: skipped: %s", in_path, line_number, line);
+                skipped++;
+            }
+            continue;
+        }
+
+        LogRecord record;
+        log_make_record(record, empid, epoch, LOG_EVENT_ACCESS);
+        fwrite(&record, sizeof(record), 1, out);
+        converted++;
+    }
+
+    fclose(in);
+    if (fclose(out) != 0)
+    {
+        perror(out_path);
+        return 1;
+    }
+
+    printf("%lu records written to %s, %lu lines skipped\n", converted, out_path, skipped);
+    return 0;
+}
+
+/*!
+* @brief Function to print a binary log as "empid,d/m/yyyy,h:m:s,event" lines.
+* @param[in] path const char * of the binary log.
+* @return The exit status.
+*/
+static int
+dump(const char *path)
+{
+    FILE *in = fopen(path, "rb");
+    if (in == nullptr)
+    {
+        perror(path);
+        return 1;
+    }
+
+    LogHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || !log_check_header(header))
+    {
+        fprintf(stderr, "%s: not a version %u RFID log\n", path, log_format_version);
+        fclose(in);
+        return 1;
+    }
+
+    LogRecord record;
+    unsigned long corrupted = 0;
+    while (fread(&record, sizeof(record), 1, in) == 1)
+    {
+        if (!log_check_record(record))
+        {
+            corrupted++;
+            continue;
+        }
+        DateTime at(record.epoch);
+        printf("%lu,%u/%u/%u,%u:%u:%u,%u\n", (unsigned long)record.empid,
+               at.day(), at.month(), at.year(), at.hour(), at.minute(), at.second(), record.event);
+    }
+    fclose(in);
+
+    if (corrupted > 0)
+    {
+        fprintf(stderr, "%s: %lu corrupted records skipped\n", path, corrupted);
+    }
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc == 3 && strcmp(argv[1], "--dump") == 0)
+    {
+        return dump(argv[2]);
+    }
+    if (argc == 3)
+    {
+        return convert(argv[1], argv[2]);
+    }
+
+    fprintf(stderr, "usage: %s <legacy.txt> <out.bin>\n"
+                    "       %s --dump <log.bin>\n", argv[0], argv[0]);
+    return 2;
+}